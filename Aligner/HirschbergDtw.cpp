@@ -0,0 +1,274 @@
+/*
+  ==============================================================================
+
+    HirschbergDtw.cpp
+    Dynamic time warping in memory linear in the sequence lengths, by divide and conquer.
+
+  ==============================================================================
+*/
+
+#include "HirschbergDtw.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+namespace
+{
+    constexpr float unreachable = 1.0e30f;
+
+    /** Runs job(0) to job(numJobs - 1) on the pool and waits for them all. */
+    void runJobs(juce::ThreadPool& pool, size_t numJobs, const std::function<void(size_t)>& job)
+    {
+        std::atomic<size_t> finished { 0 };
+
+        for (size_t j = 0; j < numJobs; ++j)
+        {
+            pool.addJob([&, j]
+            {
+                job(j);
+                ++finished;
+            });
+        }
+
+        while (finished.load() < numJobs)
+            juce::Thread::sleep(1);
+    }
+}
+
+FeatureSequence::FeatureSequence(const std::vector<Vector>& vectors)
+    : length((int) vectors.size()),
+      forwardData((size_t) numFeatures * vectors.size()),
+      backwardData((size_t) numFeatures * vectors.size())
+{
+    for (int f = 0; f < numFeatures; ++f)
+    {
+        for (int i = 0; i < length; ++i)
+        {
+            forwardData[(size_t) (f * length + i)] = vectors[(size_t) i][(size_t) f];
+            backwardData[(size_t) (f * length + length - 1 - i)] = vectors[(size_t) i][(size_t) f];
+        }
+    }
+}
+
+float FeatureSequence::distance(int index, const FeatureSequence& other, int otherIndex) const noexcept
+{
+    float similarity = 0.0f;
+    for (int f = 0; f < numFeatures; ++f)
+        similarity += forward(f)[index] * other.forward(f)[otherIndex];
+    return 1.0f - similarity;
+}
+
+//==============================================================================
+std::vector<HirschbergDtw::Cell> HirschbergDtw::align(const FeatureSequence& rows, const FeatureSequence& cols) const
+{
+    std::vector<Cell> path;
+    if (rows.size() == 0 || cols.size() == 0)
+        return path;
+
+    juce::ThreadPool pool(juce::jmax(1, settings.numThreads));
+    std::vector<Region> pending { { 0, rows.size() - 1, 0, cols.size() - 1 } }, small;
+
+    while (! pending.empty())
+    {
+        std::vector<Region> large;
+        for (const auto& region : pending)
+        {
+            if (region.getNumRows() < 2 || (juce::int64) region.getNumRows() * region.getNumCols() <= settings.maxBaseCells)
+                small.push_back(region);
+            else
+                large.push_back(region);
+        }
+
+        // Both passes of every region cut at this level at once
+        std::vector<std::vector<float>> fromStart(large.size()), toEnd(large.size());
+        runJobs(pool, 2 * large.size(), [&] (size_t job)
+        {
+            auto region = large[job / 2];
+            const auto middle = region.row0 + (region.getNumRows() - 2) / 2;
+
+            if (job % 2 == 0)
+            {
+                region.row1 = middle;
+                sweep(rows, cols, region, false, fromStart[job / 2]);
+            }
+            else
+            {
+                region.row0 = middle + 1;
+                sweep(rows, cols, region, true, toEnd[job / 2]);
+            }
+        });
+
+        pending.clear();
+
+        for (size_t r = 0; r < large.size(); ++r)
+        {
+            const auto& region = large[r];
+            const auto middle = region.row0 + (region.getNumRows() - 2) / 2;
+            const auto& start = fromStart[r];
+            const auto& end = toEnd[r];  // end[k] is for column col1 - k
+
+            // The path leaves the middle row at `split` and enters the next one at the same or the next column
+            int split = region.col0, next = region.col0;
+            float best = unreachable * 2.0f;
+
+            for (int c = region.col0; c <= region.col1; ++c)
+            {
+                const auto down = end[(size_t) (region.col1 - c)];
+                const auto diagonal = c < region.col1 ? end[(size_t) (region.col1 - c - 1)] : unreachable;
+                const auto total = start[(size_t) (c - region.col0)] + juce::jmin(down, diagonal);
+
+                if (total < best)
+                {
+                    best = total;
+                    split = c;
+                    next = diagonal < down ? c + 1 : c;
+                }
+            }
+
+            pending.push_back({ region.row0, middle, region.col0, split });
+            pending.push_back({ middle + 1, region.row1, next, region.col1 });
+        }
+    }
+
+    // The regions left cover disjoint rows in path order
+    std::sort(small.begin(), small.end(), [] (const Region& a, const Region& b) { return a.row0 < b.row0; });
+
+    std::vector<std::vector<Cell>> pieces(small.size());
+    runJobs(pool, small.size(), [&] (size_t r)
+    {
+        solveQuadratic(rows, cols, small[r], pieces[r]);
+    });
+
+    for (const auto& piece : pieces)
+        path.insert(path.end(), piece.begin(), piece.end());
+
+    return path;
+}
+
+std::vector<HirschbergDtw::Cell> HirschbergDtw::alignQuadratic(const FeatureSequence& rows, const FeatureSequence& cols)
+{
+    std::vector<Cell> path;
+    if (rows.size() > 0 && cols.size() > 0)
+        solveQuadratic(rows, cols, { 0, rows.size() - 1, 0, cols.size() - 1 }, path);
+    return path;
+}
+
+double HirschbergDtw::getPathCost(const FeatureSequence& rows, const FeatureSequence& cols, const std::vector<Cell>& path)
+{
+    double cost = 0.0;
+    for (const auto& cell : path)
+        cost += rows.distance(cell.row, cols, cell.col);
+    return cost;
+}
+
+//==============================================================================
+void HirschbergDtw::sweep(const FeatureSequence& rows, const FeatureSequence& cols, const Region& region, bool reversed,
+                          std::vector<float>& costs)
+{
+    const auto numRows = region.getNumRows();
+    const auto numCols = region.getNumCols();
+
+    // Local cell (i, j) is row row0 + i and column col0 + j, or row1 - i and col1 - j when reversed. Along an
+    // anti-diagonal d, i rises as j = d - i falls, so the columns are read from the other end of their
+    // sequence: both reads then advance with i.
+    const auto rowOffset = reversed ? rows.size() - 1 - region.row1 : region.row0;
+    const auto colOffset = [&] (int d) { return reversed ? region.col1 - d : cols.size() - 1 - region.col0 - d; };
+    const auto rowFeatures = [&] (int f) { return reversed ? rows.backward(f) : rows.forward(f); };
+    const auto colFeatures = [&] (int f) { return reversed ? cols.forward(f) : cols.backward(f); };
+
+    // Three anti-diagonals in rotation, indexed by i + 1 so that i = -1 reads as unreachable
+    std::vector<float> diagonals[3];
+    for (auto& diagonal : diagonals)
+        diagonal.assign((size_t) numRows + 2, unreachable);
+
+    std::vector<float> distances((size_t) juce::jmin(numRows, numCols));
+    costs.assign((size_t) numCols, unreachable);
+
+    for (int d = 0; d < numRows + numCols - 1; ++d)
+    {
+        const auto lo = juce::jmax(0, d - numCols + 1);
+        const auto hi = juce::jmin(d, numRows - 1);
+        const auto length = hi - lo + 1;
+        float* distance = distances.data();
+
+        std::fill(distance, distance + length, 1.0f);
+
+        for (int f = 0; f < FeatureSequence::numFeatures; ++f)
+        {
+            const float* a = rowFeatures(f) + rowOffset + lo;
+            const float* b = colFeatures(f) + colOffset(d) + lo;
+
+            for (int t = 0; t < length; ++t)
+                distance[t] -= a[t] * b[t];
+        }
+
+        float* current = diagonals[d % 3].data();
+        const float* previous = diagonals[(d + 2) % 3].data();
+        const float* beforeThat = diagonals[(d + 1) % 3].data();
+
+        if (d == 0)
+        {
+            current[1] = distance[0];
+        }
+        else
+        {
+            // From the left (i, j - 1), from above (i - 1, j) and diagonally (i - 1, j - 1)
+            for (int t = 0; t < length; ++t)
+            {
+                const auto i = lo + t;
+                current[i + 1] = distance[t] + std::min(previous[i + 1], std::min(previous[i], beforeThat[i]));
+            }
+        }
+
+        // Cells either side of this diagonal are off the region for the two diagonals after it
+        current[lo] = unreachable;
+        current[hi + 2] = unreachable;
+
+        if (hi == numRows - 1)
+            costs[(size_t) (d - hi)] = current[hi + 1];
+    }
+}
+
+void HirschbergDtw::solveQuadratic(const FeatureSequence& rows, const FeatureSequence& cols, const Region& region,
+                                   std::vector<Cell>& path)
+{
+    const auto numRows = region.getNumRows();
+    const auto numCols = region.getNumCols();
+    std::vector<float> total((size_t) numRows * (size_t) numCols);
+
+    const auto at = [&] (int i, int j) -> float
+    {
+        return i < 0 || j < 0 ? unreachable : total[(size_t) i * (size_t) numCols + (size_t) j];
+    };
+
+    for (int i = 0; i < numRows; ++i)
+    {
+        for (int j = 0; j < numCols; ++j)
+        {
+            const auto before = i == 0 && j == 0 ? 0.0f : std::min(at(i, j - 1), std::min(at(i - 1, j), at(i - 1, j - 1)));
+            total[(size_t) i * (size_t) numCols + (size_t) j] = rows.distance(region.row0 + i, cols, region.col0 + j) + before;
+        }
+    }
+
+    // Back from the last corner, preferring the diagonal step on ties
+    std::vector<Cell> reversedPath;
+    int i = numRows - 1, j = numCols - 1;
+    reversedPath.push_back({ region.row0 + i, region.col0 + j });
+
+    while (i > 0 || j > 0)
+    {
+        const auto diagonal = at(i - 1, j - 1), up = at(i - 1, j), left = at(i, j - 1);
+
+        if (diagonal <= up && diagonal <= left)
+            --i, --j;
+        else if (up <= left)
+            --i;
+        else
+            --j;
+
+        reversedPath.push_back({ region.row0 + i, region.col0 + j });
+    }
+
+    path.assign(reversedPath.rbegin(), reversedPath.rend());
+}
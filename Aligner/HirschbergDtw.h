@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    HirschbergDtw.h
+    Dynamic time warping in memory linear in the sequence lengths, by divide and conquer.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <vector>
+
+/**
+ * @brief A sequence of fixed-size, non-negative feature vectors of unit length, such as chord profiles.
+ *
+ * Stored feature by feature, forwards and backwards, so that the cells of an anti-diagonal of the cost
+ * matrix read both sequences at consecutive addresses whichever way a pass runs.
+ */
+class FeatureSequence
+{
+public:
+    static constexpr int numFeatures = 16;
+    using Vector = std::array<float, numFeatures>;
+
+    explicit FeatureSequence(const std::vector<Vector>& vectors);
+
+    int size() const noexcept  { return length; }
+
+    /** Feature `feature` of every element, first to last, and last to first. */
+    const float* forward(int feature) const noexcept   { return forwardData.data() + (size_t) feature * (size_t) length; }
+    const float* backward(int feature) const noexcept  { return backwardData.data() + (size_t) feature * (size_t) length; }
+
+    /** 1 minus the cosine similarity of two elements, from 0 (same direction) to 1 (no feature in common). */
+    float distance(int index, const FeatureSequence& other, int otherIndex) const noexcept;
+
+private:
+    int length = 0;
+    std::vector<float> forwardData, backwardData;
+};
+
+/**
+ * @brief Aligns two feature sequences with dynamic time warping, without the quadratic cost matrix.
+ *
+ * The warping path runs from the first element pair to the last in steps of one row, one column or
+ * both, and minimises the summed distances of the pairs it visits. Following Hirschberg, each region of
+ * the matrix is cut at its middle row: a pass from the region's start gives the cost of the best path
+ * to every cell of that row, a pass from its end over both sequences reversed gives the cost from the
+ * row below, and the column where their sum is lowest is on the optimal path. The two halves either
+ * side of it are solved the same way, all the regions of one level in parallel, until they are small
+ * enough (`maxBaseCells`) for the full matrix and a backtrack.
+ *
+ * A pass sweeps the region by anti-diagonals. Every cell of an anti-diagonal depends only on the two
+ * before it, so each one is a branch-free loop over consecutive memory that the compiler vectorises.
+ * A pass holds three anti-diagonals and one row, so memory stays linear in the lengths: the optimal path
+ * is found in about twice the time of the quadratic algorithm.
+ */
+class HirschbergDtw
+{
+public:
+    struct Settings
+    {
+        int numThreads = juce::SystemStats::getNumCpus();
+        juce::int64 maxBaseCells = 1 << 18;
+    };
+
+    struct Cell
+    {
+        int row, col;
+    };
+
+    explicit HirschbergDtw(const Settings& newSettings) : settings(newSettings) {}
+
+    /** The optimal path of `rows` against `cols`, from (0, 0) to the last pair; empty if either is empty. */
+    std::vector<Cell> align(const FeatureSequence& rows, const FeatureSequence& cols) const;
+
+    /** The same path from the full cost matrix, for reference: quadratic in memory. */
+    static std::vector<Cell> alignQuadratic(const FeatureSequence& rows, const FeatureSequence& cols);
+
+    /** Summed distances of the pairs on `path`. */
+    static double getPathCost(const FeatureSequence& rows, const FeatureSequence& cols, const std::vector<Cell>& path);
+
+private:
+    /** Rows row0 to row1 and columns col0 to col1, inclusive; the path enters at the first corner and leaves at the last. */
+    struct Region
+    {
+        int row0, row1, col0, col1;
+
+        int getNumRows() const noexcept  { return row1 - row0 + 1; }
+        int getNumCols() const noexcept  { return col1 - col0 + 1; }
+    };
+
+    /**
+     * Cost of the best path from the region's first corner to each cell of its last row, or with
+     * `reversed`, from each cell of its first row to its last corner (indexed from the last column).
+     */
+    static void sweep(const FeatureSequence& rows, const FeatureSequence& cols, const Region& region, bool reversed,
+                      std::vector<float>& costs);
+
+    static void solveQuadratic(const FeatureSequence& rows, const FeatureSequence& cols, const Region& region,
+                               std::vector<Cell>& path);
+
+    Settings settings;
+};
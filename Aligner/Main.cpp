@@ -0,0 +1,116 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Aligns a whole recorded performance to its score offline, for ground truth and training data.
+
+    Usage: MidiPredictAligner --score <mid> --performance <mid> [--out <dir>] [--threads <n>]
+                              [--chord-ms <ms>] [--tempo-window <beats>] [--base-cells <n>]
+
+    Writes notes.csv (every score note with the performed note matched to it, or missed, then the extra
+    performed notes) and tempo.csv (the performed tempo along the score) to the output directory; see
+    ScoreAlignment. Memory grows linearly with the length of the piece (see HirschbergDtw).
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "ScoreAlignment.h"
+
+#include <iostream>
+
+namespace
+{
+    struct Options
+    {
+        juce::File score, performance, outputDirectory;
+        ScoreAlignment::Settings alignment;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: MidiPredictAligner --score <mid> --performance <mid> [--out <dir>] [--threads <n>]\n"
+                     "                          [--chord-ms <ms>] [--tempo-window <beats>] [--base-cells <n>]\n";
+    }
+
+    bool parse(int argc, char* argv[], Options& options)
+    {
+        const auto cwd = juce::File::getCurrentWorkingDirectory();
+        options.outputDirectory = cwd;
+
+        for (int i = 1; i < argc; ++i)
+        {
+            const juce::String arg(argv[i]);
+
+            if (i + 1 >= argc)
+                return false;
+
+            const juce::String value(argv[++i]);
+
+            if (arg == "--score")              options.score = cwd.getChildFile(value);
+            else if (arg == "--performance")   options.performance = cwd.getChildFile(value);
+            else if (arg == "--out")           options.outputDirectory = cwd.getChildFile(value);
+            else if (arg == "--threads")       options.alignment.dtw.numThreads = juce::jmax(1, value.getIntValue());
+            else if (arg == "--chord-ms")      options.alignment.chordSeconds = value.getDoubleValue() / 1000.0;
+            else if (arg == "--tempo-window")  options.alignment.tempoWindowBeats = value.getDoubleValue();
+            else if (arg == "--base-cells")    options.alignment.dtw.maxBaseCells = juce::jmax((juce::int64) 1, value.getLargeIntValue());
+            else return false;
+        }
+
+        return options.score.existsAsFile() && options.performance.existsAsFile()
+            && options.alignment.chordSeconds >= 0.0 && options.alignment.tempoWindowBeats > 0.0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (! parse(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    if (! options.outputDirectory.createDirectory())
+    {
+        std::cerr << "Cannot create " << options.outputDirectory.getFullPathName() << "\n";
+        return 1;
+    }
+
+    ScoreAlignment alignment(options.alignment);
+    const auto start = juce::Time::getHighResolutionTicks();
+
+    if (! alignment.align(options.score, options.performance))
+    {
+        std::cerr << "Cannot read notes from " << options.score.getFullPathName() << " or "
+                  << options.performance.getFullPathName() << "\n";
+        return 1;
+    }
+
+    const auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    const auto& score = alignment.getScore();
+    const auto& performance = alignment.getPerformance();
+    const auto matched = alignment.getNumMatched();
+
+    const auto notesFile = options.outputDirectory.getChildFile("notes.csv");
+    const auto tempoFile = options.outputDirectory.getChildFile("tempo.csv");
+    if (! alignment.writeNotes(notesFile) || ! alignment.writeTempo(tempoFile))
+    {
+        std::cerr << "Cannot write to " << options.outputDirectory.getFullPathName() << "\n";
+        return 1;
+    }
+
+    std::cout << "score chords       " << score.getNumChords() << " (" << (int) score.notes.size() << " notes)\n"
+              << "performed chords   " << performance.getNumChords() << " (" << (int) performance.notes.size() << " notes)\n"
+              << "cells              " << (juce::int64) score.getNumChords() * performance.getNumChords() << "\n"
+              << "path length        " << (int) alignment.getChordPath().size() << "\n"
+              << "matched notes      " << matched << "\n"
+              << "missed notes       " << (int) score.notes.size() - matched << "\n"
+              << "extra notes        " << (int) performance.notes.size() - matched << "\n"
+              << "tempo points       " << (int) alignment.getTempoCurve().size() << "\n"
+              << "seconds            " << juce::String(seconds, 3) << "\n";
+
+    return 0;
+}
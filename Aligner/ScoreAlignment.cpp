@@ -0,0 +1,235 @@
+/*
+  ==============================================================================
+
+    ScoreAlignment.cpp
+    Note-level alignment of a whole performance to its score, and the tempo curve it implies.
+
+  ==============================================================================
+*/
+
+#include "ScoreAlignment.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool NoteSequence::read(const juce::File& midiFile, double chordSeconds)
+{
+    notes.clear();
+    chordStarts.clear();
+
+    juce::FileInputStream stream(midiFile);
+    juce::MidiFile midi;
+
+    if (! stream.openedOk() || ! midi.readFrom(stream))
+        return false;
+
+    midi.convertTimestampTicksToSeconds();
+
+    for (int t = 0; t < midi.getNumTracks(); ++t)
+        for (const auto* holder : *midi.getTrack(t))
+            if (holder->message.isNoteOn())
+                notes.push_back({ holder->message.getTimeStamp(), holder->message.getNoteNumber(), (int) holder->message.getVelocity() });
+
+    std::sort(notes.begin(), notes.end(), [] (const Note& a, const Note& b)
+    {
+        return a.seconds != b.seconds ? a.seconds < b.seconds : a.pitch < b.pitch;
+    });
+
+    for (size_t n = 0; n < notes.size(); ++n)
+        if (chordStarts.empty() || notes[n].seconds - notes[(size_t) chordStarts.back()].seconds > chordSeconds)
+            chordStarts.push_back((int) n);
+
+    chordStarts.push_back((int) notes.size());
+    return ! notes.empty();
+}
+
+FeatureSequence NoteSequence::getFeatures() const
+{
+    std::vector<FeatureSequence::Vector> profiles((size_t) getNumChords());
+
+    for (int c = 0; c < getNumChords(); ++c)
+    {
+        auto& profile = profiles[(size_t) c];
+        profile.fill(0.0f);
+
+        for (int n = chordStarts[(size_t) c]; n < chordStarts[(size_t) c + 1]; ++n)
+        {
+            const auto pitch = notes[(size_t) n].pitch;
+            profile[(size_t) (pitch % 12)] += 1.0f;
+            profile[(size_t) (12 + juce::jlimit(0, 3, (pitch - 36) / 12))] += 0.5f;
+        }
+
+        float squares = 0.0f;
+        for (auto value : profile)
+            squares += value * value;
+
+        for (auto& value : profile)
+            value /= std::sqrt(squares);
+    }
+
+    return FeatureSequence(profiles);
+}
+
+//==============================================================================
+bool ScoreAlignment::align(const juce::File& scoreFile, const juce::File& performanceFile)
+{
+    if (! score.read(scoreFile, settings.chordSeconds) || ! performance.read(performanceFile, settings.chordSeconds))
+        return false;
+
+    tempoMap = ScoreTempoMap::fromFile(scoreFile);
+    chordPath = HirschbergDtw(settings.dtw).align(score.getFeatures(), performance.getFeatures());
+
+    matchNotes();
+    buildTempoCurve();
+    return true;
+}
+
+int ScoreAlignment::getNumMatched() const noexcept
+{
+    return (int) std::count_if(matches.begin(), matches.end(), [] (const Match& m) { return m.scoreNote >= 0 && m.performanceNote >= 0; });
+}
+
+void ScoreAlignment::matchNotes()
+{
+    matches.clear();
+
+    // The performance chords each score chord is aligned to: a contiguous range, as the path is monotonic
+    std::vector<int> firstChord((size_t) score.getNumChords(), performance.getNumChords()), lastChord((size_t) score.getNumChords(), -1);
+    for (const auto& cell : chordPath)
+    {
+        firstChord[(size_t) cell.row] = juce::jmin(firstChord[(size_t) cell.row], cell.col);
+        lastChord[(size_t) cell.row] = juce::jmax(lastChord[(size_t) cell.row], cell.col);
+    }
+
+    std::vector<bool> used(performance.notes.size(), false);
+
+    // The first unused note of `pitch` in performance chords first to last
+    const auto find = [&] (int pitch, int first, int last)
+    {
+        first = juce::jmax(0, first);
+        last = juce::jmin(performance.getNumChords() - 1, last);
+
+        if (first <= last)
+            for (int n = performance.chordStarts[(size_t) first]; n < performance.chordStarts[(size_t) last + 1]; ++n)
+                if (! used[(size_t) n] && performance.notes[(size_t) n].pitch == pitch)
+                    return n;
+
+        return -1;
+    };
+
+    for (int c = 0; c < score.getNumChords(); ++c)
+    {
+        for (int n = score.chordStarts[(size_t) c]; n < score.chordStarts[(size_t) c + 1]; ++n)
+        {
+            const auto pitch = score.notes[(size_t) n].pitch;
+            auto match = find(pitch, firstChord[(size_t) c], lastChord[(size_t) c]);
+            if (match < 0)
+                match = find(pitch, firstChord[(size_t) c] - 1, lastChord[(size_t) c] + 1);
+
+            if (match >= 0)
+                used[(size_t) match] = true;
+
+            matches.push_back({ n, match });
+        }
+    }
+
+    for (size_t n = 0; n < used.size(); ++n)
+        if (! used[n])
+            matches.push_back({ -1, (int) n });
+}
+
+void ScoreAlignment::buildTempoCurve()
+{
+    tempoCurve.clear();
+
+    // Score notes come first in `matches`, chord by chord
+    size_t m = 0;
+    for (int c = 0; c < score.getNumChords(); ++c)
+    {
+        double performed = 0.0;
+        int numMatched = 0;
+
+        for (; m < matches.size() && matches[m].scoreNote >= 0 && matches[m].scoreNote < score.chordStarts[(size_t) c + 1]; ++m)
+        {
+            if (matches[m].performanceNote >= 0)
+            {
+                performed += performance.notes[(size_t) matches[m].performanceNote].seconds;
+                ++numMatched;
+            }
+        }
+
+        if (numMatched == 0)
+            continue;
+
+        performed /= numMatched;
+        if (! tempoCurve.empty() && performed <= tempoCurve.back().performanceSeconds)
+            continue;
+
+        const auto seconds = score.getChordSeconds(c);
+        tempoCurve.push_back({ tempoMap.secondsToBeats(seconds), seconds, performed, 0.0 });
+    }
+
+    // The tempo over the points within half a window either side, or the neighbours if there are none
+    const auto halfWindow = 0.5 * settings.tempoWindowBeats;
+    size_t first = 0, last = 0;
+
+    for (size_t p = 0; p < tempoCurve.size(); ++p)
+    {
+        while (tempoCurve[first].beat < tempoCurve[p].beat - halfWindow)
+            ++first;
+        while (last + 1 < tempoCurve.size() && tempoCurve[last + 1].beat <= tempoCurve[p].beat + halfWindow)
+            ++last;
+
+        auto from = first, to = last;
+        if (from == to)
+        {
+            from = from > 0 ? from - 1 : from;
+            to = to + 1 < tempoCurve.size() ? to + 1 : to;
+        }
+
+        const auto beats = tempoCurve[to].beat - tempoCurve[from].beat;
+        const auto seconds = tempoCurve[to].performanceSeconds - tempoCurve[from].performanceSeconds;
+        tempoCurve[p].bpm = seconds > 0.0 ? 60.0 * beats / seconds : 0.0;
+    }
+}
+
+bool ScoreAlignment::writeNotes(const juce::File& file) const
+{
+    juce::String csv("score_seconds,score_beat,pitch,performance_seconds,velocity,kind\n");
+
+    for (const auto& match : matches)
+    {
+        if (match.scoreNote >= 0)
+        {
+            const auto& note = score.notes[(size_t) match.scoreNote];
+            csv << juce::String(note.seconds, 4) << "," << juce::String(tempoMap.secondsToBeats(note.seconds), 4) << "," << note.pitch << ",";
+        }
+        else
+        {
+            csv << ",," << performance.notes[(size_t) match.performanceNote].pitch << ",";
+        }
+
+        if (match.performanceNote >= 0)
+        {
+            const auto& note = performance.notes[(size_t) match.performanceNote];
+            csv << juce::String(note.seconds, 4) << "," << note.velocity << "," << (match.scoreNote >= 0 ? "matched" : "extra") << "\n";
+        }
+        else
+        {
+            csv << ",,missed\n";
+        }
+    }
+
+    return file.replaceWithText(csv, false, false, "\n");
+}
+
+bool ScoreAlignment::writeTempo(const juce::File& file) const
+{
+    juce::String csv("beat,score_seconds,performance_seconds,bpm\n");
+
+    for (const auto& point : tempoCurve)
+        csv << juce::String(point.beat, 4) << "," << juce::String(point.scoreSeconds, 4) << ","
+            << juce::String(point.performanceSeconds, 4) << "," << juce::String(point.bpm, 2) << "\n";
+
+    return file.replaceWithText(csv, false, false, "\n");
+}
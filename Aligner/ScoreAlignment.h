@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    ScoreAlignment.h
+    Note-level alignment of a whole performance to its score, and the tempo curve it implies.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "HirschbergDtw.h"
+#include "ScoreTempoMap.h"
+
+#include <vector>
+
+/** The notes of a MIDI file in onset order, grouped into chords of near-simultaneous onsets. */
+struct NoteSequence
+{
+    struct Note
+    {
+        double seconds;
+        int pitch, velocity;
+    };
+
+    std::vector<Note> notes;         // by onset, then pitch
+    std::vector<int> chordStarts;    // index of each chord's first note, and notes.size() at the end
+
+    /** Reads every note-on of `midiFile`; a chord gathers the onsets within `chordSeconds` of its first. */
+    bool read(const juce::File& midiFile, double chordSeconds);
+
+    int getNumChords() const noexcept  { return juce::jmax(0, (int) chordStarts.size() - 1); }
+    double getChordSeconds(int chord) const noexcept  { return notes[(size_t) chordStarts[(size_t) chord]].seconds; }
+
+    /**
+     * A profile per chord: its pitch classes (12) and how many of its notes sit in each of four registers,
+     * at half weight, scaled to unit length.
+     */
+    FeatureSequence getFeatures() const;
+};
+
+/**
+ * @brief Aligns a recorded performance to its score, note by note.
+ *
+ * The chords of the score and of the performance are aligned by HirschbergDtw on their pitch profiles.
+ * Each score note is then matched to the first unused performance note of the same pitch among the
+ * chords aligned to its own, widened by one chord either side to forgive chords split or merged by a
+ * spread onset. Score notes left over were missed; performance notes left over are extra.
+ *
+ * The tempo curve follows from the matched onsets: for every score chord with a match, its score beat
+ * and its performed time (the mean of its matched onsets), and the tempo over the `tempoWindowBeats`
+ * of score around it. Chords performed no later than the one before are left out, so the curve never
+ * runs backwards.
+ */
+class ScoreAlignment
+{
+public:
+    struct Settings
+    {
+        double chordSeconds = 0.03;
+        double tempoWindowBeats = 2.0;
+        HirschbergDtw::Settings dtw;
+    };
+
+    struct Match
+    {
+        int scoreNote;        // -1 for an extra performance note
+        int performanceNote;  // -1 for a missed score note
+    };
+
+    struct TempoPoint
+    {
+        double beat, scoreSeconds, performanceSeconds, bpm;
+    };
+
+    explicit ScoreAlignment(const Settings& newSettings) : settings(newSettings) {}
+
+    /** Reads both files and aligns them; false if either cannot be read or has no notes. */
+    bool align(const juce::File& scoreFile, const juce::File& performanceFile);
+
+    const NoteSequence& getScore() const noexcept        { return score; }
+    const NoteSequence& getPerformance() const noexcept  { return performance; }
+    const std::vector<HirschbergDtw::Cell>& getChordPath() const noexcept  { return chordPath; }
+
+    /** Every score note in order, then the extra performance notes in order. */
+    const std::vector<Match>& getMatches() const noexcept  { return matches; }
+    const std::vector<TempoPoint>& getTempoCurve() const noexcept  { return tempoCurve; }
+
+    int getNumMatched() const noexcept;
+
+    /** CSV: score_seconds,score_beat,pitch,performance_seconds,velocity,kind (matched, missed or extra). */
+    bool writeNotes(const juce::File& file) const;
+
+    /** CSV: beat,score_seconds,performance_seconds,bpm. */
+    bool writeTempo(const juce::File& file) const;
+
+private:
+    void matchNotes();
+    void buildTempoCurve();
+
+    Settings settings;
+    NoteSequence score, performance;
+    ScoreTempoMap tempoMap;
+    std::vector<HirschbergDtw::Cell> chordPath;
+    std::vector<Match> matches;
+    std::vector<TempoPoint> tempoCurve;
+};
@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+
+    Benchmark.h
+    Minimal self-registering benchmark base, in the style of juce::UnitTest.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+
+/**
+ * @brief Base class for benchmarks. Create a static instance of a subclass to register it.
+ *
+ * Each benchmark reports one line per case with the time per unit of work (a sample, a voice-sample,
+ * an event, ...), measured over enough iterations to fill `minimumSeconds` after a short warm-up, and
+ * the heap allocations per iteration (counted by the global operator new in Main.cpp).
+ */
+class Benchmark
+{
+public:
+    explicit Benchmark(const juce::String& benchmarkName) : name(benchmarkName)
+    {
+        getAllBenchmarks().add(this);
+    }
+
+    virtual ~Benchmark()
+    {
+        getAllBenchmarks().removeFirstMatchingValue(this);
+    }
+
+    const juce::String& getName() const noexcept  { return name; }
+
+    virtual void run() = 0;
+
+    static juce::Array<Benchmark*>& getAllBenchmarks()
+    {
+        static juce::Array<Benchmark*> benchmarks;
+        return benchmarks;
+    }
+
+    static double minimumSeconds;
+
+    /** Heap allocations made by the process so far. */
+    static std::atomic<std::int64_t> allocations;
+
+    /** Accumulates the time and allocations of the calls it wraps, to time one stage of a larger loop. */
+    struct Stopwatch
+    {
+        template <typename Fn>
+        void time(Fn&& fn)
+        {
+            const auto allocationsBefore = allocations.load(std::memory_order_relaxed);
+            const auto start = juce::Time::getHighResolutionTicks();
+            fn();
+            ticks += juce::Time::getHighResolutionTicks() - start;
+            allocated += allocations.load(std::memory_order_relaxed) - allocationsBefore;
+            ++calls;
+        }
+
+        double getSeconds() const  { return (double) ticks / (double) juce::Time::getHighResolutionTicksPerSecond(); }
+
+        juce::int64 ticks = 0;
+        std::int64_t allocated = 0;
+        std::int64_t calls = 0;
+    };
+
+protected:
+    /**
+     * @brief Times `fn` and prints the cost per unit of work.
+     *
+     * @param caseName Printed after the benchmark name.
+     * @param unitsPerIteration How many units of work one call to `fn` does.
+     * @param unitName The unit the result is reported in, e.g. "voice-sample".
+     * @return Nanoseconds per unit.
+     */
+    template <typename Fn>
+    double measure(const juce::String& caseName, double unitsPerIteration, const juce::String& unitName, Fn&& fn)
+    {
+        for (int i = 0; i < 3; ++i)
+            fn();
+
+        const auto ticksPerSecond = (double) juce::Time::getHighResolutionTicksPerSecond();
+        const auto allocationsBefore = allocations.load(std::memory_order_relaxed);
+        const auto start = juce::Time::getHighResolutionTicks();
+        juce::int64 iterations = 0;
+        double elapsed = 0.0;
+
+        do
+        {
+            fn();
+            ++iterations;
+            elapsed = (double) (juce::Time::getHighResolutionTicks() - start) / ticksPerSecond;
+        }
+        while (elapsed < minimumSeconds || iterations < 10);
+
+        const auto allocated = allocations.load(std::memory_order_relaxed) - allocationsBefore;
+        const double nsPerUnit = elapsed * 1.0e9 / ((double) iterations * unitsPerIteration);
+
+        print(caseName, nsPerUnit, unitName, (double) allocated / (double) iterations);
+        return nsPerUnit;
+    }
+
+    /**
+     * @brief Prints the cost per unit of work of a stage timed with a Stopwatch.
+     *
+     * @param units How many units of work all the timed calls did together.
+     * @return Nanoseconds per unit.
+     */
+    double report(const juce::String& caseName, const Stopwatch& stopwatch, double units, const juce::String& unitName)
+    {
+        const double nsPerUnit = units > 0.0 ? stopwatch.getSeconds() * 1.0e9 / units : 0.0;
+        print(caseName, nsPerUnit, unitName, stopwatch.calls > 0 ? (double) stopwatch.allocated / (double) stopwatch.calls : 0.0);
+        return nsPerUnit;
+    }
+
+    /** Prints a free-form result line, e.g. a speedup. */
+    void report(const juce::String& caseName, const juce::String& value)
+    {
+        std::cout << std::left << std::setw(52) << (name + " / " + caseName).toStdString()
+                  << std::right << std::setw(12) << value << std::endl;
+    }
+
+private:
+    void print(const juce::String& caseName, double nsPerUnit, const juce::String& unitName, double allocationsPerIteration)
+    {
+        std::cout << std::left << std::setw(52) << (name + " / " + caseName).toStdString()
+                  << std::right << std::setw(12) << std::fixed << std::setprecision(2) << nsPerUnit
+                  << " ns/" << std::left << std::setw(14) << unitName.toStdString()
+                  << std::right << std::setw(10) << std::setprecision(2) << allocationsPerIteration
+                  << " allocs/call" << std::endl;
+    }
+
+    juce::String name;
+
+    JUCE_DECLARE_NON_COPYABLE(Benchmark)
+};
@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Runs the registered benchmarks.
+
+    Usage: MidiPredictBenchmarks [--seconds <s>] [name-filter ...]
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+
+#include <cstdlib>
+#include <new>
+
+double Benchmark::minimumSeconds = 0.5;
+std::atomic<std::int64_t> Benchmark::allocations { 0 };
+
+// Counts every heap allocation, so that each benchmark can report how many its hot path makes
+void* operator new (std::size_t size)
+{
+    Benchmark::allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (auto* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size)
+{
+    return operator new (size);
+}
+
+void operator delete (void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[] (void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete (void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[] (void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char* argv[])
+{
+    juce::StringArray filters;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const juce::String arg(argv[i]);
+
+        if (arg == "--seconds" && i + 1 < argc)
+            Benchmark::minimumSeconds = juce::String(argv[++i]).getDoubleValue();
+        else
+            filters.add(arg);
+    }
+
+    for (auto* benchmark : Benchmark::getAllBenchmarks())
+    {
+        bool selected = filters.isEmpty();
+        for (const auto& filter : filters)
+            selected = selected || benchmark->getName().containsIgnoreCase(filter);
+
+        if (selected)
+            benchmark->run();
+    }
+
+    return 0;
+}
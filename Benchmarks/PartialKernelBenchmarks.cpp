@@ -0,0 +1,130 @@
+/*
+  ==============================================================================
+
+    PartialKernelBenchmarks.cpp
+    PartialBank kernels specialised on lane count and envelope against the generic loop.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+#include "PartialBank.h"
+
+#include <cmath>
+
+namespace
+{
+    constexpr double kernelSampleRate = 48000.0;
+    constexpr int kernelBlockSize = 512;
+
+    PartialBank makeBank(int numLanes)
+    {
+        PartialBank bank;
+        bank.setSampleRate(kernelSampleRate);
+        bank.setNumActivePartials(numLanes);
+
+        for (int i = 0; i < PartialBank::maxPartials; ++i)
+        {
+            bank.setFrequency(i, 220.0 * (i + 1));
+            bank.setGain(i, 1.0f / float ((i + 1) * (i + 1)));
+        }
+
+        return bank;
+    }
+
+    juce::ADSR makeEnvelope()
+    {
+        juce::ADSR adsr;
+        adsr.setSampleRate(kernelSampleRate);
+        adsr.setParameters({ 0.5f, 0.5f, 0.5f, 0.5f });
+        adsr.noteOn();
+        return adsr;
+    }
+
+    /** Runs an ADSR into its sustain stage, where it repeats one value. */
+    void settle(juce::ADSR& adsr)
+    {
+        for (int i = 0; i < (int) kernelSampleRate + 2; ++i)
+            adsr.getNextSample();
+    }
+}
+
+class PartialKernelBenchmark : public Benchmark
+{
+public:
+    PartialKernelBenchmark() : Benchmark("Partial kernels") {}
+
+    void run() override
+    {
+        runLanes<PartialBank::maxPartials / 2>();
+        runLanes<PartialBank::maxPartials>();
+    }
+
+private:
+    template <int numLanes>
+    void runLanes()
+    {
+        std::vector<float> out((size_t) kernelBlockSize), reference((size_t) kernelBlockSize);
+        const auto lanes = juce::String(numLanes) + " partials";
+
+        // Attack stage: the envelope changes every sample, so both paths call it every sample
+        {
+            auto bank = makeBank(numLanes);
+            auto adsr = makeEnvelope();
+
+            const auto generic = measure(lanes + ", ADSR, generic", kernelBlockSize, "sample", [&]
+            {
+                adsr.noteOn();
+                bank.renderGeneric(out.data(), kernelBlockSize, adsr, 0.5f, 0.5f);
+            });
+
+            const auto specialised = measure(lanes + ", ADSR, specialised", kernelBlockSize, "sample", [&]
+            {
+                adsr.noteOn();
+                bank.renderLanes<numLanes>(out.data(), kernelBlockSize, adsr, 0.5f, 0.5f);
+            });
+
+            report(lanes + ", ADSR, speedup", juce::String(generic / specialised, 2) + "x");
+
+            auto first = makeBank(numLanes), second = makeBank(numLanes);
+            auto firstEnvelope = makeEnvelope(), secondEnvelope = makeEnvelope();
+            first.renderGeneric(reference.data(), kernelBlockSize, firstEnvelope, 0.5f, 0.5f);
+            second.renderLanes<numLanes>(out.data(), kernelBlockSize, secondEnvelope, 0.5f, 0.5f);
+            report(lanes + ", ADSR, output", out == reference ? "identical" : "DIFFERS");
+        }
+
+        // Sustain stage: the generic loop still calls the ADSR, the specialised one folds it into the gain
+        {
+            auto bank = makeBank(numLanes);
+            auto adsr = makeEnvelope();
+            settle(adsr);
+            const auto level = adsr.getNextSample();
+            PartialBank::ConstantEnvelope constant;
+
+            const auto generic = measure(lanes + ", sustain, generic", kernelBlockSize, "sample", [&]
+            {
+                bank.renderGeneric(out.data(), kernelBlockSize, adsr, 0.5f, 0.5f);
+            });
+
+            const auto specialised = measure(lanes + ", sustain, specialised", kernelBlockSize, "sample", [&]
+            {
+                bank.renderLanes<numLanes>(out.data(), kernelBlockSize, constant, 0.5f * level, 0.5f * level);
+            });
+
+            report(lanes + ", sustain, speedup", juce::String(generic / specialised, 2) + "x");
+
+            // Folding the envelope into the gain changes the rounding, not the signal
+            auto first = makeBank(numLanes), second = makeBank(numLanes);
+            first.renderGeneric(reference.data(), kernelBlockSize, adsr, 0.5f, 0.5f);
+            second.renderLanes<numLanes>(out.data(), kernelBlockSize, constant, 0.5f * level, 0.5f * level);
+
+            float maxError = 0.0f;
+            for (size_t i = 0; i < out.size(); ++i)
+                maxError = juce::jmax(maxError, std::abs(out[i] - reference[i]));
+
+            report(lanes + ", sustain, max difference", juce::String(maxError, 9));
+        }
+    }
+};
+
+static PartialKernelBenchmark partialKernelBenchmark;
@@ -0,0 +1,341 @@
+/*
+  ==============================================================================
+
+    ProcessorBenchmarks.cpp
+    PluginProcessor hot paths: MIDI file reading, the follower's matching and tempo stages, the
+    prediction, the route merge and whole processBlock calls, on the bundled MIDI files and on a
+    synthetic dense score; and a half-hour generated performance at 20 notes per second.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+#include "ProcessorFixtures.h"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr double processorSampleRate = 48000.0;
+    constexpr int processorBlockSize = 512;
+
+    using ProcessorFixtures::Fixture;
+
+    /**
+     * Writes `notesPerSecond` onsets of three-note chords over `seconds`, in milliseconds. With `jitter`,
+     * every onset moves by up to that many milliseconds, as a performance of the same score would.
+     */
+    void writeDenseScore(const juce::File& file, double seconds, double notesPerSecond, int jitter)
+    {
+        juce::Random random(4242);
+        juce::Random timing(jitter);
+        juce::MidiMessageSequence track;
+
+        for (double t = 0.0; t < 1000.0 * seconds; t += 3000.0 / notesPerSecond)
+        {
+            const auto root = 36 + random.nextInt(48);
+            const auto onset = juce::jmax(0.0, t + (jitter > 0 ? timing.nextInt(2 * jitter + 1) - jitter : 0));
+
+            for (int interval : { 0, 4, 7 })
+            {
+                track.addEvent(juce::MidiMessage::noteOn(1, root + interval, (juce::uint8) 90), onset);
+                track.addEvent(juce::MidiMessage::noteOff(1, root + interval), onset + 150.0);
+            }
+        }
+
+        track.updateMatchedPairs();
+
+        juce::MidiFile midi;
+        midi.setSmpteTimeFormat(25, 40);
+        midi.addTrack(track);
+
+        file.deleteFile();
+        juce::FileOutputStream stream(file);
+        midi.writeTo(stream);
+    }
+
+    int countNotes(const MidiEventList& events)
+    {
+        return (int) std::count_if(events.begin(), events.end(), [] (const MidiEvent& e) { return e.isNoteOnOrOff(); });
+    }
+
+    int countNotes(const std::vector<MidiEventList>& blocks)
+    {
+        int count = 0;
+        for (const auto& block : blocks)
+            count += countNotes(block);
+        return count;
+    }
+}
+
+class ProcessorBenchmark : public Benchmark
+{
+public:
+    ProcessorBenchmark() : Benchmark("Processor") {}
+
+    void run() override
+    {
+        const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+        juce::TemporaryFile denseScore(".mid"), densePerformance(".mid");
+        writeDenseScore(denseScore.getFile(), 30.0, 60.0, 0);
+        writeDenseScore(densePerformance.getFile(), 30.0, 60.0, 20);
+
+        const Fixture fixtures[] = {
+            ProcessorFixtures::getPausedFixture(),
+            { "dense", denseScore.getFile(), densePerformance.getFile() }
+        };
+
+        for (const auto& fixture : fixtures)
+        {
+            if (! fixture.score.existsAsFile() || ! fixture.performance.existsAsFile())
+            {
+                report(fixture.name, "missing");
+                continue;
+            }
+
+            runFileReading(fixture);
+            runMatching(fixture);
+            runSession(fixture);
+            runRouter(fixture);
+        }
+
+        for (double sampleRate : { 44100.0, 48000.0, 96000.0 })
+            for (int blockSize : { 64, 256, 512, 1024 })
+                runProcessBlock(fixtures[0], sampleRate, blockSize);
+
+        juce::TemporaryFile twentyPerSecond(".mid");
+        writeDenseScore(twentyPerSecond.getFile(), 60.0, 20.0, 0);
+        runGeneratedSession({ "generated", twentyPerSecond.getFile(), twentyPerSecond.getFile() });
+    }
+
+private:
+    void runFileReading(const Fixture& fixture)
+    {
+        const auto numEvents = (double) readMIDIFile(fixture.score, processorSampleRate).size();
+
+        measure(fixture.name + ", readMIDIFile (index)", numEvents, "event", [&]
+        {
+            readMIDIFile(fixture.score, processorSampleRate, 0.5);
+        });
+
+        measure(fixture.name + ", readMIDIFile (blocks)", numEvents, "event", [&]
+        {
+            readMIDIFile(fixture.score, processorSampleRate, processorBlockSize, -1, 0.5);
+        });
+    }
+
+    /** The matching and tempo stages on their own, with the score both as prediction and as performance. */
+    void runMatching(const Fixture& fixture)
+    {
+        PluginProcessor processor;
+        ProcessorFixtures::prepare(processor, fixture, processorSampleRate, processorBlockSize);
+
+        const auto blocks = readMIDIFile(fixture.score, processorSampleRate, processorBlockSize);
+        const MidiEventList none;
+
+        // The performer exactly with the prediction, and 4 blocks behind it
+        for (int delay : { 0, 4 })
+        {
+            const auto caseName = fixture.name + ", checkIfPause, " + (delay == 0 ? "in time" : "4 blocks late");
+            measure(caseName, (double) countNotes(blocks) * 2, "event", [&]
+            {
+                for (size_t b = 0; b < blocks.size(); ++b)
+                    processor.checkIfPause(blocks[b], b >= (size_t) delay ? blocks[b - (size_t) delay] : none, processorBlockSize);
+            });
+        }
+
+        measure(fixture.name + ", updateNoteDensity", (double) blocks.size(), "block", [&]
+        {
+            for (const auto& block : blocks)
+                processor.updateNoteDensity(block, block);
+        });
+
+        // searchLive drains the live queue, so it is filled again (untimed) before every pass
+        const auto densest = std::max_element(blocks.begin(), blocks.end(),
+                                              [] (const MidiEventList& a, const MidiEventList& b) { return countNotes(a) < countNotes(b); });
+        if (densest != blocks.end() && countNotes(*densest) > 0)
+        {
+            Stopwatch searchLive;
+            while (searchLive.getSeconds() < minimumSeconds)
+            {
+                processor.checkIfPause(none, *densest, processorBlockSize);
+                searchLive.time([&]
+                {
+                    for (const auto& e : *densest)
+                        if (e.isNoteOnOrOff())
+                            processor.searchLive(e);
+                });
+            }
+
+            report(fixture.name + ", searchLive, " + juce::String(countNotes(*densest)) + " queued",
+                   searchLive, (double) searchLive.calls * countNotes(*densest), "event");
+        }
+
+        // At the cursor prepareToPlay leaves, reading what processBlock reads at unit tempo
+        MidiEventList window;
+        window.reserve(MidiEvents::maxEventsPerBlock);
+        const auto score = readMIDIFile(fixture.score, processorSampleRate, 0.5);
+        measure(fixture.name + ", generateMidiBuffer", 1.0, "block", [&]
+        {
+            processor.generateMidiBuffer(score, processorSampleRate, 2 * processorBlockSize, window);
+        });
+
+        processor.releaseResources();
+    }
+
+    /** The follower's stages in order, block after block through the whole performance. */
+    void runSession(const Fixture& fixture)
+    {
+        PluginProcessor processor;
+        ProcessorFixtures::prepare(processor, fixture, processorSampleRate, processorBlockSize);
+
+        const auto performed = readMIDIFile(fixture.performance, processorSampleRate);
+        const int numBlocks = performed.empty() ? 0 : performed.back().sampleTime / processorBlockSize + 1;
+
+        MidiEventList prediction;
+        prediction.reserve(MidiEvents::maxEventsPerBlock);
+        juce::MidiBuffer noMidi;
+        Stopwatch getBuffers, setPredictionVariables, generatePrediction;
+        double predicted = 0.0;
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            bool paused = false;
+            getBuffers.time([&] { processor.getBuffers(processorBlockSize, noMidi); });
+            setPredictionVariables.time([&] { paused = processor.setPredictionVariables(3, processorBlockSize); });
+            generatePrediction.time([&] { processor.generate_prediction(processorBlockSize, paused, prediction); });
+            predicted += (double) prediction.size();
+            processor.advancePrediction(prediction, processorBlockSize, paused);
+        }
+
+        report(fixture.name + ", getBuffers", getBuffers, numBlocks, "block");
+        report(fixture.name + ", setPredictionVariables", setPredictionVariables, numBlocks, "block");
+        report(fixture.name + ", generate_prediction", generatePrediction, numBlocks, "block");
+        report(fixture.name + ", generate_prediction", generatePrediction, predicted, "event");
+
+        processor.releaseResources();
+    }
+
+    /** The router's merge of prediction and live, which replaced combineEvents. */
+    void runRouter(const Fixture& fixture)
+    {
+        const auto prediction = readMIDIFile(fixture.score, processorSampleRate, processorBlockSize);
+        const auto live = readMIDIFile(fixture.performance, processorSampleRate, processorBlockSize);
+        const auto numBlocks = juce::jmin(prediction.size(), live.size());
+
+        MidiRouter router;
+        juce::MidiBuffer output;
+        output.ensureSize(8 * MidiEvents::maxEventsPerBlock);
+        double numEvents = 0.0;
+
+        for (size_t b = 0; b < numBlocks; ++b)
+            numEvents += (double) (prediction[b].size() + live[b].size());
+
+        measure(fixture.name + ", MidiRouter merge", numEvents, "event", [&]
+        {
+            for (size_t b = 0; b < numBlocks; ++b)
+            {
+                router.setSource(MidiRouter::prediction, prediction[b]);
+                router.setSource(MidiRouter::live, live[b]);
+                output.clear();
+                router.merge().addTo(output);
+            }
+        });
+    }
+
+    /** Whole blocks; the session starts again (untimed) when the performance is over. */
+    void runProcessBlock(const Fixture& fixture, double sampleRate, int blockSize)
+    {
+        PluginProcessor processor;
+        ProcessorFixtures::prepare(processor, fixture, sampleRate, blockSize);
+
+        const auto performed = readMIDIFile(fixture.performance, sampleRate);
+        const auto sessionSamples = performed.empty() ? (juce::int64) sampleRate : (juce::int64) performed.back().sampleTime;
+
+        juce::AudioBuffer<float> audio(processor.getTotalNumOutputChannels(), blockSize);
+        juce::MidiBuffer midi;
+        Stopwatch stopwatch;
+        juce::int64 position = 0;
+
+        while (stopwatch.getSeconds() < minimumSeconds)
+        {
+            if (position >= sessionSamples)
+            {
+                processor.releaseResources();
+                processor.prepareToPlay(sampleRate, blockSize);
+                position = 0;
+            }
+
+            audio.clear();
+            midi.clear();
+            stopwatch.time([&] { processor.processBlock(audio, midi); });
+            position += blockSize;
+        }
+
+        const auto caseName = fixture.name + ", processBlock, " + juce::String(sampleRate / 1000.0, 1) + " kHz, " + juce::String(blockSize);
+        const auto nsPerBlock = report(caseName, stopwatch, (double) stopwatch.calls, "block");
+        report(caseName + ", budget", juce::String(100.0 * nsPerBlock * 1.0e-9 * sampleRate / blockSize, 2) + "%");
+
+        processor.releaseResources();
+    }
+
+    /** Thirty minutes of the score played with mistakes, pauses, skips and repeats, generated block by block. */
+    void runGeneratedSession(const Fixture& fixture)
+    {
+        PerformanceGenerator::Settings settings;
+        settings.seed = 2024;
+        settings.lengthSeconds = 1800.0;
+        settings.startTempo = 0.9;
+        settings.endTempo = 1.1;
+        settings.rubatoDepth = 0.1;
+        settings.jitterMs = 20.0;
+        settings.wrongNoteProbability = settings.extraNoteProbability = settings.missingNoteProbability = 0.03;
+        settings.skipProbability = settings.repeatProbability = settings.pauseProbability = 0.05;
+
+        PerformanceGenerator generator;
+        generator.setSettings(settings);
+        generator.prepare(readMIDIFile(fixture.performance, processorSampleRate), processorSampleRate);
+
+        MidiEventList events;
+        events.reserve(MidiEvents::maxEventsPerBlock);
+        Stopwatch generate;
+        double numEvents = 0.0;
+
+        for (std::int64_t end = processorBlockSize; generator.getLengthSamples() > 0; end += processorBlockSize)
+        {
+            events.clear();
+            bool more = true;
+            generate.time([&] { more = generator.generate(end, events); });
+            numEvents += (double) events.size();
+
+            if (! more)
+                break;
+        }
+
+        report(fixture.name + ", PerformanceGenerator", generate, numEvents, "event");
+
+        PluginProcessor processor;
+        processor.setGeneratedPerformance(settings);
+        ProcessorFixtures::prepare(processor, fixture, processorSampleRate, processorBlockSize);
+
+        juce::AudioBuffer<float> audio(processor.getTotalNumOutputChannels(), processorBlockSize);
+        juce::MidiBuffer midi;
+        Stopwatch stopwatch;
+
+        for (std::int64_t position = 0; position < generator.getLengthSamples(); position += processorBlockSize)
+        {
+            audio.clear();
+            midi.clear();
+            stopwatch.time([&] { processor.processBlock(audio, midi); });
+        }
+
+        const auto caseName = fixture.name + ", 30 min, processBlock";
+        const auto nsPerBlock = report(caseName, stopwatch, (double) stopwatch.calls, "block");
+        report(caseName + ", budget", juce::String(100.0 * nsPerBlock * 1.0e-9 * processorSampleRate / processorBlockSize, 2) + "%");
+
+        processor.releaseResources();
+    }
+};
+
+static ProcessorBenchmark processorBenchmark;
@@ -0,0 +1,116 @@
+/*
+  ==============================================================================
+
+    ProcessorFixtures.h
+    The bundled MIDI files as scores and performances, a processor set up to follow one, and a host for
+    FoleysSynth's parameters, for the benchmarks and the CTest suite (see Tests/TestSupport.h).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FoleysSynth.h"
+#include "PluginProcessor.h"
+
+namespace ProcessorFixtures
+{
+    /** A score and the performance that follows it. */
+    struct Fixture
+    {
+        juce::String name;
+        juce::File score, performance;
+    };
+
+    inline juce::File getResources()
+    {
+        return juce::File(MIDIPREDICT_RESOURCES_DIR);
+    }
+
+    /** The bundled score against the performance that pauses, which exercises every follower stage. */
+    inline Fixture getPausedFixture()
+    {
+        return { "ladispute", getResources().getChildFile("ladispute_1.mid"), getResources().getChildFile("ladispute_paused.mid") };
+    }
+
+    /** The score with each of the bundled performances of it. */
+    inline juce::Array<Fixture> getBundledFixtures()
+    {
+        juce::Array<Fixture> fixtures;
+        const auto score = getResources().getChildFile("ladispute_1.mid");
+
+        for (auto name : { "ladispute_1", "ladispute_2", "ladispute_3", "ladispute_4", "ladispute_5", "ladispute_paused" })
+            fixtures.add({ name, score, getResources().getChildFile(juce::String(name) + ".mid") });
+
+        return fixtures;
+    }
+
+    /**
+     * Prepares `processor` to follow the fixture, independent of anything but its inputs: default follower
+     * settings rather than the user's presets, no shared timeline, and the governor held at full quality so
+     * that the machine's load changes neither what the follower does nor which path is timed. Everything
+     * renders on the calling thread, so that its time and allocations are all the caller's.
+     */
+    inline void prepare(PluginProcessor& processor, const Fixture& fixture, double sampleRate, int blockSize, int predictionCase = 3)
+    {
+        processor.setScoreFile(fixture.score);
+        processor.setPerformanceFile(fixture.performance);
+        processor.setPredictionCase(predictionCase);
+        processor.setFollowerSettings(FollowerSettings());
+        processor.setPublishTimeline(false);
+
+        auto governorSettings = processor.getGovernor().getSettings();
+        governorSettings.maxLevel = CpuGovernor::normal;
+        processor.getGovernor().setSettings(governorSettings);
+
+        processor.setParallelRender(false);
+        processor.setVoiceRenderThreads(0);
+
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+    }
+
+    /** The performance's length plus a tail for the prediction to run out, in samples. */
+    inline juce::int64 getSessionSamples(const Fixture& fixture, double sampleRate)
+    {
+        const auto performed = readMIDIFile(fixture.performance, sampleRate);
+        return (performed.empty() ? 0 : (juce::int64) performed.back().sampleTime) + (juce::int64) (2.0 * sampleRate);
+    }
+
+    /** Just enough of a processor to hold the FoleysSynth parameters, for a synth rendered on its own. */
+    class ParameterHost : public juce::AudioProcessor
+    {
+    public:
+        ParameterHost() : state(*this, nullptr, "PARAMETERS", createLayout()) {}
+
+        juce::AudioProcessorValueTreeState state;
+
+        const juce::String getName() const override                         { return "ParameterHost"; }
+        void prepareToPlay(double, int) override                            {}
+        void releaseResources() override                                    {}
+        void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override {}
+        double getTailLengthSeconds() const override                        { return 0.0; }
+        bool acceptsMidi() const override                                   { return false; }
+        bool producesMidi() const override                                  { return false; }
+        bool hasEditor() const override                                     { return false; }
+        juce::AudioProcessorEditor* createEditor() override                 { return nullptr; }
+        int getNumPrograms() override                                       { return 1; }
+        int getCurrentProgram() override                                    { return 0; }
+        void setCurrentProgram(int) override                                {}
+        const juce::String getProgramName(int) override                     { return {}; }
+        void changeProgramName(int, const juce::String&) override           {}
+        void getStateInformation(juce::MemoryBlock&) override               {}
+        void setStateInformation(const void*, int) override                 {}
+
+    private:
+        static juce::AudioProcessorValueTreeState::ParameterLayout createLayout()
+        {
+            juce::AudioProcessorValueTreeState::ParameterLayout layout;
+            FoleysSynth::addADSRParameters(layout);
+            FoleysSynth::addOvertoneParameters(layout);
+            FoleysSynth::addGainParameters(layout);
+            return layout;
+        }
+    };
+}
@@ -0,0 +1,167 @@
+/*
+  ==============================================================================
+
+    SynthBenchmarks.cpp
+    Sine synth render cost: SineWaveVoice under juce::Synthesiser against SineBankSynth,
+    and the voice pool under dense polyphony.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+#include "SineWaveVoice.cpp"
+#include "SineBankSynth.h"
+
+namespace
+{
+    constexpr double benchSampleRate = 48000.0;
+    constexpr int benchBlockSize = 512;
+
+    /**
+     * Dense synthetic material, already split into blocks with block-relative times: `notesPerSecond`
+     * onsets with random pitch and velocity, durations from 0.1 to 4 seconds, and the sustain pedal
+     * held for 1.5 of every 2 seconds.
+     */
+    std::vector<MidiEventList> makeDenseMaterial(double seconds, double notesPerSecond, int blockSize)
+    {
+        juce::Random random(31337);
+        MidiEventList events;
+
+        const auto totalSamples = (int) (seconds * benchSampleRate);
+        const auto onsetSpacing = benchSampleRate / notesPerSecond;
+
+        for (double t = 0.0; t < totalSamples; t += onsetSpacing * (0.5 + random.nextDouble()))
+        {
+            const auto noteNumber = (std::uint8_t) (28 + random.nextInt(72));
+            const auto length = (int) ((0.1 + 3.9 * random.nextDouble()) * benchSampleRate);
+            events.push_back(MidiEvent::make((int) t, 0x90, noteNumber, (std::uint8_t) (30 + random.nextInt(97)), MidiEvent::score));
+            events.push_back(MidiEvent::make((int) t + length, 0x80, noteNumber, 0, MidiEvent::score));
+        }
+
+        for (int pedal = 0; pedal < totalSamples; pedal += (int) (2.0 * benchSampleRate))
+        {
+            events.push_back(MidiEvent::make(pedal, 0xb0, 0x40, 127, MidiEvent::score));
+            events.push_back(MidiEvent::make(pedal + (int) (1.5 * benchSampleRate), 0xb0, 0x40, 0, MidiEvent::score));
+        }
+
+        std::stable_sort(events.begin(), events.end(), MidiEvents::earlier);
+
+        std::vector<MidiEventList> blocks((size_t) (totalSamples / blockSize));
+        for (auto e : events)
+        {
+            const auto block = (size_t) (e.sampleTime / blockSize);
+            if (block >= blocks.size())
+                break;
+            e.sampleTime -= (int) block * blockSize;
+            blocks[block].push_back(e);
+        }
+
+        return blocks;
+    }
+
+    /** Every voice gets its own note/channel pair, so nothing is retriggered or stolen. */
+    template <typename NoteOn>
+    void startVoices(int numVoices, NoteOn&& noteOn)
+    {
+        for (int v = 0; v < numVoices; ++v)
+            noteOn(1 + v / 96, 24 + v % 96, 0.8f);
+    }
+}
+
+class SineSynthBenchmark : public Benchmark
+{
+public:
+    SineSynthBenchmark() : Benchmark("Sine synth") {}
+
+    void run() override
+    {
+        for (int numVoices : { 4, 32, 128 })
+        {
+            const auto units = (double) numVoices * benchBlockSize;
+            juce::AudioBuffer<float> output(2, benchBlockSize);
+            juce::MidiBuffer noMidi;
+
+            juce::Synthesiser reference;
+            for (int v = 0; v < numVoices; ++v)
+                reference.addVoice(new SineWaveVoice());
+            reference.addSound(new SineWaveSound());
+            reference.setCurrentPlaybackSampleRate(benchSampleRate);
+            startVoices(numVoices, [&](int ch, int note, float vel) { reference.noteOn(ch, note, vel); });
+
+            const auto before = measure("SineWaveVoice, " + juce::String(numVoices) + " voices", units, "voice-sample", [&]
+            {
+                output.clear();
+                reference.renderNextBlock(output, noMidi, 0, benchBlockSize);
+            });
+
+            SineBankSynth bank;
+            bank.setNumVoices(numVoices);
+            bank.setCurrentPlaybackSampleRate(benchSampleRate);
+            startVoices(numVoices, [&](int ch, int note, float vel) { bank.noteOn(ch, note, vel); });
+
+            const auto after = measure("SineBankSynth, " + juce::String(numVoices) + " voices", units, "voice-sample", [&]
+            {
+                output.clear();
+                bank.renderNextBlock(output, noMidi, 0, benchBlockSize);
+            });
+
+            report("speedup, " + juce::String(numVoices) + " voices", juce::String(before / after, 1) + "x");
+        }
+    }
+};
+
+static SineSynthBenchmark sineSynthBenchmark;
+
+//==============================================================================
+class VoicePoolBenchmark : public Benchmark
+{
+public:
+    VoicePoolBenchmark() : Benchmark("Voice pool") {}
+
+    void run() override
+    {
+        constexpr int blockSize = 256;
+        const auto material = makeDenseMaterial(5.0, 20.0, blockSize);
+        const auto units = (double) material.size() * blockSize;
+
+        juce::AudioBuffer<float> output(2, blockSize);
+        MidiRouter router;
+        SineBankSynth bank;
+        bank.setCurrentPlaybackSampleRate(benchSampleRate);
+
+        const std::pair<SineBankSynth::StealPolicy, const char*> policies[] = {
+            { SineBankSynth::StealPolicy::oldest,    "oldest" },
+            { SineBankSynth::StealPolicy::quietest,  "quietest" },
+            { SineBankSynth::StealPolicy::samePitch, "same pitch" }
+        };
+
+        for (int polyphony : { 16, 64, 256 })
+        {
+            for (const auto& policy : policies)
+            {
+                bank.setNumVoices(polyphony);
+                bank.setStealPolicy(policy.first);
+
+                const auto caseName = juce::String(polyphony) + " voices, " + policy.second;
+
+                measure(caseName, units, "sample", [&]
+                {
+                    bank.allNotesOff(0, false);
+                    bank.resetStatistics();
+
+                    for (const auto& block : material)
+                    {
+                        output.clear();
+                        router.setSource(MidiRouter::prediction, block);
+                        bank.renderNextBlock(output, router.merge(), 0, blockSize);
+                    }
+                });
+
+                const auto stealRate = (double) bank.getNumVoicesStolen() / (double) juce::jmax((std::uint64_t) 1, bank.getNumNotesStarted());
+                report(caseName + ", steal rate", juce::String(100.0 * stealRate, 1) + "%");
+            }
+        }
+    }
+};
+
+static VoicePoolBenchmark voicePoolBenchmark;
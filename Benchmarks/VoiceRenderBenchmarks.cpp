@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    VoiceRenderBenchmarks.cpp
+    FoleysSynth voice rendering on a RenderPool, from one to all cores.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+#include "ProcessorFixtures.h"
+#include "RenderPool.h"
+
+#include <cstring>
+
+namespace
+{
+    constexpr double voiceSampleRate = 48000.0;
+    constexpr int voiceBlockSize = 64;
+}
+
+class VoiceRenderBenchmark : public Benchmark
+{
+public:
+    VoiceRenderBenchmark() : Benchmark("FoleysSynth voice render") {}
+
+    void run() override
+    {
+        ProcessorFixtures::ParameterHost host;
+        constexpr int numVoices = 128;
+        const auto units = (double) numVoices * voiceBlockSize;
+
+        juce::AudioBuffer<float> output(2, voiceBlockSize);
+        juce::AudioBuffer<float> reference(2, voiceBlockSize);
+        juce::MidiBuffer noMidi;
+
+        double serial = 0.0;
+        const int maxWorkers = juce::jmax(1, juce::SystemStats::getNumCpus()) - 1;
+
+        // -1 is plain serial rendering; 0 renders in chunks but only on the calling thread
+        for (int numWorkers = -1; numWorkers <= maxWorkers; ++numWorkers)
+        {
+            FoleysSynth synth;
+            for (int v = 0; v < numVoices; ++v)
+                synth.addVoice(new FoleysSynth::FoleysVoice());
+            synth.addSound(new FoleysSynth::FoleysSound(host.state));
+            synth.setCurrentPlaybackSampleRate(voiceSampleRate);
+
+            std::unique_ptr<RenderPool> pool;
+            if (numWorkers >= 0)
+            {
+                pool = std::make_unique<RenderPool>(numWorkers);
+                pool->start();
+                synth.setRenderPool(pool.get(), 2, voiceBlockSize);
+            }
+
+            for (int v = 0; v < numVoices; ++v)
+                synth.noteOn(1 + v / 96, 24 + v % 96, 0.8f);
+
+            const auto caseName = numWorkers < 0 ? juce::String("serial")
+                                                 : juce::String(numWorkers + 1) + (numWorkers == 0 ? " thread" : " threads");
+
+            const auto ns = measure(caseName + ", " + juce::String(numVoices) + " voices", units, "voice-sample", [&]
+            {
+                output.clear();
+                synth.renderNextBlock(output, noMidi, 0, voiceBlockSize);
+            });
+
+            if (numWorkers >= 0)
+                report(caseName + ", speedup", juce::String(serial / ns, 2) + "x");
+            else
+                serial = ns;
+
+            // Every run starts again from the same voice state, so that its first block must match the
+            // serial one exactly, whatever thread rendered which voice
+            synth.allNotesOff(0, false);
+            for (int v = 0; v < numVoices; ++v)
+                synth.noteOn(1 + v / 96, 24 + v % 96, 0.8f);
+
+            output.clear();
+            synth.renderNextBlock(output, noMidi, 0, voiceBlockSize);
+
+            if (numWorkers < 0)
+            {
+                reference.makeCopyOf(output);
+            }
+            else
+            {
+                bool identical = true;
+                for (int ch = 0; ch < 2; ++ch)
+                    identical = identical && std::memcmp(output.getReadPointer(ch), reference.getReadPointer(ch),
+                                                         sizeof(float) * (size_t) voiceBlockSize) == 0;
+
+                report(caseName + ", output", identical ? "identical" : "DIFFERS");
+            }
+        }
+    }
+};
+
+static VoiceRenderBenchmark voiceRenderBenchmark;
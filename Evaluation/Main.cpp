@@ -0,0 +1,254 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Runs every performance against every score, prediction case and block size in parallel, and
+    writes the session metrics of each run to one JSON report.
+
+    Usage: MidiPredictEvaluation --performance <mid> [--performance <mid> ...] --score <mid> [--score <mid> ...]
+                                 [--cases 1,2,3] [--blocks <n>[,<n>...]] [--rate <hz>] [--seconds <s>]
+                                 [--threads <n>] [--pause-gap <s>] [--lock-tolerance <s>] [--out <json>]
+                                 [--generate <s> --seeds <n>[,<n>...] [--jitter <ms>] [--rubato <depth>]
+                                  [--mistakes <p>] [--form <p>] [--pauses <p>]]
+
+    With --generate, each performance file is played as a score by the PerformanceGenerator, once per
+    seed, for that many seconds: --mistakes sets the wrong, extra and missing note probabilities,
+    --form the section skip and repeat probabilities and --pauses the pause probability per section.
+
+    Each run has its own processor, rendered on the thread that runs it with no worker threads of its own, no
+    shared prediction timeline, and a governor that measures without degrading, so the results do not
+    depend on how many runs share the machine. The CPU figures do.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "OfflineSession.h"
+
+#include <atomic>
+#include <iostream>
+
+namespace
+{
+    struct Options
+    {
+        juce::Array<juce::File> performances, scores;
+        std::vector<int> cases { 1, 2, 3 };
+        std::vector<int> blockSizes { 512 };
+        double sampleRate = 48000.0;
+        double seconds = 0.0;  // 0: up to the last performed onset plus a tail
+        int numThreads = juce::SystemStats::getNumCpus();
+        SessionMetrics::Settings metrics;
+        juce::File report;
+
+        PerformanceGenerator::Settings generator;
+        std::vector<int> seeds;  // empty: the performance files as they are
+    };
+
+    struct Run
+    {
+        juce::File performance, score;
+        std::shared_ptr<const PreparedScore> preparedScore;
+        int seed = 0;  // > 0: generated from the performance file with this seed
+        int predictionCase = 3;
+        int blockSize = 512;
+        double wallSeconds = 0.0;
+        SessionMetrics metrics;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: MidiPredictEvaluation --performance <mid> [--performance <mid> ...] --score <mid> [--score <mid> ...]\n"
+                     "                             [--cases 1,2,3] [--blocks <n>[,<n>...]] [--rate <hz>] [--seconds <s>]\n"
+                     "                             [--threads <n>] [--pause-gap <s>] [--lock-tolerance <s>] [--out <json>]\n"
+                     "                             [--generate <s> --seeds <n>[,<n>...] [--jitter <ms>] [--rubato <depth>]\n"
+                     "                              [--mistakes <p>] [--form <p>] [--pauses <p>]]\n";
+    }
+
+    std::vector<int> parseList(const juce::String& value)
+    {
+        std::vector<int> list;
+        for (const auto& item : juce::StringArray::fromTokens(value, ",", {}))
+            if (item.getIntValue() > 0)
+                list.push_back(item.getIntValue());
+        return list;
+    }
+
+    bool parse(int argc, char* argv[], Options& options)
+    {
+        const auto cwd = juce::File::getCurrentWorkingDirectory();
+        options.report = cwd.getChildFile("evaluation.json");
+
+        for (int i = 1; i < argc; ++i)
+        {
+            const juce::String arg(argv[i]);
+
+            if (i + 1 >= argc)
+                return false;
+
+            const juce::String value(argv[++i]);
+
+            if (arg == "--performance")         options.performances.add(cwd.getChildFile(value));
+            else if (arg == "--score")          options.scores.add(cwd.getChildFile(value));
+            else if (arg == "--cases")          options.cases = parseList(value);
+            else if (arg == "--blocks")         options.blockSizes = parseList(value);
+            else if (arg == "--rate")           options.sampleRate = value.getDoubleValue();
+            else if (arg == "--seconds")        options.seconds = value.getDoubleValue();
+            else if (arg == "--threads")        options.numThreads = juce::jmax(1, value.getIntValue());
+            else if (arg == "--pause-gap")      options.metrics.pauseGapSeconds = value.getDoubleValue();
+            else if (arg == "--lock-tolerance") options.metrics.lockToleranceSeconds = value.getDoubleValue();
+            else if (arg == "--out")            options.report = cwd.getChildFile(value);
+            else if (arg == "--generate")       options.generator.lengthSeconds = value.getDoubleValue();
+            else if (arg == "--seeds")          options.seeds = parseList(value);
+            else if (arg == "--jitter")         options.generator.jitterMs = value.getDoubleValue();
+            else if (arg == "--rubato")         options.generator.rubatoDepth = value.getDoubleValue();
+            else if (arg == "--pauses")         options.generator.pauseProbability = value.getDoubleValue();
+            else if (arg == "--mistakes")
+            {
+                options.generator.wrongNoteProbability = value.getDoubleValue();
+                options.generator.extraNoteProbability = value.getDoubleValue();
+                options.generator.missingNoteProbability = value.getDoubleValue();
+            }
+            else if (arg == "--form")
+            {
+                options.generator.skipProbability = value.getDoubleValue();
+                options.generator.repeatProbability = value.getDoubleValue();
+            }
+            else return false;
+        }
+
+        for (const auto& file : options.performances)
+            if (! file.existsAsFile())
+                return false;
+
+        for (const auto& file : options.scores)
+            if (! file.existsAsFile())
+                return false;
+
+        if (options.generator.lengthSeconds > 0.0 && options.seeds.empty())
+            options.seeds.push_back(1);
+
+        return ! options.performances.isEmpty() && ! options.scores.isEmpty()
+            && ! options.cases.empty() && ! options.blockSizes.empty() && options.sampleRate > 0.0;
+    }
+
+    /** Renders one session as fast as possible and scores it. */
+    void render(Run& run, const Options& options)
+    {
+        OfflineSession session;
+        session.performance = run.performance;
+        session.score = run.score;
+        session.preparedScore = run.preparedScore;
+        session.predictionCase = run.predictionCase;
+        session.blockSize = run.blockSize;
+        session.sampleRate = options.sampleRate;
+        session.seconds = options.seconds;
+
+        if (run.seed > 0)
+        {
+            session.generator = options.generator;
+            session.generator->seed = run.seed;
+        }
+
+        const auto record = session.render(session.getPerformedOnsets(), run.wallSeconds);
+        run.metrics = SessionMetrics::measure(record, options.metrics);
+    }
+
+    juce::var toVar(const std::vector<Run>& runs, const Options& options)
+    {
+        juce::Array<juce::var> results;
+
+        for (const auto& run : runs)
+        {
+            auto* result = new juce::DynamicObject();
+            result->setProperty("performance", run.performance.getFileName());
+            result->setProperty("seed", run.seed);
+            result->setProperty("score", run.score.getFileName());
+            result->setProperty("predictionCase", run.predictionCase);
+            result->setProperty("blockSize", run.blockSize);
+            result->setProperty("wallSeconds", run.wallSeconds);
+            result->setProperty("metrics", run.metrics.toVar());
+            results.add(juce::var(result));
+        }
+
+        auto* settings = new juce::DynamicObject();
+        settings->setProperty("sampleRate", options.sampleRate);
+        settings->setProperty("matchWindowSeconds", options.metrics.matchWindowSeconds);
+        settings->setProperty("pauseGapSeconds", options.metrics.pauseGapSeconds);
+        settings->setProperty("lockToleranceSeconds", options.metrics.lockToleranceSeconds);
+        settings->setProperty("threads", options.numThreads);
+        settings->setProperty("generateSeconds", options.generator.lengthSeconds);
+
+        auto* report = new juce::DynamicObject();
+        report->setProperty("settings", juce::var(settings));
+        report->setProperty("runs", results);
+        return juce::var(report);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (! parse(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    const auto seeds = options.seeds.empty() ? std::vector<int> { 0 } : options.seeds;
+
+    // Each score is read once and shared by all its runs
+    std::vector<std::shared_ptr<const PreparedScore>> preparedScores;
+    for (const auto& score : options.scores)
+        preparedScores.push_back(PreparedScore::read(score, options.sampleRate, PluginProcessor::testSpeedChange));
+
+    std::vector<Run> runs;
+    for (const auto& performance : options.performances)
+        for (auto seed : seeds)
+            for (size_t score = 0; score < preparedScores.size(); ++score)
+                for (auto predictionCase : options.cases)
+                    for (auto blockSize : options.blockSizes)
+                        runs.push_back({ performance, options.scores[(int) score], preparedScores[score], seed, predictionCase, blockSize, 0.0, {} });
+
+    std::atomic<int> finished { 0 };
+    const auto start = juce::Time::getMillisecondCounterHiRes();
+
+    {
+        juce::ThreadPool pool(options.numThreads);
+
+        // Each job writes only its own run, which is not moved until the pool is done
+        for (auto& run : runs)
+        {
+            pool.addJob([&run, &options, &finished]
+            {
+                render(run, options);
+                ++finished;
+            });
+        }
+
+        for (int reported = 0; reported < (int) runs.size();)
+        {
+            juce::Thread::sleep(100);
+
+            if (finished.load() != reported)
+            {
+                reported = finished.load();
+                std::cout << "\r" << reported << "/" << runs.size() << " runs" << std::flush;
+            }
+        }
+
+        std::cout << "\n";
+    }
+
+    if (! options.report.replaceWithText(juce::JSON::toString(toVar(runs, options))))
+    {
+        std::cerr << "Cannot write " << options.report.getFullPathName() << "\n";
+        return 1;
+    }
+
+    std::cout << runs.size() << " runs in " << juce::String(0.001 * (juce::Time::getMillisecondCounterHiRes() - start), 1)
+              << " s, report in " << options.report.getFullPathName() << "\n";
+    return 0;
+}
@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    OfflineSession.cpp
+    One performance played into a processor as fast as possible, recorded for scoring.
+
+  ==============================================================================
+*/
+
+#include "OfflineSession.h"
+
+#include <algorithm>
+
+std::vector<SessionRecord::Onset> OfflineSession::getPerformedOnsets() const
+{
+    if (! generator.has_value())
+        return SessionRecord::readOnsets(performance, sampleRate);
+
+    PerformanceGenerator twin;
+    twin.setSettings(*generator);
+    twin.prepare(readMIDIFile(performance, sampleRate), sampleRate);
+
+    std::vector<SessionRecord::Onset> onsets;
+    MidiEventList events;
+    const auto chunk = (std::int64_t) sampleRate;
+
+    for (std::int64_t end = chunk;; end += chunk)
+    {
+        events.clear();
+        const bool more = twin.generate(end, events);
+
+        for (const auto& e : events)
+            if (e.isNoteOn())
+                onsets.push_back({ e.sampleTime, e.getNoteNumber() });
+
+        if (! more)
+            break;
+    }
+
+    return onsets;
+}
+
+SessionRecord OfflineSession::render(const std::vector<SessionRecord::Onset>& performed, double& wallSeconds) const
+{
+    const auto lastOnset = performed.empty() ? 0 : performed.back().sample;
+    const auto totalSamples = seconds > 0.0 ? (juce::int64) (seconds * sampleRate)
+                                            : lastOnset + (juce::int64) (tailSeconds * sampleRate);
+
+    SessionRecord record;
+    record.sampleRate = sampleRate;
+    record.performed.assign(performed.begin(),
+                            std::lower_bound(performed.begin(), performed.end(), totalSamples,
+                                             [] (const SessionRecord::Onset& o, juce::int64 s) { return o.sample < s; }));
+
+    PluginProcessor processor;
+    processor.setScoreFile(score);
+    processor.setPreparedScore(preparedScore);
+    processor.setPerformanceFile(performance);
+    if (generator.has_value())
+        processor.setGeneratedPerformance(*generator);
+    if (follower.has_value())
+        processor.setFollowerSettings(*follower);
+    processor.setPredictionCase(predictionCase);
+    processor.setPublishTimeline(false);
+    processor.setVoiceRenderThreads(0);
+    processor.setParallelRender(false);
+
+    auto governorSettings = processor.getGovernor().getSettings();
+    governorSettings.maxLevel = CpuGovernor::normal;
+    processor.getGovernor().setSettings(governorSettings);
+
+    processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    juce::AudioBuffer<float> audio(processor.getTotalNumOutputChannels(), blockSize);
+    juce::MidiBuffer midi;
+    record.blocks.reserve((size_t) (totalSamples / blockSize) + 1);
+    wallSeconds = 0.0;
+
+    for (juce::int64 position = 0; position < totalSamples; position += blockSize)
+    {
+        audio.clear();
+        midi.clear();
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        processor.processBlock(audio, midi);
+        const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        wallSeconds += elapsed;
+        record.blocks.push_back({ position, blockSize, processor.isFollowerPaused(), elapsed * sampleRate / blockSize });
+
+        for (const auto metadata : midi)
+        {
+            const auto message = metadata.getMessage();
+            if (message.isNoteOn())
+                record.predicted.push_back({ position + metadata.samplePosition, message.getNoteNumber() });
+        }
+    }
+
+    processor.releaseResources();
+    return record;
+}
@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    OfflineSession.h
+    One performance played into a processor as fast as possible, recorded for scoring.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "SessionMetrics.h"
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+/**
+ * @brief A performance file (or a performance generated from it) followed against a score, offline.
+ *
+ * Each render has its own processor, on the thread that calls it: both engines and every voice render
+ * there with no worker threads, no shared prediction timeline, and a governor that measures without
+ * degrading, so that sessions can run side by side without changing each other's results.
+ */
+struct OfflineSession
+{
+    juce::File performance, score;
+    std::shared_ptr<const PreparedScore> preparedScore;  // the score already read, shared between sessions
+    std::optional<PerformanceGenerator::Settings> generator;  // plays a generated performance instead of the file
+    std::optional<FollowerSettings> follower;  // the score's preset otherwise
+    int predictionCase = 3;
+    int blockSize = 512;
+    double sampleRate = 48000.0;
+    double seconds = 0.0;  // 0: up to the last performed onset plus tailSeconds
+
+    static constexpr double tailSeconds = 2.0;
+
+    /** Note-ons of the performance: the file's, or a twin generator's with the same seed. */
+    std::vector<SessionRecord::Onset> getPerformedOnsets() const;
+
+    /**
+     * Renders the session. `performed` comes from getPerformedOnsets(), so that renders of one performance
+     * can share it; the onsets past the rendered length are left out of the record.
+     */
+    SessionRecord render(const std::vector<SessionRecord::Onset>& performed, double& wallSeconds) const;
+};
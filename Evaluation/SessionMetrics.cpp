@@ -0,0 +1,234 @@
+/*
+  ==============================================================================
+
+    SessionMetrics.cpp
+    Scores one offline session of the follower against the performance it followed.
+
+  ==============================================================================
+*/
+
+#include "SessionMetrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    struct Interval
+    {
+        juce::int64 start = 0, end = 0;
+
+        bool overlaps(const Interval& other) const noexcept  { return start < other.end && other.start < end; }
+    };
+
+    double toMs(double samples, double sampleRate)
+    {
+        return 1000.0 * samples / sampleRate;
+    }
+}
+
+std::vector<SessionRecord::Onset> SessionRecord::readOnsets(const juce::File& midiFile, double sampleRate)
+{
+    std::vector<Onset> onsets;
+    juce::MidiFile midi;
+    juce::FileInputStream stream(midiFile);
+
+    if (! stream.openedOk() || ! midi.readFrom(stream))
+        return onsets;
+
+    midi.convertTimestampTicksToSeconds();
+
+    for (int track = 0; track < midi.getNumTracks(); ++track)
+        for (const auto* event : *midi.getTrack(track))
+            if (event->message.isNoteOn())
+                onsets.push_back({ (juce::int64) (event->message.getTimeStamp() * sampleRate), event->message.getNoteNumber() });
+
+    std::stable_sort(onsets.begin(), onsets.end(), [] (const Onset& a, const Onset& b) { return a.sample < b.sample; });
+    return onsets;
+}
+
+//==============================================================================
+SessionMetrics::Distribution SessionMetrics::Distribution::of(std::vector<double>& values)
+{
+    Distribution d;
+    if (values.empty())
+        return d;
+
+    std::sort(values.begin(), values.end());
+
+    const auto percentile = [&values] (double p)  { return values[(size_t) (p * (double) (values.size() - 1))]; };
+
+    double sum = 0.0;
+    for (auto v : values)
+        sum += v;
+
+    d.count = (int) values.size();
+    d.mean = sum / (double) values.size();
+    d.p50 = percentile(0.5);
+    d.p90 = percentile(0.9);
+    d.p99 = percentile(0.99);
+    d.max = values.back();
+    return d;
+}
+
+juce::var SessionMetrics::Distribution::toVar() const
+{
+    auto* object = new juce::DynamicObject();
+    object->setProperty("count", count);
+    object->setProperty("mean", mean);
+    object->setProperty("p50", p50);
+    object->setProperty("p90", p90);
+    object->setProperty("p99", p99);
+    object->setProperty("max", max);
+    return juce::var(object);
+}
+
+//==============================================================================
+SessionMetrics SessionMetrics::measure(const SessionRecord& record, const Settings& settings)
+{
+    SessionMetrics metrics;
+    const auto sampleRate = record.sampleRate;
+    const auto window = (juce::int64) (settings.matchWindowSeconds * sampleRate);
+    const auto& performed = record.performed;
+    const auto& predicted = record.predicted;
+
+    // Onset error: nearest prediction of the same pitch, per performed note
+    std::vector<double> errors(performed.size(), 0.0);
+    std::vector<bool> matched(performed.size(), false);
+    std::vector<double> absoluteErrors;
+    double signedSum = 0.0;
+
+    for (size_t i = 0; i < performed.size(); ++i)
+    {
+        const auto& note = performed[i];
+        auto first = std::lower_bound(predicted.begin(), predicted.end(), note.sample - window,
+                                      [] (const SessionRecord::Onset& o, juce::int64 s) { return o.sample < s; });
+
+        for (auto it = first; it != predicted.end() && it->sample <= note.sample + window; ++it)
+        {
+            if (it->noteNumber != note.noteNumber)
+                continue;
+
+            const auto error = toMs((double) (it->sample - note.sample), sampleRate);
+            if (! matched[i] || std::abs(error) < std::abs(errors[i]))
+                errors[i] = error;
+            matched[i] = true;
+        }
+
+        if (matched[i])
+        {
+            absoluteErrors.push_back(std::abs(errors[i]));
+            signedSum += errors[i];
+        }
+        else
+        {
+            ++metrics.missedOnsets;
+        }
+    }
+
+    metrics.meanSignedOnsetErrorMs = absoluteErrors.empty() ? 0.0 : signedSum / (double) absoluteErrors.size();
+    metrics.onsetErrorMs = Distribution::of(absoluteErrors);
+
+    // Performer pauses, with the index of the onset that ends each
+    const auto gap = (juce::int64) (settings.pauseGapSeconds * sampleRate);
+    std::vector<Interval> performerPauses;
+    std::vector<size_t> resumeOnsets;
+
+    for (size_t i = 1; i < performed.size(); ++i)
+    {
+        if (performed[i].sample - performed[i - 1].sample >= gap)
+        {
+            performerPauses.push_back({ performed[i - 1].sample, performed[i].sample });
+            resumeOnsets.push_back(i);
+        }
+    }
+
+    // Follower pauses: runs of paused blocks
+    std::vector<Interval> followerPauses;
+    for (const auto& block : record.blocks)
+    {
+        if (! block.paused)
+            continue;
+
+        if (! followerPauses.empty() && followerPauses.back().end == block.startSample)
+            followerPauses.back().end += block.numSamples;
+        else
+            followerPauses.push_back({ block.startSample, block.startSample + block.numSamples });
+    }
+
+    const auto overlapsAny = [] (const Interval& interval, const std::vector<Interval>& others)
+    {
+        return std::any_of(others.begin(), others.end(), [&interval] (const Interval& o) { return interval.overlaps(o); });
+    };
+
+    metrics.performerPauses = (int) performerPauses.size();
+    metrics.followerPauses = (int) followerPauses.size();
+    metrics.falsePauses = (int) std::count_if(followerPauses.begin(), followerPauses.end(),
+                                              [&] (const Interval& p) { return ! overlapsAny(p, performerPauses); });
+    metrics.missedPauses = (int) std::count_if(performerPauses.begin(), performerPauses.end(),
+                                               [&] (const Interval& p) { return ! overlapsAny(p, followerPauses); });
+
+    // Re-lock: first onset after each pause, up to the next one, that was predicted within tolerance
+    const auto tolerance = 1000.0 * settings.lockToleranceSeconds;
+    std::vector<double> relocks;
+
+    for (size_t p = 0; p < resumeOnsets.size(); ++p)
+    {
+        const auto resume = resumeOnsets[p];
+        const auto until = p + 1 < resumeOnsets.size() ? resumeOnsets[p + 1] : performed.size();
+        bool relocked = false;
+
+        for (auto i = resume; i < until && ! relocked; ++i)
+        {
+            if (matched[i] && std::abs(errors[i]) <= tolerance)
+            {
+                relocks.push_back(toMs((double) (performed[i].sample - performed[resume].sample), sampleRate));
+                relocked = true;
+            }
+        }
+
+        if (! relocked)
+            ++metrics.neverRelocked;
+    }
+
+    metrics.relockMs = Distribution::of(relocks);
+
+    // CPU
+    std::vector<double> loads;
+    loads.reserve(record.blocks.size());
+    for (const auto& block : record.blocks)
+    {
+        loads.push_back(block.load);
+        if (block.load >= 1.0)
+            ++metrics.overruns;
+    }
+
+    metrics.blockLoad = Distribution::of(loads);
+    return metrics;
+}
+
+juce::var SessionMetrics::toVar() const
+{
+    auto* onsets = new juce::DynamicObject();
+    onsets->setProperty("absoluteErrorMs", onsetErrorMs.toVar());
+    onsets->setProperty("meanSignedErrorMs", meanSignedOnsetErrorMs);
+    onsets->setProperty("missed", missedOnsets);
+
+    auto* pauses = new juce::DynamicObject();
+    pauses->setProperty("performer", performerPauses);
+    pauses->setProperty("follower", followerPauses);
+    pauses->setProperty("false", falsePauses);
+    pauses->setProperty("missed", missedPauses);
+    pauses->setProperty("relockMs", relockMs.toVar());
+    pauses->setProperty("neverRelocked", neverRelocked);
+
+    auto* cpu = new juce::DynamicObject();
+    cpu->setProperty("blockLoad", blockLoad.toVar());
+    cpu->setProperty("overruns", overruns);
+
+    auto* object = new juce::DynamicObject();
+    object->setProperty("onsets", juce::var(onsets));
+    object->setProperty("pauses", juce::var(pauses));
+    object->setProperty("cpu", juce::var(cpu));
+    return juce::var(object);
+}
@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    SessionMetrics.h
+    Scores one offline session of the follower against the performance it followed.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <vector>
+
+/** What a session produced, in output samples from its start. */
+struct SessionRecord
+{
+    struct Onset
+    {
+        juce::int64 sample = 0;
+        int noteNumber = 0;
+    };
+
+    struct Block
+    {
+        juce::int64 startSample = 0;
+        int numSamples = 0;
+        bool paused = false;
+        double load = 0.0;  // processBlock time as a fraction of the block's budget
+    };
+
+    double sampleRate = 48000.0;
+    std::vector<Onset> performed;  // note-ons of the performance
+    std::vector<Onset> predicted;  // note-ons of the prediction, when they sounded
+    std::vector<Block> blocks;
+
+    /** Reads the note-ons of a MIDI file at `sampleRate`, time-ordered. */
+    static std::vector<Onset> readOnsets(const juce::File& midiFile, double sampleRate);
+};
+
+/**
+ * @brief Onset error, pause detection, re-lock time and CPU cost of one session.
+ *
+ * - Onset error: for each performed note, the predicted onset of the same pitch nearest to it within
+ *   `matchWindowSeconds`, as predicted minus performed. Performed notes with none are counted as missed.
+ * - Pauses: a gap of at least `pauseGapSeconds` between performed onsets is a performer pause, from the
+ *   onset before it to the onset after it. A run of paused blocks that overlaps no performer pause is a
+ *   false pause; a performer pause that no paused block overlaps is a missed pause.
+ * - Re-lock: after each performer pause, the time from the performer's first onset to the first performed
+ *   onset predicted within `lockToleranceSeconds`. Pauses after which that never happens before the next
+ *   one are counted separately.
+ * - CPU: block loads, i.e. time in processBlock against the block's real-time budget.
+ *
+ * Times are reported in milliseconds.
+ */
+struct SessionMetrics
+{
+    struct Settings
+    {
+        double matchWindowSeconds = 1.0;
+        double pauseGapSeconds = 1.0;
+        double lockToleranceSeconds = 0.05;
+    };
+
+    struct Distribution
+    {
+        int count = 0;
+        double mean = 0.0, p50 = 0.0, p90 = 0.0, p99 = 0.0, max = 0.0;
+
+        /** Sorts `values`. */
+        static Distribution of(std::vector<double>& values);
+        juce::var toVar() const;
+    };
+
+    static SessionMetrics measure(const SessionRecord& record, const Settings& settings);
+
+    Distribution onsetErrorMs;       // absolute
+    double meanSignedOnsetErrorMs = 0.0;
+    int missedOnsets = 0;
+
+    int performerPauses = 0;
+    int followerPauses = 0;
+    int falsePauses = 0;
+    int missedPauses = 0;
+
+    Distribution relockMs;
+    int neverRelocked = 0;
+
+    Distribution blockLoad;
+    int overruns = 0;
+
+    juce::var toVar() const;
+};
@@ -0,0 +1,232 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Renders a session through the processor as fast as the CPU allows.
+
+    Usage: MidiPredictOffline --score <mid> --performance <mid> [--rate <hz>]
+                              [--blocks <n>[,<n>...]] [--seconds <s>] [--out <dir>]
+                              [--trace <json>]
+
+    Writes output.wav (24 bit), prediction.mid (the predicted notes as played, in milliseconds) and
+    timing.txt (the time spent in each processBlock against its real-time budget) to the output
+    directory. The block sizes are used in turn, repeating, so that hosts with irregular callbacks can
+    be reproduced. With --trace, in a build with MIDIPREDICT_TRACING, the spans and counters of the
+    load and the render are written to a Chrome/Perfetto JSON trace as well.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    struct Options
+    {
+        juce::File score, performance, outputDirectory, trace;
+        double sampleRate = 48000.0;
+        std::vector<int> blockSizes { 512 };
+        double seconds = 0.0;  // 0: the performance's length plus a tail
+    };
+
+    constexpr double tailSeconds = 2.0;
+
+    void printUsage()
+    {
+        std::cout << "Usage: MidiPredictOffline --score <mid> --performance <mid> [--rate <hz>]\n"
+                     "                          [--blocks <n>[,<n>...]] [--seconds <s>] [--out <dir>]\n"
+                     "                          [--trace <json>]\n";
+    }
+
+    bool parse(int argc, char* argv[], Options& options)
+    {
+        options.outputDirectory = juce::File::getCurrentWorkingDirectory();
+
+        for (int i = 1; i < argc; ++i)
+        {
+            const juce::String arg(argv[i]);
+
+            if (i + 1 >= argc)
+                return false;
+
+            const juce::String value(argv[++i]);
+
+            if (arg == "--score")
+                options.score = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+            else if (arg == "--performance")
+                options.performance = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+            else if (arg == "--out")
+                options.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+            else if (arg == "--trace")
+                options.trace = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+            else if (arg == "--rate")
+                options.sampleRate = value.getDoubleValue();
+            else if (arg == "--seconds")
+                options.seconds = value.getDoubleValue();
+            else if (arg == "--blocks")
+            {
+                options.blockSizes.clear();
+                for (const auto& size : juce::StringArray::fromTokens(value, ",", {}))
+                    if (size.getIntValue() > 0)
+                        options.blockSizes.push_back(size.getIntValue());
+            }
+            else
+                return false;
+        }
+
+        return options.score.existsAsFile() && options.performance.existsAsFile()
+            && options.sampleRate > 0.0 && ! options.blockSizes.empty();
+    }
+
+    double getLengthSeconds(const juce::File& midiFile)
+    {
+        juce::MidiFile midi;
+        juce::FileInputStream stream(midiFile);
+
+        if (! stream.openedOk() || ! midi.readFrom(stream))
+            return 0.0;
+
+        midi.convertTimestampTicksToSeconds();
+        return midi.getLastTimestamp();
+    }
+
+    /** Block costs as fractions of their budgets; sorts `loads`. */
+    juce::String summarise(std::vector<double>& loads, double audioSeconds, double wallSeconds)
+    {
+        std::sort(loads.begin(), loads.end());
+
+        const auto percentile = [&loads] (double p)
+        {
+            return loads.empty() ? 0.0 : loads[(size_t) (p * (double) (loads.size() - 1))];
+        };
+
+        double sum = 0.0;
+        for (auto load : loads)
+            sum += load;
+
+        const auto overruns = loads.end() - std::lower_bound(loads.begin(), loads.end(), 1.0);
+
+        juce::String report;
+        report << "audio seconds    " << juce::String(audioSeconds, 3) << "\n"
+               << "wall seconds     " << juce::String(wallSeconds, 3) << "\n"
+               << "real time factor " << juce::String(wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0, 1) << "x\n"
+               << "blocks           " << (int) loads.size() << "\n"
+               << "block load mean  " << juce::String(loads.empty() ? 0.0 : sum / (double) loads.size(), 4) << "\n"
+               << "block load p50   " << juce::String(percentile(0.5), 4) << "\n"
+               << "block load p99   " << juce::String(percentile(0.99), 4) << "\n"
+               << "block load max   " << juce::String(loads.empty() ? 0.0 : loads.back(), 4) << "\n"
+               << "overruns         " << (int) overruns << "\n";
+        return report;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (! parse(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    if (! options.outputDirectory.createDirectory())
+    {
+        std::cerr << "Cannot create " << options.outputDirectory.getFullPathName() << "\n";
+        return 1;
+    }
+
+    const auto seconds = options.seconds > 0.0 ? options.seconds : getLengthSeconds(options.performance) + tailSeconds;
+    const auto totalSamples = (juce::int64) (seconds * options.sampleRate);
+    const auto maxBlockSize = *std::max_element(options.blockSizes.begin(), options.blockSizes.end());
+
+    if (options.trace != juce::File() && ! Trace::start(options.trace))
+        std::cerr << "Cannot trace to " << options.trace.getFullPathName()
+                  << (MIDIPREDICT_TRACING ? "" : " (built without MIDIPREDICT_TRACING)") << "\n";
+
+    PluginProcessor processor;
+    processor.setScoreFile(options.score);
+    processor.setPerformanceFile(options.performance);
+    processor.setPublishTimeline(false);  // nothing reads an offline run's timeline
+    processor.setRateAndBufferSizeDetails(options.sampleRate, maxBlockSize);
+    processor.prepareToPlay(options.sampleRate, maxBlockSize);
+
+    const int numChannels = processor.getTotalNumOutputChannels();
+    juce::AudioBuffer<float> audio(numChannels, maxBlockSize);
+    juce::MidiBuffer midi;
+    juce::MidiMessageSequence prediction;
+
+    auto outputFile = options.outputDirectory.getChildFile("output.wav");
+    outputFile.deleteFile();
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(new juce::FileOutputStream(outputFile),
+                                                                        options.sampleRate, (unsigned int) numChannels,
+                                                                        24, {}, 0));
+    if (writer == nullptr)
+    {
+        std::cerr << "Cannot write " << outputFile.getFullPathName() << "\n";
+        return 1;
+    }
+
+    std::vector<double> loads;
+    loads.reserve((size_t) (totalSamples / options.blockSizes.front()) + options.blockSizes.size());
+    double wallSeconds = 0.0;
+    juce::int64 position = 0;
+
+    for (size_t block = 0; position < totalSamples; ++block)
+    {
+        const auto numSamples = (int) juce::jmin((juce::int64) options.blockSizes[block % options.blockSizes.size()],
+                                                 totalSamples - position);
+
+        // A view over the first numSamples of the preallocated buffer, as a host with a shorter callback would pass
+        juce::AudioBuffer<float> view(audio.getArrayOfWritePointers(), numChannels, numSamples);
+        view.clear();
+        midi.clear();
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        processor.processBlock(view, midi);
+        const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        wallSeconds += elapsed;
+        loads.push_back(elapsed * options.sampleRate / numSamples);
+
+        writer->writeFromAudioSampleBuffer(view, 0, numSamples);
+
+        for (const auto metadata : midi)
+        {
+            auto message = metadata.getMessage();
+            message.setTimeStamp(1000.0 * (double) (position + metadata.samplePosition) / options.sampleRate);
+            prediction.addEvent(message);
+        }
+
+        position += numSamples;
+    }
+
+    processor.releaseResources();
+    writer.reset();
+    Trace::stop();
+
+    // 25 fps at 40 ticks per frame: one tick per millisecond
+    prediction.updateMatchedPairs();
+    juce::MidiFile predictionFile;
+    predictionFile.setSmpteTimeFormat(25, 40);
+    predictionFile.addTrack(prediction);
+
+    auto predictionMidi = options.outputDirectory.getChildFile("prediction.mid");
+    predictionMidi.deleteFile();
+    juce::FileOutputStream predictionStream(predictionMidi);
+    if (! predictionStream.openedOk() || ! predictionFile.writeTo(predictionStream))
+        std::cerr << "Cannot write " << predictionMidi.getFullPathName() << "\n";
+
+    const auto report = summarise(loads, (double) totalSamples / options.sampleRate, wallSeconds);
+    options.outputDirectory.getChildFile("timing.txt").replaceWithText(report);
+    std::cout << report;
+
+    return 0;
+}
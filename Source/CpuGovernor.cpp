@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    CpuGovernor.cpp
+    Measures each block against its real-time budget and picks a degradation level.
+
+  ==============================================================================
+*/
+
+#include "CpuGovernor.h"
+
+void CpuGovernor::prepare(double newSampleRate) noexcept
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    level.store(normal, std::memory_order_relaxed);
+    smoothedLoad.store(0.0, std::memory_order_relaxed);
+    lastLoad.store(0.0, std::memory_order_relaxed);
+    blocksSinceEscalation = settings.holdBlocks;
+    blocksBelowRecover = 0;
+    resetCounters();
+}
+
+void CpuGovernor::beginBlock() noexcept
+{
+    blockStartTicks = juce::Time::getHighResolutionTicks();
+}
+
+void CpuGovernor::endBlock(int numSamples) noexcept
+{
+    const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - blockStartTicks);
+    addBlockCost(numSamples, elapsed);
+}
+
+void CpuGovernor::addBlockCost(int numSamples, double seconds) noexcept
+{
+    if (numSamples <= 0)
+        return;
+
+    const auto load = seconds * sampleRate / numSamples;
+
+    // Fast attack, slow release: one bad block counts fully, good blocks bring the load down gradually
+    auto smoothed = smoothedLoad.load(std::memory_order_relaxed);
+    smoothed = load > smoothed ? load : smoothed + 0.05 * (load - smoothed);
+
+    lastLoad.store(load, std::memory_order_relaxed);
+    smoothedLoad.store(smoothed, std::memory_order_relaxed);
+    if (load > peakLoad.load(std::memory_order_relaxed))
+        peakLoad.store(load, std::memory_order_relaxed);
+
+    blocks.fetch_add(1, std::memory_order_relaxed);
+    blocksAtLevel[(size_t) getLevel()].fetch_add(1, std::memory_order_relaxed);
+
+    const bool overrun = load >= 1.0;
+    if (overrun)
+        overruns.fetch_add(1, std::memory_order_relaxed);
+
+    ++blocksSinceEscalation;
+    const auto current = level.load(std::memory_order_relaxed);
+
+    if ((overrun || (smoothed > settings.escalateLoad && blocksSinceEscalation >= settings.holdBlocks)) && current < juce::jmin(settings.maxLevel, numLevels - 1))
+    {
+        setLevel(current + 1);
+        escalations.fetch_add(1, std::memory_order_relaxed);
+        blocksSinceEscalation = 0;
+        blocksBelowRecover = 0;
+        return;
+    }
+
+    blocksBelowRecover = smoothed < settings.recoverLoad ? blocksBelowRecover + 1 : 0;
+
+    if (blocksBelowRecover >= settings.recoverBlocks && current > normal)
+    {
+        setLevel(current - 1);
+        recoveries.fetch_add(1, std::memory_order_relaxed);
+        blocksBelowRecover = 0;
+    }
+}
+
+void CpuGovernor::burn(int numSamples, double fraction) const noexcept
+{
+    const auto seconds = fraction * numSamples / sampleRate;
+    const auto end = juce::Time::getHighResolutionTicks() + juce::Time::secondsToHighResolutionTicks(seconds);
+
+    while (juce::Time::getHighResolutionTicks() < end)
+    {
+    }
+}
+
+void CpuGovernor::resetCounters() noexcept
+{
+    peakLoad.store(0.0, std::memory_order_relaxed);
+    blocks.store(0, std::memory_order_relaxed);
+    overruns.store(0, std::memory_order_relaxed);
+    escalations.store(0, std::memory_order_relaxed);
+    recoveries.store(0, std::memory_order_relaxed);
+
+    for (auto& count : blocksAtLevel)
+        count.store(0, std::memory_order_relaxed);
+}
+
+const char* CpuGovernor::getLevelName(Level l) noexcept
+{
+    switch (l)
+    {
+        case normal:          return "normal";
+        case skipTelemetry:   return "skip telemetry";
+        case narrowMatching:  return "narrow matching";
+        case fewerPartials:   return "fewer partials";
+        case cullVoices:      return "cull voices";
+    }
+
+    return "";
+}
+
+void CpuGovernor::setLevel(int newLevel) noexcept
+{
+    level.store(juce::jlimit((int) normal, numLevels - 1, newLevel), std::memory_order_relaxed);
+}
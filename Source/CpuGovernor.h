@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    CpuGovernor.h
+    Measures each block against its real-time budget and picks a degradation level.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+
+/**
+ * @brief Charges the time spent in each block against the block's real-time budget and turns sustained
+ * pressure into a degradation level, one step at a time.
+ *
+ * The levels are cumulative, ordered from inaudible to audible:
+ * - skipTelemetry: the GUI gets no playhead, load or prediction meter updates;
+ * - narrowMatching: the follower only matches live notes close to their predicted onset;
+ * - fewerPartials: FoleysSynth voices render half their partials;
+ * - cullVoices: the quietest voices are stopped above a small polyphony.
+ *
+ * The load is smoothed with a fast attack and a slow release. The governor steps up when the smoothed
+ * load passes `escalateLoad`, and at once on an overrun. After stepping up it waits `holdBlocks` so that
+ * the new level can take effect. It steps down only after `recoverBlocks` blocks in a row below
+ * `recoverLoad`. Loads between the two thresholds hold the level where it is.
+ *
+ * The audio thread updates it; getLevel(), getLoad() and the counters can be read from any thread.
+ */
+class CpuGovernor
+{
+public:
+    enum Level : int
+    {
+        normal = 0,
+        skipTelemetry,
+        narrowMatching,
+        fewerPartials,
+        cullVoices
+    };
+
+    static constexpr int numLevels = cullVoices + 1;
+
+    struct Settings
+    {
+        double escalateLoad = 0.75;  // smoothed fraction of the budget that steps up
+        double recoverLoad = 0.45;   // smoothed fraction below which blocks count towards stepping down
+        int holdBlocks = 8;          // blocks after a step up before the next one, overruns excepted
+        int recoverBlocks = 128;     // blocks in a row below recoverLoad per step down
+        int maxLevel = cullVoices;   // highest level to step up to; normal only measures
+    };
+
+    void setSettings(const Settings& newSettings) noexcept  { settings = newSettings; }
+    const Settings& getSettings() const noexcept             { return settings; }
+
+    /** Sets the budget's sample rate and returns to the normal level with cleared counters. */
+    void prepare(double sampleRate) noexcept;
+
+    /** Call at the start and end of processBlock; the time in between is charged to the block. */
+    void beginBlock() noexcept;
+    void endBlock(int numSamples) noexcept;
+
+    /** Charges a measured cost to a block of `numSamples`. endBlock uses this; tests can call it directly. */
+    void addBlockCost(int numSamples, double seconds) noexcept;
+
+    /** Busy-waits for `fraction` of the budget of `numSamples`, to inject artificial load. */
+    void burn(int numSamples, double fraction) const noexcept;
+
+    Level getLevel() const noexcept                 { return (Level) level.load(std::memory_order_relaxed); }
+    bool  isAtLeast(Level l) const noexcept         { return level.load(std::memory_order_relaxed) >= l; }
+
+    /** Cost of the last block and the smoothed cost, as fractions of the budget. */
+    double getLoad() const noexcept                 { return lastLoad.load(std::memory_order_relaxed); }
+    double getSmoothedLoad() const noexcept         { return smoothedLoad.load(std::memory_order_relaxed); }
+    double getPeakLoad() const noexcept             { return peakLoad.load(std::memory_order_relaxed); }
+
+    std::uint64_t getNumBlocks() const noexcept     { return blocks.load(std::memory_order_relaxed); }
+    std::uint64_t getNumOverruns() const noexcept   { return overruns.load(std::memory_order_relaxed); }
+    std::uint64_t getNumEscalations() const noexcept { return escalations.load(std::memory_order_relaxed); }
+    std::uint64_t getNumRecoveries() const noexcept { return recoveries.load(std::memory_order_relaxed); }
+    std::uint64_t getNumBlocksAtLevel(Level l) const noexcept  { return blocksAtLevel[(size_t) l].load(std::memory_order_relaxed); }
+
+    void resetCounters() noexcept;
+
+    static const char* getLevelName(Level l) noexcept;
+
+    /** Times the enclosing scope as one block. */
+    class ScopedBlock
+    {
+    public:
+        ScopedBlock(CpuGovernor& g, int samples) noexcept : governor(g), numSamples(samples)  { governor.beginBlock(); }
+        ~ScopedBlock()                                                                        { governor.endBlock(numSamples); }
+
+    private:
+        CpuGovernor& governor;
+        const int numSamples;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedBlock)
+    };
+
+private:
+    void setLevel(int newLevel) noexcept;
+
+    Settings settings;
+    double sampleRate = 44100.0;
+    juce::int64 blockStartTicks = 0;
+    int blocksSinceEscalation = 0;
+    int blocksBelowRecover = 0;
+
+    std::atomic<int> level { normal };
+    std::atomic<double> lastLoad { 0.0 }, smoothedLoad { 0.0 }, peakLoad { 0.0 };
+    std::atomic<std::uint64_t> blocks { 0 }, overruns { 0 }, escalations { 0 }, recoveries { 0 };
+    std::array<std::atomic<std::uint64_t>, numLevels> blocksAtLevel {};
+};
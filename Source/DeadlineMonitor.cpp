@@ -0,0 +1,208 @@
+/*
+  ==============================================================================
+
+    DeadlineMonitor.cpp
+    Splits each block's time into processing stages and keeps their statistics against the deadline.
+
+  ==============================================================================
+*/
+
+#include "DeadlineMonitor.h"
+
+#include <cmath>
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+std::uint64_t DeadlineMonitor::readCycles() noexcept
+{
+   #if JUCE_INTEL
+    return __rdtsc();
+   #elif defined (__aarch64__)
+    std::uint64_t ticks;
+    asm volatile ("mrs %0, cntvct_el0" : "=r" (ticks));
+    return ticks;
+   #else
+    return (std::uint64_t) juce::Time::getHighResolutionTicks();
+   #endif
+}
+
+void DeadlineMonitor::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+
+    // A first estimate of the counter's rate over 2 ms; endBlock refines it over the whole session
+    calibrationCycles = readCycles();
+    calibrationTicks = juce::Time::getHighResolutionTicks();
+    const auto until = calibrationTicks + juce::Time::secondsToHighResolutionTicks(0.002);
+
+    auto ticks = calibrationTicks;
+    while (ticks < until)
+        ticks = juce::Time::getHighResolutionTicks();
+
+    const auto cycles = readCycles() - calibrationCycles;
+    if (cycles > 0)
+        secondsPerCycle = juce::Time::highResolutionTicksToSeconds(ticks - calibrationTicks) / (double) cycles;
+
+    clear();
+}
+
+void DeadlineMonitor::beginBlock() noexcept
+{
+    if (resetRequested.exchange(false, std::memory_order_relaxed))
+        clear();
+
+    blockStart = lastMark = readCycles();
+    stageCycles.fill(0);
+}
+
+void DeadlineMonitor::mark(Stage stage) noexcept
+{
+    const auto now = readCycles();
+    stageCycles[(size_t) stage] += now - lastMark;
+    lastMark = now;
+}
+
+void DeadlineMonitor::endBlock(int numSamples) noexcept
+{
+    const auto end = readCycles();
+    if (numSamples <= 0)
+        return;
+
+    const auto blockIndex = numBlocks.load(std::memory_order_relaxed);
+
+    // Every 64 blocks, re-measure the counter's rate from prepare() until now
+    if ((blockIndex & 63) == 63)
+    {
+        const auto cycles = end - calibrationCycles;
+        const auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - calibrationTicks);
+        if (cycles > 0 && seconds > 0.1)
+            secondsPerCycle = seconds / (double) cycles;
+    }
+
+    const auto loadPerCycle = secondsPerCycle * sampleRate / numSamples;
+
+    for (int stage = 0; stage < numStages; ++stage)
+    {
+        const auto load = (double) stageCycles[(size_t) stage] * loadPerCycle;
+        histograms[(size_t) stage].add(load);
+        lastLoads[(size_t) stage].store(load, std::memory_order_relaxed);
+    }
+
+    const auto load = (double) (end - blockStart) * loadPerCycle;
+    histograms[numStages].add(load);
+    lastLoads[numStages].store(load, std::memory_order_relaxed);
+
+    const auto write = historyWrite.load(std::memory_order_relaxed);
+    history[write % historySize].store((float) load, std::memory_order_relaxed);
+    historyWrite.store(write + 1, std::memory_order_release);
+
+    if (load >= 1.0)
+        overruns.store(overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    numBlocks.store(blockIndex + 1, std::memory_order_relaxed);
+}
+
+DeadlineMonitor::Stats DeadlineMonitor::getStats(int stage) const noexcept
+{
+    return histograms[(size_t) juce::jlimit(0, (int) numStages, stage)].getStats();
+}
+
+void DeadlineMonitor::getHistory(std::array<float, historySize>& loads) const noexcept
+{
+    const auto write = historyWrite.load(std::memory_order_acquire);
+    for (std::uint32_t i = 0; i < (std::uint32_t) historySize; ++i)
+        loads[i] = history[(write + i) % historySize].load(std::memory_order_relaxed);
+}
+
+void DeadlineMonitor::clear() noexcept
+{
+    for (auto& histogram : histograms)
+        histogram.clear();
+
+    for (auto& load : lastLoads)
+        load.store(0.0, std::memory_order_relaxed);
+
+    for (auto& load : history)
+        load.store(0.0f, std::memory_order_relaxed);
+
+    numBlocks.store(0, std::memory_order_relaxed);
+    overruns.store(0, std::memory_order_relaxed);
+}
+
+const char* DeadlineMonitor::getStageName(int stage) noexcept
+{
+    switch (stage)
+    {
+        case input:      return "input";
+        case following:  return "following";
+        case prediction: return "prediction";
+        case merging:    return "merging";
+        case synthesis:  return "synthesis";
+        default:         return "block";
+    }
+}
+
+//==============================================================================
+void DeadlineMonitor::Histogram::add(double load) noexcept
+{
+    const auto bin = load > 0.0 ? (int) std::floor(std::log2(load) * binsPerOctave) - minOctave * binsPerOctave : 0;
+    auto& counter = bins[(size_t) juce::jlimit(0, numBins - 1, bin)];
+
+    // Single writer: plain read-modify-write is enough
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum.store(sum.load(std::memory_order_relaxed) + load, std::memory_order_relaxed);
+    if (load > max.load(std::memory_order_relaxed))
+        max.store(load, std::memory_order_relaxed);
+}
+
+void DeadlineMonitor::Histogram::clear() noexcept
+{
+    for (auto& bin : bins)
+        bin.store(0, std::memory_order_relaxed);
+
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0.0, std::memory_order_relaxed);
+    max.store(0.0, std::memory_order_relaxed);
+}
+
+DeadlineMonitor::Stats DeadlineMonitor::Histogram::getStats() const noexcept
+{
+    std::array<std::uint32_t, numBins> snapshot;
+    std::uint64_t total = 0;
+
+    for (size_t i = 0; i < snapshot.size(); ++i)
+        total += (snapshot[i] = bins[i].load(std::memory_order_relaxed));
+
+    Stats stats;
+    stats.count = count.load(std::memory_order_relaxed);
+    stats.max = max.load(std::memory_order_relaxed);
+    stats.mean = stats.count > 0 ? sum.load(std::memory_order_relaxed) / (double) stats.count : 0.0;
+
+    if (total == 0)
+        return stats;
+
+    // Centre of the bin holding the given rank
+    const auto percentile = [&] (double p)
+    {
+        const auto rank = (std::uint64_t) (p * (double) (total - 1));
+        std::uint64_t seen = 0;
+        int bin = 0;
+
+        for (; bin < numBins - 1; ++bin)
+            if ((seen += snapshot[(size_t) bin]) > rank)
+                break;
+
+        return std::exp2(((double) (bin + minOctave * binsPerOctave) + 0.5) / binsPerOctave);
+    };
+
+    stats.p50 = juce::jmin(stats.max, percentile(0.5));
+    stats.p99 = juce::jmin(stats.max, percentile(0.99));
+    return stats;
+}
@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+    DeadlineMonitor.h
+    Splits each block's time into processing stages and keeps their statistics against the deadline.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Always-on timing of processBlock, stage by stage, against the block's real-time budget.
+ *
+ * The audio thread calls beginBlock(), mark() after each stage and endBlock(); each mark charges the
+ * time since the previous one to its stage, so a stage can be marked more than once per block. Time
+ * after the last mark counts towards the block but no stage.
+ *
+ * Times are read from the CPU's cycle counter (the TSC on x86, the virtual counter on ARM64, the
+ * high-resolution clock elsewhere), which costs a few nanoseconds per mark. The counter's rate is
+ * measured against the high-resolution clock at prepare() and refined as blocks go by.
+ *
+ * Every stage, and the whole block, keeps a histogram of its load (time over the block's budget) in
+ * log-spaced bins, from which getStats() reads p50 and p99 to within a bin (about 9%). The histograms,
+ * counters and the recent history are atomics written only by the audio thread, so they can be read
+ * from any thread without locks; a reader may see a block half recorded. reset() is carried out by the
+ * audio thread at its next block.
+ */
+class DeadlineMonitor
+{
+public:
+    enum Stage : int
+    {
+        input = 0,   // host and live MIDI in, transport
+        following,   // matching, pause detection and tempo tracking
+        prediction,  // generating, pre-rendering and storing the prediction
+        merging,     // routing the streams and the MIDI output, publishing the timeline
+        synthesis,   // rendering the voices
+        numStages
+    };
+
+    struct Stats
+    {
+        std::uint64_t count = 0;
+        double mean = 0.0, p50 = 0.0, p99 = 0.0, max = 0.0;  // fractions of the budget
+    };
+
+    static constexpr int historySize = 256;
+
+    /** Sets the budget's sample rate, calibrates the cycle counter and clears the statistics. */
+    void prepare(double sampleRate);
+
+    void beginBlock() noexcept;
+    void mark(Stage stage) noexcept;
+    void endBlock(int numSamples) noexcept;
+
+    /** Load of one stage, or of the whole block with numStages. */
+    Stats getStats(int stage = numStages) const noexcept;
+
+    /** Fractions of the budget the last block spent in one stage, or in all of it with numStages. */
+    double getLastLoad(int stage = numStages) const noexcept  { return lastLoads[(size_t) stage].load(std::memory_order_relaxed); }
+
+    std::uint64_t getNumBlocks() const noexcept    { return numBlocks.load(std::memory_order_relaxed); }
+    std::uint64_t getNumOverruns() const noexcept  { return overruns.load(std::memory_order_relaxed); }
+
+    /** Block loads of the last historySize blocks, oldest first. */
+    void getHistory(std::array<float, historySize>& loads) const noexcept;
+
+    /** Asks the audio thread to clear the statistics at its next block. */
+    void reset() noexcept  { resetRequested.store(true, std::memory_order_relaxed); }
+
+    static const char* getStageName(int stage) noexcept;
+
+private:
+    // 8 bins per octave, from 1/4096 to 16 times the budget
+    static constexpr int binsPerOctave = 8;
+    static constexpr int minOctave = -12;
+    static constexpr int numBins = (4 - minOctave) * binsPerOctave;
+
+    struct Histogram
+    {
+        std::array<std::atomic<std::uint32_t>, numBins> bins {};
+        std::atomic<std::uint64_t> count { 0 };
+        std::atomic<double> sum { 0.0 }, max { 0.0 };
+
+        void add(double load) noexcept;
+        void clear() noexcept;
+        Stats getStats() const noexcept;
+    };
+
+    static std::uint64_t readCycles() noexcept;
+    void clear() noexcept;
+
+    double sampleRate = 44100.0;
+    double secondsPerCycle = 1.0e-9;
+    std::uint64_t calibrationCycles = 0;
+    juce::int64 calibrationTicks = 0;
+
+    std::uint64_t blockStart = 0, lastMark = 0;
+    std::array<std::uint64_t, numStages> stageCycles {};
+
+    std::array<Histogram, numStages + 1> histograms;
+    std::array<std::atomic<double>, numStages + 1> lastLoads {};
+    std::array<std::atomic<float>, historySize> history {};
+    std::atomic<std::uint32_t> historyWrite { 0 };
+    std::atomic<std::uint64_t> numBlocks { 0 }, overruns { 0 };
+    std::atomic<bool> resetRequested { false };
+};
@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    DeadlinePlotSource.h
+    Plots the recent block loads of a DeadlineMonitor in the PGM editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DeadlineMonitor.h"
+
+/**
+ * @brief A Plot source for the editor: the load of the last DeadlineMonitor::historySize blocks, oldest
+ * on the left, on a scale where the budget is half the height, with the budget drawn across.
+ *
+ * The audio thread calls update() after each block it wants drawn; the plot reads the monitor's
+ * history when the editor repaints.
+ */
+class DeadlinePlotSource  : public foleys::MagicPlotSource
+{
+public:
+    explicit DeadlinePlotSource(const DeadlineMonitor& monitorToPlot) : monitor(monitorToPlot) {}
+
+    void update() noexcept  { resetLastDataFlag(); }
+
+    void pushSamples(const juce::AudioBuffer<float>&) override  { update(); }
+
+    void createPlotPaths(juce::Path& path, juce::Path& filledPath, juce::Rectangle<float> bounds, foleys::MagicPlotComponent&) override
+    {
+        monitor.getHistory(loads);
+
+        const auto y = [&bounds] (float load)  { return bounds.getBottom() - juce::jlimit(0.0f, 2.0f, load) * 0.5f * bounds.getHeight(); };
+        const auto step = bounds.getWidth() / (float) (DeadlineMonitor::historySize - 1);
+
+        path.clear();
+        path.startNewSubPath(bounds.getX(), y(loads[0]));
+        for (int i = 1; i < DeadlineMonitor::historySize; ++i)
+            path.lineTo(bounds.getX() + (float) i * step, y(loads[(size_t) i]));
+
+        filledPath = path;
+        filledPath.lineTo(bounds.getBottomRight());
+        filledPath.lineTo(bounds.getBottomLeft());
+        filledPath.closeSubPath();
+
+        path.startNewSubPath(bounds.getX(), y(1.0f));
+        path.lineTo(bounds.getRight(), y(1.0f));
+    }
+
+private:
+    const DeadlineMonitor& monitor;
+    std::array<float, DeadlineMonitor::historySize> loads {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeadlinePlotSource)
+};
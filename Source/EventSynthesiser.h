@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    EventSynthesiser.h
+    juce::Synthesiser that renders straight from a MidiRouter merge.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MidiRouter.h"
+#include "RenderPool.h"
+
+#include <vector>
+
+/**
+ * @brief A `juce::Synthesiser` that pulls its events from a `MidiRouter::Merge` instead of a MidiBuffer.
+ *
+ * This follows `juce::Synthesiser::processNextBlock`: voices are rendered up to each event, then the event
+ * is handled. Events that arrived late (negative time) are handled at the start of the block, and events
+ * past the end of the block are handled after rendering it.
+ *
+ * With a RenderPool set, the active voices are rendered in chunks of `voicesPerChunk` on the pool. Each
+ * voice renders into its own scratch buffer, and the voices are then added to the output one by one in
+ * voice order. A voice adds its signal to each output sample once, so the additions happen in the same
+ * order as in `juce::Synthesiser`'s serial rendering and the output is the same, sample for sample,
+ * whatever the number of threads or the thread that rendered a voice.
+ */
+class EventSynthesiser : public juce::Synthesiser
+{
+public:
+    using juce::Synthesiser::renderNextBlock;
+
+    void renderNextBlock(juce::AudioBuffer<float>& outputAudio, MidiRouter::Merge events, int startSample, int numSamples)
+    {
+        // must set the sample rate before using this!
+        jassert(getSampleRate() != 0);
+
+        const juce::ScopedLock sl(lock);
+
+        const int blockStart = startSample;
+        const int endSample = startSample + numSamples;
+        MidiEvent e;
+
+        while (events.next(e))
+        {
+            const int position = juce::jlimit(startSample, endSample, blockStart + e.sampleTime);
+
+            if (position > startSample)
+            {
+                renderVoices(outputAudio, startSample, position - startSample);
+                startSample = position;
+            }
+
+            handleMidiEvent(e.toMessage());
+        }
+
+        if (startSample < endSample)
+            renderVoices(outputAudio, startSample, endSample - startSample);
+    }
+
+    static constexpr int voicesPerChunk = 4;
+
+    /**
+     * Renders the voices on `poolToUse`, or serially if it is nullptr. Allocates scratch space for every voice
+     * for blocks of up to `maxNumChannels` x `maxBlockSize`, so call it off the audio thread after adding
+     * the voices.
+     * Larger blocks and more voices than were there at this call fall back to serial rendering.
+     */
+    void setRenderPool(RenderPool* poolToUse, int maxNumChannels, int maxBlockSize)
+    {
+        const juce::ScopedLock sl(lock);
+
+        pool = poolToUse;
+        activeVoices.clear();
+        activeVoices.reserve((size_t) voices.size());
+
+        voiceAudio.setSize(juce::jmax(1, voices.size() * maxNumChannels), maxBlockSize);
+        maxVoiceChannels = maxNumChannels;
+    }
+
+protected:
+    using juce::Synthesiser::renderVoices;
+
+    void renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) override
+    {
+        const int numChannels = outputAudio.getNumChannels();
+
+        if (pool == nullptr || numSamples > voiceAudio.getNumSamples() || numChannels > maxVoiceChannels
+             || (size_t) voices.size() > activeVoices.capacity())
+        {
+            juce::Synthesiser::renderVoices(outputAudio, startSample, numSamples);
+            return;
+        }
+
+        activeVoices.clear();
+        for (auto* voice : voices)
+            if (voice->isVoiceActive())
+                activeVoices.push_back(voice);
+
+        const int numChunks = ((int) activeVoices.size() + voicesPerChunk - 1) / voicesPerChunk;
+
+        if (numChunks < 2)
+        {
+            juce::Synthesiser::renderVoices(outputAudio, startSample, numSamples);
+            return;
+        }
+
+        pendingNumChannels = numChannels;
+        pendingNumSamples = numSamples;
+        pool->run(renderChunk, this, numChunks);
+
+        for (int v = 0; v < (int) activeVoices.size(); ++v)
+            for (int ch = 0; ch < numChannels; ++ch)
+                outputAudio.addFrom(ch, startSample, voiceAudio.getReadPointer(v * numChannels + ch), numSamples);
+    }
+
+private:
+    static void renderChunk(void* context, int chunk)
+    {
+        auto& self = *static_cast<EventSynthesiser*>(context);
+
+        const auto first = (size_t) (chunk * voicesPerChunk);
+        const auto last = juce::jmin(first + (size_t) voicesPerChunk, self.activeVoices.size());
+
+        for (auto v = first; v < last; ++v)
+        {
+            // A view on this voice's channels of the scratch buffer; refers to the data without allocating
+            juce::AudioBuffer<float> scratch(self.voiceAudio.getArrayOfWritePointers() + (int) v * self.pendingNumChannels,
+                                             self.pendingNumChannels, self.pendingNumSamples);
+            scratch.clear();
+            self.activeVoices[v]->renderNextBlock(scratch, 0, self.pendingNumSamples);
+        }
+    }
+
+    RenderPool* pool = nullptr;
+    std::vector<juce::SynthesiserVoice*> activeVoices;
+    juce::AudioBuffer<float> voiceAudio;
+    int maxVoiceChannels = 0;
+    int pendingNumChannels = 0;
+    int pendingNumSamples = 0;
+};
@@ -21,8 +21,6 @@ namespace IDs
 
 //==============================================================================
 
-int FoleysSynth::numOscillators = 8;
-
 void FoleysSynth::addADSRParameters (juce::AudioProcessorValueTreeState::ParameterLayout& layout)
 {
     auto attack  = std::make_unique<juce::AudioParameterFloat>(juce::ParameterID (IDs::paramAttack, 1),  "Attack",  juce::NormalisableRange<float> (0.001f, 0.5f, 0.01f), 0.10f);
@@ -43,7 +41,9 @@ void FoleysSynth::addOvertoneParameters (juce::AudioProcessorValueTreeState::Par
     auto group = std::make_unique<juce::AudioProcessorParameterGroup>("oscillators", "Oscillators", "|");
     for (int i = 0; i < FoleysSynth::numOscillators; ++i)
     {
-        group->addChild (std::make_unique<juce::AudioParameterFloat>(juce::ParameterID ("osc" + juce::String (i), 1), "Oscillator " + juce::String (i), juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f), 0.0f));
+        // Default to a soft, piano-like spectrum falling off with the square of the harmonic number
+        const auto defaultGain = std::round (100.0f / float ((i + 1) * (i + 1))) / 100.0f;
+        group->addChild (std::make_unique<juce::AudioParameterFloat>(juce::ParameterID ("osc" + juce::String (i), 1), "Oscillator " + juce::String (i), juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f), defaultGain));
         group->addChild (std::make_unique<juce::AudioParameterFloat>(juce::ParameterID ("detune" + juce::String (i), 1), "Detune " + juce::String (i), juce::NormalisableRange<float>(-0.5f, 0.5f, 0.01f), 0.0f));
     }
 
@@ -57,6 +57,30 @@ void FoleysSynth::addGainParameters (juce::AudioProcessorValueTreeState::Paramet
     layout.add (std::make_unique<juce::AudioProcessorParameterGroup>("output", "Output", "|", std::move (gain)));
 }
 
+void FoleysSynth::cullQuietestVoices (int maxActiveVoices)
+{
+    const juce::ScopedLock sl (lock);
+
+    int numActive = 0;
+    for (auto* voice : voices)
+        numActive += voice->isVoiceActive() ? 1 : 0;
+
+    for (; numActive > maxActiveVoices; --numActive)
+    {
+        FoleysVoice* quietest = nullptr;
+
+        for (auto* voice : voices)
+            if (auto* foleysVoice = dynamic_cast<FoleysVoice*> (voice))
+                if (foleysVoice->isVoiceActive() && (quietest == nullptr || foleysVoice->getLoudness() < quietest->getLoudness()))
+                    quietest = foleysVoice;
+
+        if (quietest == nullptr)
+            break;
+
+        quietest->stopNote (0.0f, false);
+    }
+}
+
 //==============================================================================
 
 FoleysSynth::FoleysSound::FoleysSound (juce::AudioProcessorValueTreeState& stateToUse)
@@ -72,6 +96,13 @@ FoleysSynth::FoleysSound::FoleysSound (juce::AudioProcessorValueTreeState& state
     jassert (release);
     gain = dynamic_cast<juce::AudioParameterFloat*>(state.getParameter (IDs::paramGain));
     jassert (gain);
+
+    for (int i=0; i < FoleysSynth::numOscillators; ++i)
+    {
+        partialGains[size_t (i)] = dynamic_cast<juce::AudioParameterFloat*>(state.getParameter ("osc" + juce::String (i)));
+        partialDetunes[size_t (i)] = dynamic_cast<juce::AudioParameterFloat*>(state.getParameter ("detune" + juce::String (i)));
+        jassert (partialGains[size_t (i)] && partialDetunes[size_t (i)]);
+    }
 }
 
 juce::ADSR::Parameters FoleysSynth::FoleysSound::getADSR()
@@ -86,46 +117,33 @@ juce::ADSR::Parameters FoleysSynth::FoleysSound::getADSR()
 
 //==============================================================================
 
-FoleysSynth::FoleysVoice::FoleysVoice (juce::AudioProcessorValueTreeState& state)
+bool FoleysSynth::FoleysVoice::canPlaySound (juce::SynthesiserSound* soundToCheck)
 {
-    for (int i=0; i < FoleysSynth::numOscillators; ++i)
-    {
-        oscillators.push_back (std::make_unique<BaseOscillator>());
-        auto& osc = oscillators.back();
-        osc->gain = dynamic_cast<juce::AudioParameterFloat*>(state.getParameter ("osc" + juce::String (i)));
-        osc->detune = dynamic_cast<juce::AudioParameterFloat*>(state.getParameter ("detune" + juce::String (i)));
-        osc->osc.get<0>().initialise ([](auto arg){return std::sin (arg);}, 512);
-        osc->multiplier = i + 1;
-    }
-
-    gainParameter = dynamic_cast<juce::AudioParameterFloat*>(state.getParameter (IDs::paramGain));
-    jassert (gainParameter);
-
-    oscillatorBuffer.setSize (1, internalBufferSize);
-    voiceBuffer.setSize (1, internalBufferSize);
-}
-
-bool FoleysSynth::FoleysVoice::canPlaySound (juce::SynthesiserSound* sound)
-{
-    return dynamic_cast<FoleysSound*>(sound) != nullptr;
+    return dynamic_cast<FoleysSound*>(soundToCheck) != nullptr;
 }
 
 void FoleysSynth::FoleysVoice::startNote (int midiNoteNumber,
                                           float velocity,
-                                          juce::SynthesiserSound* sound,
+                                          juce::SynthesiserSound* soundToPlay,
                                           int currentPitchWheelPosition)
 {
-    juce::ignoreUnused (midiNoteNumber, velocity);
+    juce::ignoreUnused (midiNoteNumber);
 
-    if (auto* foleysSound = dynamic_cast<FoleysSound*>(sound))
-        adsr.setParameters (foleysSound->getADSR());
+    sound = dynamic_cast<FoleysSound*>(soundToPlay);
+    jassert (sound != nullptr);
+
+    adsr.setParameters (sound->getADSR());
 
     pitchWheelValue = getDetuneFromPitchWheel (currentPitchWheelPosition);
+    level = velocity * 0.15f; // same loudness as the sine engine
+    envelopeLevel = 1.0f;     // a new note counts as loud until it has rendered
+    keyDown = true;
+    envelopeSteady = false;
 
     adsr.noteOn();
 
-    for (auto& osc : oscillators)
-        updateFrequency (*osc, true);
+    partials.resetPhases();
+    updateFrequencies (true);
 }
 
 void FoleysSynth::FoleysVoice::stopNote (float velocity,
@@ -133,6 +151,9 @@ void FoleysSynth::FoleysVoice::stopNote (float velocity,
 {
     juce::ignoreUnused (velocity);
 
+    keyDown = false;
+    envelopeSteady = false;
+
     if (allowTailOff)
     {
         adsr.noteOff();
@@ -158,53 +179,133 @@ void FoleysSynth::FoleysVoice::renderNextBlock (juce::AudioBuffer<float>& output
                                                 int startSample,
                                                 int numSamples)
 {
-    if (! adsr.isActive())
+    if (! adsr.isActive() || sound == nullptr)
         return;
 
-    while (numSamples > 0)
+    // Parameters are read once per block; pow() only runs when a detune or the pitch wheel moved
+    updateFrequencies();
+
+    partials.setNumActivePartials (sound->getMaxPartials());
+
+    const auto& partialGains = sound->getPartialGains();
+    for (size_t i = 0; i < partialGains.size(); ++i)
+    {
+        const auto oscGain = partialGains[i] != nullptr ? partialGains[i]->get() : 0.0f;
+        partials.setGain (int (i), oscGain < 0.01f ? 0.0f : oscGain);
+    }
+
+    // An ADSR only repeats a value in its sustain stage, which lasts while the key is down
+    const auto allLanes      = partials.getNumActiveLanes() == PartialBank::maxPartials ? 1 : 0;
+    const auto constantEnv   = keyDown && envelopeSteady ? 1 : 0;
+    const auto numChannels   = outputBuffer.getNumChannels();
+    const auto channelLayout = numChannels == 1 ? 1 : numChannels == 2 ? 2 : 0;
+
+    (this->*blockRenderers[allLanes][constantEnv][channelLayout]) (outputBuffer, startSample, numSamples);
+}
+
+template <int numLanes, bool constantEnvelope, int numChannels>
+void FoleysSynth::FoleysVoice::renderBlock (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
+{
+    // Passes the ADSR through and keeps its last value, for getLoudness() and the steady check
+    struct TrackedEnvelope
     {
-        auto left = std::min (numSamples, oscillatorBuffer.getNumSamples());
-        auto block = juce::dsp::AudioBlock<float> (oscillatorBuffer).getSingleChannelBlock (0).getSubBlock (0, size_t (left));
+        juce::ADSR& adsr;
+        float& lastValue;
+        bool& steady;
 
-        juce::dsp::ProcessContextReplacing<float> context (block);
-        voiceBuffer.clear();
-        for (auto& osc : oscillators)
+        float getNextSample() noexcept
         {
-            auto oscGain = osc->gain->get();
-            if (oscGain < 0.01)
-                continue;
-
-            updateFrequency (*osc);
-            osc->osc.get<1>().setGainLinear (oscGain);
-            oscillatorBuffer.clear();
-            osc->osc.process (context);
-            voiceBuffer.addFrom (0, 0, oscillatorBuffer.getReadPointer (0), left);
+            const auto value = adsr.getNextSample();
+            steady = value == lastValue;
+            return lastValue = value;
         }
+    } envelope { adsr, envelopeLevel, envelopeSteady };
 
-        adsr.applyEnvelopeToBuffer (voiceBuffer, 0, left);
+    PartialBank::ConstantEnvelope constant;
+
+    while (numSamples > 0)
+    {
+        auto left = std::min (numSamples, internalBufferSize);
+
+        // Partials, envelope and gain ramp in a single pass
+        const auto gain = sound->getGain();
+
+        if constexpr (constantEnvelope)
+            partials.renderLanes<numLanes> (voiceBuffer.data(), left, constant,
+                                            lastGain * level * envelopeLevel, gain * level * envelopeLevel);
+        else
+            partials.renderLanes<numLanes> (voiceBuffer.data(), left, envelope, lastGain * level, gain * level);
 
-        const auto gain = gainParameter->get();
-        outputBuffer.addFromWithRamp (0, startSample, voiceBuffer.getReadPointer (0), left, lastGain, gain);
         lastGain = gain;
 
+        addToOutput<numChannels> (outputBuffer, startSample, left);
+
         startSample += left;
         numSamples  -= left;
 
-        if (! adsr.isActive())
-            clearCurrentNote();
+        // A held sustain stays active; only the per-sample envelope can run out
+        if constexpr (! constantEnvelope)
+        {
+            if (! adsr.isActive())
+            {
+                clearCurrentNote();
+                break;
+            }
+        }
     }
 }
 
+template <int numChannels>
+void FoleysSynth::FoleysVoice::addToOutput (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) noexcept
+{
+    if constexpr (numChannels == 2)
+    {
+        auto* left  = outputBuffer.getWritePointer (0, startSample);
+        auto* right = outputBuffer.getWritePointer (1, startSample);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            left[i]  += voiceBuffer[(size_t) i];
+            right[i] += voiceBuffer[(size_t) i];
+        }
+    }
+    else if constexpr (numChannels == 1)
+    {
+        outputBuffer.addFrom (0, startSample, voiceBuffer.data(), numSamples);
+    }
+    else
+    {
+        for (int ch = 0; ch < outputBuffer.getNumChannels(); ++ch)
+            outputBuffer.addFrom (ch, startSample, voiceBuffer.data(), numSamples);
+    }
+}
+
+const FoleysSynth::FoleysVoice::BlockRenderer FoleysSynth::FoleysVoice::blockRenderers[2][2][3] =
+{
+    {
+        { &FoleysVoice::renderBlock<PartialBank::maxPartials / 2, false, 0>,
+          &FoleysVoice::renderBlock<PartialBank::maxPartials / 2, false, 1>,
+          &FoleysVoice::renderBlock<PartialBank::maxPartials / 2, false, 2> },
+        { &FoleysVoice::renderBlock<PartialBank::maxPartials / 2, true, 0>,
+          &FoleysVoice::renderBlock<PartialBank::maxPartials / 2, true, 1>,
+          &FoleysVoice::renderBlock<PartialBank::maxPartials / 2, true, 2> }
+    },
+    {
+        { &FoleysVoice::renderBlock<PartialBank::maxPartials, false, 0>,
+          &FoleysVoice::renderBlock<PartialBank::maxPartials, false, 1>,
+          &FoleysVoice::renderBlock<PartialBank::maxPartials, false, 2> },
+        { &FoleysVoice::renderBlock<PartialBank::maxPartials, true, 0>,
+          &FoleysVoice::renderBlock<PartialBank::maxPartials, true, 1>,
+          &FoleysVoice::renderBlock<PartialBank::maxPartials, true, 2> }
+    }
+};
+
 void FoleysSynth::FoleysVoice::setCurrentPlaybackSampleRate (double newRate)
 {
     juce::SynthesiserVoice::setCurrentPlaybackSampleRate (newRate);
 
-    juce::dsp::ProcessSpec spec;
-    spec.sampleRate = newRate;
-    spec.maximumBlockSize = juce::uint32 (internalBufferSize);
-    spec.numChannels = 1;
-    for (auto& osc : oscillators)
-        osc->osc.prepare (spec);
+    adsr.setSampleRate (newRate);
+    partials.setSampleRate (newRate);
 }
 
 double FoleysSynth::FoleysVoice::getFrequencyForNote (int noteNumber, double detune, double concertPitch) const
@@ -217,10 +318,28 @@ double FoleysSynth::FoleysVoice::getDetuneFromPitchWheel (int wheelValue) const
     return (wheelValue / 8192.0) - 1.0;
 }
 
-void FoleysSynth::FoleysVoice::updateFrequency (BaseOscillator& oscillator, bool noteStart)
+void FoleysSynth::FoleysVoice::updateFrequencies (bool force)
 {
-    const auto freq = getFrequencyForNote (getCurrentlyPlayingNote(),
-                                           pitchWheelValue * maxPitchWheelSemitones
-                                           + oscillator.detune->get());
-    oscillator.osc.get<0>().setFrequency (float (freq * oscillator.multiplier), noteStart);
+    const auto& partialDetunes = sound->getPartialDetunes();
+    bool changed = force || pitchWheelValue != lastPitchWheelValue;
+
+    for (size_t i = 0; i < partialDetunes.size(); ++i)
+    {
+        const auto detune = partialDetunes[i] != nullptr ? partialDetunes[i]->get() : 0.0f;
+        changed = changed || detune != lastDetunes[i];
+        lastDetunes[i] = detune;
+    }
+
+    if (! changed)
+        return;
+
+    lastPitchWheelValue = pitchWheelValue;
+
+    for (size_t i = 0; i < partialDetunes.size(); ++i)
+    {
+        const auto freq = getFrequencyForNote (getCurrentlyPlayingNote(),
+                                               pitchWheelValue * maxPitchWheelSemitones
+                                               + lastDetunes[i]);
+        partials.setFrequency (int (i), freq * double (i + 1));
+    }
 }
@@ -10,12 +10,15 @@
 
 #pragma once
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
+#include "EventSynthesiser.h"
+#include "PartialBank.h"
 
-class FoleysSynth : public juce::Synthesiser
+class FoleysSynth : public EventSynthesiser
 {
 public:
-    static int  numOscillators;
+    /** Partials per voice, one oscillator parameter pair each; fixed at compile time, like the kernels. */
+    static constexpr int numOscillators = PartialBank::maxPartials;
 
     static void addADSRParameters (juce::AudioProcessorValueTreeState::ParameterLayout& layout);
     static void addOvertoneParameters (juce::AudioProcessorValueTreeState::ParameterLayout& layout);
@@ -23,6 +26,9 @@ public:
 
     FoleysSynth() = default;
 
+    /** Stops the quietest voices, without tail, until at most `maxActiveVoices` are left sounding. */
+    void cullQuietestVoices (int maxActiveVoices);
+
     class FoleysSound : public juce::SynthesiserSound
     {
     public:
@@ -32,6 +38,18 @@ public:
 
         juce::ADSR::Parameters getADSR();
 
+        /**
+         * The overtone parameters, resolved once here and shared by every voice playing this sound.
+         * Slots past numOscillators are nullptr.
+         */
+        const std::array<juce::AudioParameterFloat*, PartialBank::maxPartials>& getPartialGains() const noexcept    { return partialGains; }
+        const std::array<juce::AudioParameterFloat*, PartialBank::maxPartials>& getPartialDetunes() const noexcept  { return partialDetunes; }
+        float getGain() const noexcept  { return gain->get(); }
+
+        /** Limits every voice playing this sound to its first `numPartials` partials, e.g. under CPU pressure. */
+        void setMaxPartials (int numPartials) noexcept  { maxPartials.store (numPartials, std::memory_order_relaxed); }
+        int  getMaxPartials() const noexcept            { return maxPartials.load (std::memory_order_relaxed); }
+
     private:
         juce::AudioProcessorValueTreeState& state;
         juce::AudioParameterFloat* attack  = nullptr;
@@ -40,13 +58,28 @@ public:
         juce::AudioParameterFloat* release = nullptr;
         juce::AudioParameterFloat* gain    = nullptr;
 
+        // One lane of the partial bank per oscillator; partial i runs at (i + 1) times the note frequency
+        std::array<juce::AudioParameterFloat*, PartialBank::maxPartials> partialGains   {};
+        std::array<juce::AudioParameterFloat*, PartialBank::maxPartials> partialDetunes {};
+        std::atomic<int> maxPartials { PartialBank::maxPartials };
+
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FoleysSound)
     };
 
+    /**
+     * A voice holds only its playing state: partial phases and increments, the envelope and a small
+     * render scratch. Parameters come from the FoleysSound it plays and the sines are computed, not
+     * looked up, so a voice owns no tables and constructing one allocates nothing.
+     *
+     * Each block is rendered by one of a table of renderers, specialised on the number of partials
+     * (half or all), the envelope (per sample, or constant once the ADSR holds its sustain level with the
+     * key down) and the output channels (mono, stereo or any). The table is indexed per block, so a voice
+     * moves to the cheaper kernels as soon as its envelope settles or the governor halves its partials.
+     */
     class FoleysVoice : public juce::SynthesiserVoice
     {
     public:
-        FoleysVoice (juce::AudioProcessorValueTreeState& state);
+        FoleysVoice() = default;
 
         bool canPlaySound (juce::SynthesiserSound *) override;
 
@@ -67,37 +100,45 @@ public:
 
         void setCurrentPlaybackSampleRate (double newRate) override;
 
+        /** Output level at the end of the last rendered block: velocity times envelope. */
+        float getLoudness() const noexcept  { return level * envelopeLevel; }
+
     private:
 
-        class BaseOscillator
-        {
-        public:
-            BaseOscillator() = default;
+        double getDetuneFromPitchWheel (int wheelValue) const;
+        double getFrequencyForNote (int noteNumber, double detune, double concertPitch = 440.0) const;
 
-            juce::dsp::ProcessorChain<juce::dsp::Oscillator<float>, juce::dsp::Gain<float>> osc;
-            juce::AudioParameterFloat* gain   = nullptr;
-            juce::AudioParameterFloat* detune = nullptr;
-            double multiplier = 1.0;
+        /** Recomputes the partial frequencies if the pitch wheel or a detune parameter changed. */
+        void updateFrequencies (bool force = false);
 
-        private:
-            JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BaseOscillator)
-        };
+        template <int numLanes, bool constantEnvelope, int numChannels>
+        void renderBlock (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples);
 
-        double getDetuneFromPitchWheel (int wheelValue) const;
-        double getFrequencyForNote (int noteNumber, double detune, double concertPitch = 440.0) const;
+        /** Adds the first `numSamples` of voiceBuffer to the output; 0 channels means any number. */
+        template <int numChannels>
+        void addToOutput (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) noexcept;
+
+        using BlockRenderer = void (FoleysVoice::*) (juce::AudioBuffer<float>&, int, int);
+
+        /** Indexed by [half or all partials][per-sample or constant envelope][any, mono or stereo output]. */
+        static const BlockRenderer blockRenderers[2][2][3];
 
-        void updateFrequency (BaseOscillator& oscillator, bool noteStart = false);
+        static constexpr int internalBufferSize = 64;
 
-        std::vector<std::unique_ptr<BaseOscillator>> oscillators;
+        FoleysSound*                sound = nullptr;
+        std::array<float, PartialBank::maxPartials> lastDetunes {};
+        double                      lastPitchWheelValue = 0.0;
+        PartialBank                 partials;
 
         double                      pitchWheelValue = 0.0;
         int                         maxPitchWheelSemitones = 12;
-        const int                   internalBufferSize = 64;
-        juce::AudioBuffer<float>    oscillatorBuffer;
-        juce::AudioBuffer<float>    voiceBuffer;
+        alignas(32) std::array<float, internalBufferSize> voiceBuffer {};
         juce::ADSR                  adsr;
-        juce::AudioParameterFloat*  gainParameter = nullptr;
         float                       lastGain = 0.0;
+        float                       level = 0.0;
+        float                       envelopeLevel = 0.0;
+        bool                        keyDown = false;
+        bool                        envelopeSteady = false; // the last two envelope samples were equal
 
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FoleysVoice)
     };
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    FollowerSettings.cpp
+    Tuning of the score follower, and the per-piece presets that hold it.
+
+  ==============================================================================
+*/
+
+#include "FollowerSettings.h"
+#include "Trace.h"
+
+juce::var FollowerSettings::toVar() const
+{
+    auto* object = new juce::DynamicObject();
+    object->setProperty("tempoSmoothing", tempoSmoothing);
+    object->setProperty("matchWindowSeconds", matchWindowSeconds);
+    object->setProperty("lagBlocks", lagBlocks);
+    object->setProperty("densityWindowSeconds", densityWindowSeconds);
+    return juce::var(object);
+}
+
+FollowerSettings FollowerSettings::fromVar(const juce::var& value)
+{
+    FollowerSettings settings;
+
+    const auto read = [&value] (const char* name, double fallback)
+    {
+        return value.hasProperty(name) ? (double) value[name] : fallback;
+    };
+
+    settings.tempoSmoothing = juce::jlimit(0.0, 1.0, read("tempoSmoothing", settings.tempoSmoothing));
+    settings.matchWindowSeconds = juce::jlimit(0.001, 10.0, read("matchWindowSeconds", settings.matchWindowSeconds));
+    settings.lagBlocks = juce::jlimit(1, 1000, (int) read("lagBlocks", settings.lagBlocks));
+    settings.densityWindowSeconds = juce::jlimit(0.1, 600.0, read("densityWindowSeconds", settings.densityWindowSeconds));
+    return settings;
+}
+
+bool FollowerSettings::operator== (const FollowerSettings& other) const noexcept
+{
+    return tempoSmoothing == other.tempoSmoothing
+        && matchWindowSeconds == other.matchWindowSeconds
+        && lagBlocks == other.lagBlocks
+        && densityWindowSeconds == other.densityWindowSeconds;
+}
+
+//==============================================================================
+juce::File FollowerPresets::getDefaultFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("MidiPredict")
+        .getChildFile("FollowerPresets.json");
+}
+
+bool FollowerPresets::load(const juce::File& file)
+{
+    MP_TRACE_SCOPE("FollowerPresets::load");
+    presets.clear();
+
+    if (! file.existsAsFile())
+        return false;
+
+    const auto json = juce::JSON::parse(file);
+    const auto* object = json.getDynamicObject();
+
+    if (object == nullptr)
+    {
+        juce::Logger::writeToLog("Error reading follower presets: " + file.getFullPathName());
+        return false;
+    }
+
+    for (const auto& property : object->getProperties())
+        presets[property.name.toString()] = FollowerSettings::fromVar(property.value);
+
+    return true;
+}
+
+bool FollowerPresets::save(const juce::File& file) const
+{
+    auto* object = new juce::DynamicObject();
+    for (const auto& [scoreName, settings] : presets)
+        object->setProperty(scoreName, settings.toVar());
+
+    return file.getParentDirectory().createDirectory().wasOk()
+        && file.replaceWithText(juce::JSON::toString(juce::var(object)));
+}
+
+const FollowerSettings* FollowerPresets::find(const juce::File& scoreFile) const
+{
+    const auto it = presets.find(scoreFile.getFileName());
+    return it != presets.end() ? &it->second : nullptr;
+}
+
+void FollowerPresets::set(const juce::File& scoreFile, const FollowerSettings& settings)
+{
+    presets[scoreFile.getFileName()] = settings;
+}
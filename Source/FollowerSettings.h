@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    FollowerSettings.h
+    Tuning of the score follower, and the per-piece presets that hold it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <map>
+
+/**
+ * @brief The follower's tuning: how fast the tempo estimate moves, how far apart a predicted and a
+ * played note may be to match, how far ahead the prediction runs and how long the density window is.
+ *
+ * The defaults are the values the follower has always used; the right ones differ by piece and by
+ * performer, which is what the offline tuner searches for.
+ */
+struct FollowerSettings
+{
+    double tempoSmoothing = 0.99;       // weight of the previous tempo estimate in each block's update
+    double matchWindowSeconds = 0.2;    // predicted notes unmatched for longer than this pause the prediction
+    int lagBlocks = 20;                 // blocks the prediction runs ahead of the live input
+    double densityWindowSeconds = 10.0; // note density is compared over this much of the past
+
+    juce::var toVar() const;
+
+    /** Reads the properties toVar() writes; missing ones keep their defaults, and values are clamped to a usable range. */
+    static FollowerSettings fromVar(const juce::var& value);
+
+    bool operator== (const FollowerSettings& other) const noexcept;
+    bool operator!= (const FollowerSettings& other) const noexcept  { return ! operator== (other); }
+};
+
+//==============================================================================
+/**
+ * @brief Follower settings per piece, keyed by the score's file name, in a JSON file.
+ *
+ * The plugin loads the file at getDefaultFile() when it starts and uses the entry for the score it
+ * reads at prepareToPlay; scores without an entry use the defaults.
+ */
+class FollowerPresets
+{
+public:
+    /** FollowerPresets.json in the user's application data folder, under MidiPredict. */
+    static juce::File getDefaultFile();
+
+    /** Replaces the presets with those in `file`; false, leaving them empty, if it is missing or unreadable. */
+    bool load(const juce::File& file);
+
+    bool save(const juce::File& file) const;
+
+    /** The preset for a score file, or nullptr. */
+    const FollowerSettings* find(const juce::File& scoreFile) const;
+
+    void set(const juce::File& scoreFile, const FollowerSettings& settings);
+
+    int size() const noexcept  { return (int) presets.size(); }
+
+private:
+    std::map<juce::String, FollowerSettings> presets;
+};
@@ -0,0 +1,191 @@
+/*
+  ==============================================================================
+
+    MidiEvent.h
+    Compact event type used by the internal MIDI pipeline.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief A packed, trivially copyable MIDI channel message with a sample timestamp.
+ *
+ * The score index, the matcher queues, the prediction timeline and the routing stage all move
+ * notes around as `MidiEvent`s rather than `juce::MidiMessage`s. Conversion to and from
+ * `juce::MidiBuffer` only happens at the host boundary (incoming MIDI, the synthesiser and the
+ * forwarded output).
+ *
+ * Only channel messages of up to three bytes are represented; meta events and SysEx are dropped
+ * when a file or buffer is converted (see `canRepresent`). Events arriving as MIDI 2.0 Universal
+ * MIDI Packets (see UmpInput.h) additionally keep a sub-sample onset and their 16-bit velocity,
+ * so the matcher is not limited by audio block quantization.
+ */
+struct MidiEvent
+{
+    /** Where an event came from, so that later stages can route or filter on it. */
+    enum Source : std::uint8_t
+    {
+        score = 0,
+        prediction,
+        live,
+        host
+    };
+
+    std::int32_t sampleTime; // in samples; absolute or block-relative depending on the container
+    std::uint8_t status;
+    std::uint8_t data1;
+    std::uint8_t data2;
+    std::uint8_t source;
+    std::uint16_t subSample;  // fraction of a sample after sampleTime, in 1/65536ths
+    std::uint16_t velocity16; // MIDI 2.0 resolution velocity for note messages, 0 otherwise
+
+    /** Scales a 7-bit value to 16 bits using the MIDI 2.0 min-center-max upscaling. */
+    static constexpr std::uint16_t scaleVelocity7To16(int v) noexcept
+    {
+        return v <= 0  ? std::uint16_t (0)
+             : v <= 64 ? std::uint16_t (v << 9)
+                       : std::uint16_t ((v << 9) | ((v & 0x3f) << 3) | ((v & 0x3f) >> 3));
+    }
+
+    //==============================================================================
+    static bool canRepresent(const juce::MidiMessage& m) noexcept
+    {
+        const auto status = m.getRawData()[0];
+        return m.getRawDataSize() <= 3 && status >= 0x80 && status < 0xf0;
+    }
+
+    static MidiEvent fromMessage(const juce::MidiMessage& m, int sampleTime, std::uint8_t source) noexcept
+    {
+        const auto* raw = m.getRawData();
+        const auto size = m.getRawDataSize();
+        return make(sampleTime, raw[0], size > 1 ? raw[1] : std::uint8_t (0), size > 2 ? raw[2] : std::uint8_t (0), source);
+    }
+
+    /** Builds an event from MIDI 1.0 bytes; note velocities are upscaled to 16 bits. */
+    static constexpr MidiEvent make(int sampleTime, std::uint8_t status, std::uint8_t data1, std::uint8_t data2, std::uint8_t source) noexcept
+    {
+        return { static_cast<std::int32_t>(sampleTime), status, data1, data2, source, 0,
+                 (status & 0xe0) == 0x80 ? scaleVelocity7To16(data2) : std::uint16_t (0) };
+    }
+
+    /** Onset in samples including the sub-sample fraction. */
+    double getPreciseTime() const noexcept  { return sampleTime + subSample * (1.0 / 65536.0); }
+
+    int getLength() const noexcept        { return juce::MidiMessage::getMessageLengthFromFirstByte(status); }
+
+    juce::MidiMessage toMessage() const noexcept
+    {
+        switch (getLength())
+        {
+            case 1:  return juce::MidiMessage(status, (double) sampleTime);
+            case 2:  return juce::MidiMessage(status, data1, (double) sampleTime);
+            default: return juce::MidiMessage(status, data1, data2, (double) sampleTime);
+        }
+    }
+
+    /** Adds the event's raw bytes to a MidiBuffer without going through juce::MidiMessage.
+        Events that arrived late (negative block time) are played at the start of the block. */
+    void addTo(juce::MidiBuffer& buffer, int timeOffset = 0) const
+    {
+        buffer.addEvent(&status, getLength(), juce::jmax(0, sampleTime + timeOffset));
+    }
+
+    //==============================================================================
+    int  getChannel() const noexcept      { return (status & 0x0f) + 1; }
+    int  getNoteNumber() const noexcept   { return data1; }
+    int  getVelocity() const noexcept     { return data2; }
+    bool isNoteOn() const noexcept        { return (status & 0xf0) == 0x90 && data2 != 0; }
+    bool isNoteOff() const noexcept       { return (status & 0xf0) == 0x80 || ((status & 0xf0) == 0x90 && data2 == 0); }
+    bool isNoteOnOrOff() const noexcept   { return (status & 0xe0) == 0x80; }
+};
+
+static_assert(sizeof(MidiEvent) == 12, "MidiEvent should stay packed into 12 bytes");
+static_assert(std::is_trivially_copyable<MidiEvent>::value, "MidiEvent must be trivially copyable");
+
+/** Flat, time-ordered array of events. Containers are reserved once and reused every block. */
+using MidiEventList = std::vector<MidiEvent>;
+
+//==============================================================================
+namespace MidiEvents
+{
+    /** Upper bound on the events a single block is expected to carry, used to reserve storage up front. */
+    static constexpr int maxEventsPerBlock = 512;
+
+    inline bool earlier(const MidiEvent& a, const MidiEvent& b) noexcept
+    {
+        return a.sampleTime < b.sampleTime || (a.sampleTime == b.sampleTime && a.subSample < b.subSample);
+    }
+
+    /**
+     * @brief Inserts an event after any events with the same or earlier time.
+     *
+     * Mirrors the ordering of `juce::MidiBuffer::addEvent` and `juce::MidiMessageSequence::addEvent`.
+     * No allocation happens as long as the list has spare capacity.
+     */
+    inline void insertSorted(MidiEventList& list, const MidiEvent& e)
+    {
+        if (list.empty() || ! earlier(e, list.back()))
+        {
+            list.push_back(e);
+            return;
+        }
+
+        list.insert(std::upper_bound(list.begin(), list.end(), e, earlier), e);
+    }
+
+    /** Splits a time-ordered list of absolute-time events into `numBlocks` lists of block-relative events. */
+    inline std::vector<MidiEventList> splitIntoBlocks(const MidiEventList& events, int blockSize, int numBlocks)
+    {
+        std::vector<MidiEventList> blocks((size_t) std::max(0, numBlocks));
+
+        for (const auto& e : events)
+        {
+            const auto blockIndex = e.sampleTime / blockSize;
+            if (blockIndex >= numBlocks)
+                break;
+
+            auto relative = e;
+            relative.sampleTime -= blockIndex * blockSize;
+            blocks[(size_t) blockIndex].push_back(relative);
+        }
+
+        return blocks;
+    }
+
+    /** Converts a host MidiBuffer into events, skipping anything that is not a short channel message. */
+    inline void appendFromBuffer(MidiEventList& dest, const juce::MidiBuffer& src, std::uint8_t source)
+    {
+        for (const auto meta : src)
+        {
+            if (meta.numBytes > 3 || meta.numBytes < 1 || meta.data[0] < 0x80 || meta.data[0] >= 0xf0)
+                continue;
+
+            insertSorted(dest, MidiEvent::make(meta.samplePosition,
+                                               meta.data[0],
+                                               meta.numBytes > 1 ? meta.data[1] : std::uint8_t (0),
+                                               meta.numBytes > 2 ? meta.data[2] : std::uint8_t (0),
+                                               source));
+        }
+    }
+
+    /** Writes events into a host MidiBuffer; the buffer keeps its allocation across calls to clear(). */
+    inline void addToBuffer(juce::MidiBuffer& dest, const MidiEvent* begin, const MidiEvent* end, int timeOffset = 0)
+    {
+        for (auto* e = begin; e != end; ++e)
+            e->addTo(dest, timeOffset);
+    }
+
+    inline void addToBuffer(juce::MidiBuffer& dest, const MidiEventList& src, int timeOffset = 0)
+    {
+        addToBuffer(dest, src.data(), src.data() + src.size(), timeOffset);
+    }
+}
@@ -0,0 +1,148 @@
+/*
+  ==============================================================================
+
+    MidiRouter.h
+    Routes the prediction, live and host event streams to the synth and MIDI out.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "MidiEvent.h"
+
+#include <array>
+
+/** A read-only, time-ordered view of events owned elsewhere. */
+struct EventSpan
+{
+    const MidiEvent* first = nullptr;
+    const MidiEvent* last  = nullptr;
+
+    EventSpan() = default;
+    EventSpan(const MidiEvent* f, const MidiEvent* l) noexcept : first(f), last(l) {}
+    EventSpan(const MidiEventList& list) noexcept : first(list.data()), last(list.data() + list.size()) {}
+
+    bool   empty() const noexcept   { return first == last; }
+    size_t size() const noexcept    { return (size_t) (last - first); }
+};
+
+/**
+ * @brief Per-route event filter, applied as events are pulled from the merge.
+ */
+struct RouteFilter
+{
+    int  transpose = 0;     // semitones, applied to note and poly-pressure messages
+    int  channel   = 0;     // 1-16 to remap every channel message, 0 to keep the original channel
+    bool mute      = false;
+
+    /** Returns false if the event should be dropped. */
+    bool apply(MidiEvent& e) const noexcept
+    {
+        if (transpose != 0 && (e.isNoteOnOrOff() || (e.status & 0xf0) == 0xa0))
+        {
+            const int note = e.getNoteNumber() + transpose;
+            if (note < 0 || note > 127)
+                return false;
+            e.data1 = (std::uint8_t) note;
+        }
+
+        if (channel > 0)
+            e.status = (std::uint8_t) ((e.status & 0xf0) | ((channel - 1) & 0x0f));
+
+        return true;
+    }
+};
+
+//==============================================================================
+/**
+ * @brief Routing stage between the follower and the sinks.
+ *
+ * Each source is registered as a sorted span for the current block; nothing is copied. A sink asks
+ * for a `Merge` over the routes it wants and pulls events one at a time from a streaming k-way merge.
+ * Events at the same time come out in route order (prediction, live, host), the order the buffers
+ * used to be combined in.
+ */
+class MidiRouter
+{
+public:
+    enum Route
+    {
+        prediction = 0,
+        live,
+        host,
+        numRoutes
+    };
+
+    static constexpr unsigned routeBit(Route r) noexcept  { return 1u << (unsigned) r; }
+    static constexpr unsigned allRoutes = (1u << numRoutes) - 1;
+
+    /** Registers this block's events for a route. The span must stay valid while merges are in use. */
+    void setSource(Route route, EventSpan span) noexcept     { sources[(size_t) route] = span; }
+    void clearSources() noexcept                             { sources = {}; }
+
+    RouteFilter&       getFilter(Route route) noexcept       { return filters[(size_t) route]; }
+    const RouteFilter& getFilter(Route route) const noexcept { return filters[(size_t) route]; }
+
+    //==============================================================================
+    /** Streaming merge over a subset of routes; cheap to copy, holds only cursors. */
+    class Merge
+    {
+    public:
+        /** Pulls the next event in time order with the route's filter applied; false when exhausted. */
+        bool next(MidiEvent& out) noexcept
+        {
+            for (;;)
+            {
+                int best = -1;
+                for (int r = 0; r < numRoutes; ++r)
+                {
+                    if (cursors[(size_t) r] == ends[(size_t) r])
+                        continue;
+                    if (best < 0 || MidiEvents::earlier(*cursors[(size_t) r], *cursors[(size_t) best]))
+                        best = r;
+                }
+
+                if (best < 0)
+                    return false;
+
+                out = *cursors[(size_t) best]++;
+                if (filters[(size_t) best]->apply(out))
+                    return true;
+            }
+        }
+
+        /** Host boundary: drains the merge into a MidiBuffer. */
+        void addTo(juce::MidiBuffer& dest) noexcept
+        {
+            MidiEvent e;
+            while (next(e))
+                e.addTo(dest);
+        }
+
+    private:
+        friend class MidiRouter;
+
+        std::array<const MidiEvent*, numRoutes>  cursors {};
+        std::array<const MidiEvent*, numRoutes>  ends {};
+        std::array<const RouteFilter*, numRoutes> filters {};
+    };
+
+    /** Starts a merge over the routes in `routeMask` (see routeBit); muted routes are left out. */
+    Merge merge(unsigned routeMask = allRoutes) const noexcept
+    {
+        Merge m;
+        for (size_t r = 0; r < (size_t) numRoutes; ++r)
+        {
+            m.filters[r] = &filters[r];
+            const bool use = (routeMask & (1u << r)) != 0 && ! filters[r].mute;
+            m.cursors[r] = use ? sources[r].first : nullptr;
+            m.ends[r]    = use ? sources[r].last  : nullptr;
+        }
+        return m;
+    }
+
+private:
+    std::array<EventSpan, numRoutes>   sources {};
+    std::array<RouteFilter, numRoutes> filters {};
+};
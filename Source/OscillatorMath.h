@@ -0,0 +1,43 @@
+/*
+  ==============================================================================
+
+    OscillatorMath.h
+    Branch-free phase and sine helpers shared by the vectorised oscillators.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace OscillatorMath
+{
+    /**
+     * sin(2 pi x) for a phase x in [0, 1), to within about 4e-6.
+     * Written without comparisons so that the compiler vectorises it without -ffast-math: rounding
+     * is a truncating int conversion (the phase is never negative) and the fold is a min.
+     */
+    inline float sineOfPhase(float x) noexcept
+    {
+        // Move to [-0.5, 0.5), then fold the magnitude into [0, 0.25] where the polynomial is accurate
+        const float t = x - (float) (int) (x + 0.5f);
+        const float magnitude = std::abs(t);
+        const float folded = std::min(magnitude, 0.5f - magnitude);
+
+        const float w = folded * juce::MathConstants<float>::twoPi;
+        const float w2 = w * w;
+        const float s = w * (1.0f + w2 * (-1.0f / 6.0f + w2 * (1.0f / 120.0f + w2 * (-1.0f / 5040.0f + w2 * (1.0f / 362880.0f)))));
+        return std::copysign(s, t);
+    }
+
+    /** Advances a phase in [0, 1) by an increment in [0, 1), wrapping without a branch. */
+    inline float advancePhase(float phase, float increment) noexcept
+    {
+        const float next = phase + increment;
+        return next - (float) (int) next;
+    }
+}
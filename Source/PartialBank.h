@@ -0,0 +1,152 @@
+/*
+  ==============================================================================
+
+    PartialBank.h
+    Additive renderer for the partials of one voice, one vector pass per sample.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "OscillatorMath.h"
+
+#include <array>
+#include <type_traits>
+
+/**
+ * @brief Renders the sum of up to maxPartials sine partials, with envelope and gain ramp, in one loop.
+ *
+ * The partials are the lanes of a small struct-of-arrays bank. Every sample advances all of their
+ * phases with one vector update and sums them in one pass. A silent partial has gain 0, so it costs
+ * the same as the others and needs no branch. Increments are set through setFrequency, which callers
+ * only use when the pitch actually changes.
+ *
+ * renderLanes() is specialised at compile time on the number of lanes and on the envelope: its loops
+ * have constant trip counts and unroll completely, and with a ConstantEnvelope the envelope is folded
+ * into the gain ramp. Callers pick an instantiation per block (see FoleysVoice). renderGeneric() is the
+ * same sum with a runtime lane count and a per-sample envelope, kept as the baseline for the benchmarks.
+ */
+class PartialBank
+{
+public:
+    static constexpr int maxPartials = 8;
+
+    /** An envelope that holds one value for the whole block; pass its value in the start and end gains. */
+    struct ConstantEnvelope {};
+
+    void setSampleRate(double newRate) noexcept   { sampleRate = newRate; }
+
+    /** Restarts every partial at phase 0, as at the start of a note. */
+    void resetPhases() noexcept                   { phase.fill(0.0f); }
+
+    void setFrequency(int partial, double frequency) noexcept
+    {
+        // Partials at or above Nyquist are silenced rather than aliased
+        const double cycles = frequency / sampleRate;
+        increment[(size_t) partial] = cycles < 0.5 ? (float) cycles : 0.0f;
+        audible[(size_t) partial] = cycles < 0.5 ? 1.0f : 0.0f;
+    }
+
+    void setGain(int partial, float newGain) noexcept
+    {
+        gain[(size_t) partial] = newGain * audible[(size_t) partial];
+    }
+
+    /**
+     * Renders only the first `numPartials` partials, rounded up to half or all of maxPartials. Halving the count halves
+     * the cost of the kernel; the partials left out keep their phase and continue where they stopped.
+     */
+    void setNumActivePartials(int numPartials) noexcept
+    {
+        activeLanes = numPartials <= maxPartials / 2 ? maxPartials / 2 : maxPartials;
+    }
+
+    /** Lanes the kernel runs: maxPartials / 2 or maxPartials. */
+    int getNumActiveLanes() const noexcept  { return activeLanes; }
+
+    /**
+     * @brief Writes `numSamples` samples of the partial sum into `out`.
+     *
+     * @param envelope Anything with `float getNextSample()`, e.g. a juce::ADSR; called once per sample.
+     * @param startGain Output gain at the first sample.
+     * @param endGain Output gain after the last sample; the gain is ramped linearly in between.
+     */
+    template <typename Envelope>
+    void render(float* out, int numSamples, Envelope& envelope, float startGain, float endGain) noexcept
+    {
+        if (activeLanes == maxPartials)
+            renderLanes<maxPartials>(out, numSamples, envelope, startGain, endGain);
+        else
+            renderLanes<maxPartials / 2>(out, numSamples, envelope, startGain, endGain);
+    }
+
+    /** The kernel for exactly `numLanes` lanes, which must match getNumActiveLanes(). */
+    template <int numLanes, typename Envelope>
+    void renderLanes(float* out, int numSamples, Envelope& envelope, float startGain, float endGain) noexcept
+    {
+        static_assert(numLanes > 0 && numLanes <= maxPartials, "numLanes out of range");
+
+        // Local copies, so the compiler can keep the lanes in registers
+        float ph[numLanes], inc[numLanes], g[numLanes];
+        std::copy(phase.begin(), phase.begin() + numLanes, ph);
+        std::copy(increment.begin(), increment.begin() + numLanes, inc);
+        std::copy(gain.begin(), gain.begin() + numLanes, g);
+
+        const float gainStep = numSamples > 0 ? (endGain - startGain) / (float) numSamples : 0.0f;
+        float outputGain = startGain;
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            float lanes[numLanes];
+            for (int k = 0; k < numLanes; ++k)
+            {
+                lanes[k] = OscillatorMath::sineOfPhase(ph[k]) * g[k];
+                ph[k] = OscillatorMath::advancePhase(ph[k], inc[k]);
+            }
+
+            float sum = 0.0f;
+            for (int k = 0; k < numLanes; ++k)
+                sum += lanes[k];
+
+            if constexpr (std::is_same_v<Envelope, ConstantEnvelope>)
+                out[n] = sum * outputGain;
+            else
+                out[n] = sum * envelope.getNextSample() * outputGain;
+
+            outputGain += gainStep;
+        }
+
+        std::copy(ph, ph + numLanes, phase.begin());
+    }
+
+    /** The same sum without specialisation: the lane count is read at run time and the envelope called every sample. */
+    template <typename Envelope>
+    void renderGeneric(float* out, int numSamples, Envelope& envelope, float startGain, float endGain) noexcept
+    {
+        const float gainStep = numSamples > 0 ? (endGain - startGain) / (float) numSamples : 0.0f;
+        float outputGain = startGain;
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            float sum = 0.0f;
+            for (int k = 0; k < activeLanes; ++k)
+            {
+                sum += OscillatorMath::sineOfPhase(phase[(size_t) k]) * gain[(size_t) k];
+                phase[(size_t) k] = OscillatorMath::advancePhase(phase[(size_t) k], increment[(size_t) k]);
+            }
+
+            out[n] = sum * envelope.getNextSample() * outputGain;
+            outputGain += gainStep;
+        }
+    }
+
+private:
+    double sampleRate = 44100.0;
+    int activeLanes = maxPartials;
+
+    alignas(32) std::array<float, maxPartials> phase {};
+    alignas(32) std::array<float, maxPartials> increment {};
+    alignas(32) std::array<float, maxPartials> gain {};
+    std::array<float, maxPartials> audible {};
+};
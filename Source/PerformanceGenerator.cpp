@@ -0,0 +1,229 @@
+/*
+  ==============================================================================
+
+    PerformanceGenerator.cpp
+    Seeded, streaming generator of imperfect performances of a score.
+
+  ==============================================================================
+*/
+
+#include "PerformanceGenerator.h"
+
+#include <cmath>
+#include <functional>
+
+void PerformanceGenerator::prepare(const MidiEventList& scoreEvents, double newSampleRate)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    score.clear();
+    lengths.clear();
+    scoreLength = 1;
+
+    // Keep note-ons and controllers; each note-on takes the length up to its note-off
+    for (size_t i = 0; i < scoreEvents.size(); ++i)
+    {
+        const auto& e = scoreEvents[i];
+        scoreLength = juce::jmax(scoreLength, (std::int64_t) e.sampleTime + 1);
+
+        if (e.isNoteOff())
+            continue;
+
+        auto length = (std::int32_t) (0.5 * sampleRate);
+
+        if (e.isNoteOn())
+        {
+            for (auto j = i + 1; j < scoreEvents.size(); ++j)
+            {
+                const auto& off = scoreEvents[j];
+                if (off.isNoteOff() && off.getChannel() == e.getChannel() && off.getNoteNumber() == e.getNoteNumber())
+                {
+                    length = juce::jmax(1, off.sampleTime - e.sampleTime);
+                    break;
+                }
+            }
+        }
+
+        score.push_back(e);
+        lengths.push_back(length);
+    }
+
+    sectionLength = juce::jmax((std::int64_t) 1, (std::int64_t) (settings.sectionSeconds * sampleRate));
+    lengthSamples = (std::int64_t) (settings.lengthSeconds * sampleRate);
+
+    // Every event at one time leaves nothing to loop over: play such a score once
+    if (! scoreEvents.empty() && scoreEvents.front().sampleTime == scoreEvents.back().sampleTime)
+        lengthSamples = 0;
+    jitterSamples = (std::int64_t) (settings.jitterMs * 0.001 * sampleRate);
+
+    pending.clear();
+    pending.reserve((size_t) juce::jmax(16, settings.maxPending));
+    reset();
+}
+
+void PerformanceGenerator::reset()
+{
+    random.setSeed(settings.seed);
+    pending.clear();
+    nextOrder = 0;
+    cursor = 0;
+    sectionStart = 0;
+    sectionEnd = sectionLength;
+    repeatingSection = false;
+    scoreTime = 0;
+    performanceTime = 0.0;
+    finished = score.empty();
+}
+
+//==============================================================================
+bool PerformanceGenerator::generate(std::int64_t endSample, MidiEventList& dest)
+{
+    // Play on until nothing still to come can land before endSample, jitter included
+    while (! finished && performanceTime - (double) jitterSamples < (double) endSample)
+        if (! playNext())
+            break;
+
+    while (! pending.empty() && pending.front().time < endSample)
+    {
+        std::pop_heap(pending.begin(), pending.end(), std::greater<Pending>());
+        auto event = pending.back().event;
+        event.sampleTime = (std::int32_t) pending.back().time;
+        dest.push_back(event);
+        pending.pop_back();
+    }
+
+    return ! (finished && pending.empty());
+}
+
+bool PerformanceGenerator::playNext()
+{
+    if (lengthSamples > 0 && performanceTime >= (double) lengthSamples)
+    {
+        finished = true;
+        return false;
+    }
+
+    if (cursor >= score.size())
+    {
+        if (lengthSamples <= 0)
+        {
+            finished = true;
+            return false;
+        }
+
+        // From the top after the rest of the score, with the form decided afresh
+        performanceTime += (double) (scoreLength - scoreTime) / getTempo();
+        cursor = sectionStart = 0;
+        sectionEnd = sectionLength;
+        repeatingSection = false;
+        scoreTime = 0;
+    }
+
+    const auto& e = score[cursor];
+
+    if (e.sampleTime >= sectionEnd)
+    {
+        endSection();
+        return true;
+    }
+
+    performanceTime += (double) (e.sampleTime - scoreTime) / getTempo();
+    scoreTime = e.sampleTime;
+
+    const auto onset = (std::int64_t) std::llround(performanceTime);
+
+    if (e.isNoteOn())
+        playNote(e, onset, (std::int64_t) ((double) lengths[cursor] / getTempo()));
+    else
+        schedule(onset, e);
+
+    ++cursor;
+    return true;
+}
+
+void PerformanceGenerator::endSection()
+{
+    // Play out the rest of the section first
+    performanceTime += (double) (sectionEnd - scoreTime) / getTempo();
+    scoreTime = sectionEnd;
+
+    if (random.nextDouble() < settings.pauseProbability)
+        performanceTime += (settings.minPauseSeconds + (settings.maxPauseSeconds - settings.minPauseSeconds) * random.nextDouble()) * sampleRate;
+
+    const bool repeat = ! repeatingSection && random.nextDouble() < settings.repeatProbability;
+    const bool skip = ! repeat && random.nextDouble() < settings.skipProbability;
+
+    if (repeat)
+    {
+        cursor = sectionStart;
+        scoreTime = sectionEnd - sectionLength;
+        repeatingSection = true;
+        return;
+    }
+
+    if (skip)
+        sectionEnd += sectionLength;
+
+    // Continue at the first event of the next section that has any; a skipped section takes no time
+    while (cursor < score.size() && score[cursor].sampleTime < sectionEnd)
+        ++cursor;
+
+    while (cursor < score.size() && score[cursor].sampleTime >= sectionEnd + sectionLength)
+        sectionEnd += sectionLength;
+
+    if (skip)
+        scoreTime = sectionEnd;
+
+    sectionStart = cursor;
+    sectionEnd += sectionLength;
+    repeatingSection = false;
+}
+
+void PerformanceGenerator::playNote(const MidiEvent& note, std::int64_t onset, std::int64_t length)
+{
+    // Draw every decision for every note, so that one probability does not reshuffle the others
+    const auto jitter = jitterSamples > 0 ? (std::int64_t) random.nextInt((int) (2 * jitterSamples + 1)) - jitterSamples : 0;
+    const bool missing = random.nextDouble() < settings.missingNoteProbability;
+    const bool wrong = random.nextDouble() < settings.wrongNoteProbability;
+    const bool extra = random.nextDouble() < settings.extraNoteProbability;
+    const auto wrongKey = nudge(note.getNoteNumber());
+    const auto extraKey = nudge(note.getNoteNumber());
+
+    const auto time = juce::jmax((std::int64_t) 0, onset + jitter);
+    const auto end = time + juce::jmax((std::int64_t) 1, length);
+    const auto channelBits = (std::uint8_t) (note.status & 0x0f);
+
+    const auto play = [&] (int key)
+    {
+        auto on = note;
+        on.data1 = (std::uint8_t) key;
+        schedule(time, on);
+        schedule(end, MidiEvent::make(0, (std::uint8_t) (0x80 | channelBits), (std::uint8_t) key, 0, note.source));
+    };
+
+    if (! missing)
+        play(wrong ? wrongKey : note.getNoteNumber());
+
+    if (extra)
+        play(extraKey);
+}
+
+void PerformanceGenerator::schedule(std::int64_t time, const MidiEvent& event)
+{
+    pending.push_back({ time, nextOrder++, event });
+    std::push_heap(pending.begin(), pending.end(), std::greater<Pending>());
+}
+
+double PerformanceGenerator::getTempo() const noexcept
+{
+    const auto progress = lengthSamples > 0 ? performanceTime / (double) lengthSamples
+                                            : (double) scoreTime / (double) scoreLength;
+    const auto base = settings.startTempo + (settings.endTempo - settings.startTempo) * juce::jlimit(0.0, 1.0, progress);
+    const auto phrase = juce::MathConstants<double>::twoPi * performanceTime / (juce::jmax(0.1, settings.rubatoSeconds) * sampleRate);
+    return juce::jmax(0.05, base * (1.0 + settings.rubatoDepth * std::sin(phrase)));
+}
+
+int PerformanceGenerator::nudge(int noteNumber) noexcept
+{
+    const auto step = 1 + random.nextInt(2);
+    return juce::jlimit(0, 127, random.nextBool() ? noteNumber + step : noteNumber - step);
+}
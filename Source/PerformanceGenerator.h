@@ -0,0 +1,130 @@
+/*
+  ==============================================================================
+
+    PerformanceGenerator.h
+    Seeded, streaming generator of imperfect performances of a score.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MidiEvent.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Plays a score the way a person might: on a tempo curve with rubato, off the beat, with wrong,
+ * extra and missing notes, skipping or repeating sections and stopping now and then.
+ *
+ * The output is generated on demand, block by block: generate() appends the events before a given
+ * time and keeps only the notes still sounding and the few onsets that jitter may yet reorder. A
+ * half-hour performance therefore costs no more memory than a short one, and the score is looped
+ * (taking the section skips and repeats along) for as long as `lengthSeconds` asks.
+ *
+ * The same score, settings and seed always give the same performance.
+ *
+ * How it plays:
+ * - Tempo: the ratio of performance to score speed goes from `startTempo` to `endTempo` over the
+ *   performance, swung by `rubatoDepth` over phrases of `rubatoSeconds`.
+ * - Timing: every onset is moved by up to `jitterMs` either way; the note keeps its length.
+ * - Mistakes, per score note: `wrongNoteProbability` plays a neighbouring key instead,
+ *   `missingNoteProbability` leaves it out, `extraNoteProbability` adds a neighbouring key with it.
+ * - Form, per section of `sectionSeconds` of score: `skipProbability` jumps over the next section,
+ *   `repeatProbability` plays the section again, and `pauseProbability` stops for `minPauseSeconds`
+ *   to `maxPauseSeconds` before going on.
+ *
+ * Notes are ended by the generator after their score length, so skips and repeats never leave a note
+ * hanging. Control changes (e.g. the sustain pedal) are passed through on the same time map.
+ *
+ * prepare() allocates; generate() does not, unless more notes sound at once than `maxPending`.
+ */
+class PerformanceGenerator
+{
+public:
+    struct Settings
+    {
+        std::int64_t seed = 1;
+        double lengthSeconds = 0.0;  // 0 plays the score once; otherwise loops it to this length (unless all its events fall at one time)
+
+        double startTempo = 1.0, endTempo = 1.0;  // performance speed over score speed
+        double rubatoDepth = 0.0;                 // fraction of the tempo
+        double rubatoSeconds = 8.0;
+        double jitterMs = 0.0;
+
+        double wrongNoteProbability = 0.0;
+        double extraNoteProbability = 0.0;
+        double missingNoteProbability = 0.0;
+
+        double sectionSeconds = 10.0;
+        double skipProbability = 0.0;
+        double repeatProbability = 0.0;
+        double pauseProbability = 0.0;
+        double minPauseSeconds = 1.0, maxPauseSeconds = 4.0;
+
+        int maxPending = 4096;  // sounding notes and jittered onsets held before they are due
+    };
+
+    void setSettings(const Settings& newSettings)   { settings = newSettings; }
+    const Settings& getSettings() const noexcept     { return settings; }
+
+    /** Takes the score (absolute sample times, time-ordered) and starts a new performance from the seed. */
+    void prepare(const MidiEventList& score, double sampleRate);
+
+    /** Starts the same performance again. */
+    void reset();
+
+    /**
+     * Appends every performance event before `endSample` (absolute sample times, time-ordered) to `dest`.
+     * Call with increasing `endSample`; returns false once the performance is over and nothing is left.
+     */
+    bool generate(std::int64_t endSample, MidiEventList& dest);
+
+    /** Length of the performance in samples; known from prepare() when it loops to `lengthSeconds`. */
+    std::int64_t getLengthSamples() const noexcept  { return lengthSamples; }
+
+private:
+    struct Pending
+    {
+        std::int64_t time;
+        std::uint64_t order;  // keeps events at the same time in the order they were made
+        MidiEvent event;
+
+        bool operator> (const Pending& other) const noexcept
+        {
+            return time != other.time ? time > other.time : order > other.order;
+        }
+    };
+
+    /** Plays the next score event, or decides how to go on at a section end; false at the end of the performance. */
+    bool playNext();
+    void endSection();
+    void schedule(std::int64_t time, const MidiEvent& event);
+    void playNote(const MidiEvent& note, std::int64_t onset, std::int64_t length);
+    double getTempo() const noexcept;
+    int nudge(int noteNumber) noexcept;
+
+    Settings settings;
+    double sampleRate = 44100.0;
+
+    MidiEventList score;                // notes and controllers, without note-offs
+    std::vector<std::int32_t> lengths;  // score length of each note-on, in samples
+    std::int64_t scoreLength = 0;
+    std::int64_t sectionLength = 0;
+    std::int64_t lengthSamples = 0;
+    std::int64_t jitterSamples = 0;
+
+    juce::Random random;
+    std::vector<Pending> pending;  // min-heap on time
+    std::uint64_t nextOrder = 0;
+
+    size_t cursor = 0;               // next score event
+    size_t sectionStart = 0;         // first score event of the current section
+    std::int64_t sectionEnd = 0;     // score time the current section ends at
+    bool repeatingSection = false;   // the current section is being played again
+    std::int64_t scoreTime = 0;      // score time of the last event played
+    double performanceTime = 0.0;    // performance time of the last event played, in samples
+    bool finished = false;
+};
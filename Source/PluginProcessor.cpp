@@ -8,48 +8,45 @@
 */
 
 #include "PluginProcessor.h"
+#include "Trace.h"
 //#include "PresetListBox.h"
 
-#if USE_PGM == 0
-#include "PluginEditor.h"
-#endif
-
 //==============================================================================
 
-//static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
-//{
-//    juce::AudioProcessorValueTreeState::ParameterLayout layout;
-//    FoleysSynth::addADSRParameters (layout);
-//    FoleysSynth::addOvertoneParameters (layout);
-//    FoleysSynth::addGainParameters (layout);
-//    return layout;
-//}
+static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+    FoleysSynth::addADSRParameters (layout);
+    FoleysSynth::addOvertoneParameters (layout);
+    FoleysSynth::addGainParameters (layout);
+    return layout;
+}
 
 //==============================================================================
 
 
 /**
- * @brief Prints the details of each MIDI event in a given MIDI buffer.
+ * @brief Prints the details of each MIDI event in a given event list.
  *
- * This function iterates through all the MIDI events in the provided MIDI buffer and
+ * This function iterates through all the MIDI events in the provided event list and
  * prints their descriptions and timestamps. It also outputs the buffer's name if provided.
  *
- * @param a The MIDI buffer to iterate through and print event details.
+ * @param a The event list to iterate through and print event details.
  * @param name (Optional) The name of the buffer, used for labeling the output.
  *
  * @note The function uses standard output (std::cout) for printing the details.
  */
-void bufferVals(juce::MidiBuffer& a, juce::String name = "")
+void bufferVals(const MidiEventList& a, juce::String name = "")
 {
     // Print the name of the buffer if provided.
     std::cout << name << ":" << std::endl;
 
     // Iterate through each MIDI event in the buffer.
-    for (const auto meta : a)
+    for (const auto& e : a)
     {
         // Print the description and timestamp of each MIDI event.
-        std::cout << "MIDI Event: " << meta.getMessage().getDescription()
-                  << ", " << meta.getMessage().getTimeStamp() << std::endl;
+        std::cout << "MIDI Event: " << e.toMessage().getDescription()
+                  << ", " << e.sampleTime << std::endl;
     }
 
     // Print the end marker for the buffer.
@@ -57,26 +54,26 @@ void bufferVals(juce::MidiBuffer& a, juce::String name = "")
 }
 
 /**
- * @brief Prints the details of each MIDI event in a given MIDI message sequence.
+ * @brief Prints the details of each MIDI event in a given matcher queue.
  *
- * This function iterates through all the MIDI events in the provided MIDI message sequence and
+ * This function iterates through all the MIDI events in the provided queue and
  * prints their descriptions and timestamps. It also outputs the sequence's name if provided.
  *
- * @param a The MIDI message sequence to iterate through and print event details.
+ * @param a The event queue to iterate through and print event details.
  * @param name (Optional) The name of the sequence, used for labeling the output.
  *
  * @note The function uses standard output (std::cout) for printing the details.
  */
-void seqVals(juce::MidiMessageSequence& a, juce::String name = "") 
+void seqVals(const MidiEventList& a, juce::String name = "") 
 {
     // Print the name of the sequence if provided.
     std::cout << name << ":" << std::endl;
     
     // Iterate through each MIDI event in the sequence.
-    for(const auto meta: a) 
+    for(const auto& e: a) 
     {
         // Print the description and timestamp of each MIDI event.
-        std::cout << "MIDI Event: " << meta->message.getDescription() << ", " << meta->message.getTimeStamp() << std::endl;
+        std::cout << "MIDI Event: " << e.toMessage().getDescription() << ", " << e.sampleTime << std::endl;
     }
     
     // Print the end marker for the sequence.
@@ -128,20 +125,20 @@ void p50s(juce::MidiMessageSequence& a, juce::String name = "", int n = 50)
 }
 
 /**
- * @brief Prints details of the first `n` MIDI events from a vector of MIDI buffers.
+ * @brief Prints details of the first `n` MIDI events from a vector of per-block event lists.
  *
- * This function iterates through the provided vector of `juce::MidiBuffer` objects and prints the details
+ * This function iterates through the provided vector of `MidiEventList` objects and prints the details
  * of the first `n` MIDI events, including their descriptions and timestamps. The timestamps are adjusted
  * to account for the buffer index and a block size of 512 samples.
  *
- * @param a A vector of `juce::MidiBuffer` objects from which to print MIDI event details.
+ * @param a A vector of `MidiEventList` objects from which to print MIDI event details.
  * @param name (Optional) The name of the collection, used for labeling the output. Defaults to an empty string.
  * @param n The number of MIDI events to print. Defaults to 50.
  *
  * @note The function outputs details using standard output (std::cout).
  * @warning Ensure that `n` does not exceed the total number of events across all buffers to avoid premature termination.
  */
-void p50b(std::vector<juce::MidiBuffer>& a, juce::String name = "", int n = 50)
+void p50b(const std::vector<MidiEventList>& a, juce::String name = "", int n = 50)
 {
     // Print the name of the collection if provided.
     std::cout << name << ":" << std::endl;
@@ -153,12 +150,12 @@ void p50b(std::vector<juce::MidiBuffer>& a, juce::String name = "", int n = 50)
     for (const auto& buff: a) 
     {
         // Iterate through each MIDI event in the buffer.
-        for(const auto meta: buff)
+        for(const auto& e: buff)
         {
             // Print the MIDI event description and timestamps.
-            std::cout << "MIDI Event: "<< meta.getMessage().getDescription() 
-                      << ", " << (meta.getMessage().getTimeStamp()) << "  "
-                      << (meta.getMessage().getTimeStamp())+(512*buffNum)
+            std::cout << "MIDI Event: "<< e.toMessage().getDescription() 
+                      << ", " << e.sampleTime << "  "
+                      << e.sampleTime+(512*buffNum)
                       << std::endl; // assume512 block size
             count++; // Increment the event counter.
             
@@ -193,13 +190,32 @@ PluginProcessor::PluginProcessor() // xtor
 #endif
                     .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
 #endif
-                    )
+                    ),
+#else
+  :
 #endif
+  treeState (*this, nullptr, "PARAMETERS", createParameterLayout())
 {
 #if USE_PGM == 1
   magicState.setGuiValueTree (BinaryData::MidiPredict_xml, BinaryData::MidiPredict_xmlSize);
+  deadlineMeter = magicState.createAndAddObject<foleys::MagicLevelSource> ("deadline-stages");
+  deadlinePlot = magicState.createAndAddObject<DeadlinePlotSource> ("deadline-load", deadlineMonitor);
+  predictionMeter = magicState.createAndAddObject<foleys::MagicLevelSource> ("prediction-rates");
+  predictionPlot = magicState.createAndAddObject<PredictionErrorPlotSource> ("prediction-error", predictionTelemetry);
 #endif
 
+  // Predictions are played by the additive FoleysSynth, live notes by the sine bank
+  synthAudioSource.setUsingFoleysSynthForPrediction (treeState);
+  // A piano sample set next to the MIDI resources replaces the additive voice
+  auto pianoSamples = juce::File::getSpecialLocation (juce::File::currentApplicationFile)
+      .getChildFile ("Contents")
+      .getChildFile ("Resources")
+      .getChildFile ("PianoSamples");
+  if (pianoSamples.isDirectory())
+      synthAudioSource.setUsingSamplerForPrediction (pianoSamples);
+  // Follower settings tuned offline for each piece
+  followerPresets.load (FollowerPresets::getDefaultFile());
+
 #if JUCE_UNIT_TESTS
   runUnitTests();
 #endif
@@ -208,6 +224,21 @@ PluginProcessor::PluginProcessor() // xtor
 
 PluginProcessor::~PluginProcessor()
 {
+    stopTelemetryExport();
+}
+
+bool PluginProcessor::startTelemetryExport(const juce::File& file)
+{
+    stopTelemetryExport();
+    telemetryExporter = std::make_unique<TelemetryExporter>(predictionTelemetry, file);
+    if (! telemetryExporter->start())
+        telemetryExporter.reset();
+    return telemetryExporter != nullptr;
+}
+
+void PluginProcessor::stopTelemetryExport()
+{
+    telemetryExporter.reset(); // writes what is left before it goes
 }
 
 //==============================================================================
@@ -314,29 +345,36 @@ void PluginProcessor::printClassState() {
     std::cout << "num_notes_predicted: " << num_notes_predicted << std::endl;
     std::cout << "num_notes_network: " << num_notes_network << std::endl;
     
+    // Prediction quality
+    const auto telemetry = predictionTelemetry.getStats();
+    std::cout << "hits / missing / extra: " << telemetry.hits << " / " << telemetry.missing << " / " << telemetry.extra << std::endl;
+    std::cout << "hitRate: " << telemetry.hitRate << ", missingRate: " << telemetry.missingRate << ", extraRate: " << telemetry.extraRate << std::endl;
+    std::cout << "errorMs mean / mean abs / p95 abs: " << telemetry.meanErrorMs << " / " << telemetry.meanAbsErrorMs << " / " << telemetry.p95AbsErrorMs << std::endl;
+    std::cout << "pauses: " << telemetry.pauses << " (" << telemetry.recentPauses << " in the last minute)" << std::endl;
 }
 
 
 /**
- * @brief Reads a MIDI file and generates MIDI buffers for each block, returning them as a vector.
+ * @brief Reads a MIDI file and generates event lists for each block, returning them as a vector.
  *
- * This function reads a MIDI file and processes it into MIDI buffers, where each buffer corresponds
- * to a block of audio samples. The MIDI events within each buffer are timestamped in samples. The
- * function can handle speed adjustments and limit the number of blocks processed.
+ * This function reads a MIDI file and processes it into per-block event lists, where each list corresponds
+ * to a block of audio samples. The MIDI events within each list are timestamped in samples relative to the
+ * start of the block. Meta events and SysEx are skipped. The function can handle speed adjustments and
+ * limit the number of blocks processed.
  *
  * @param midiFile The MIDI file to be read.
  * @param sampleRate The sample rate of the audio, used for timestamp calculations.
  * @param blockSize The size of each audio block in samples.
  * @param maxBlocks The maximum number of blocks to process. If set to a negative value, there is no limit.
  * @param speedShift A multiplier for the event timestamps. Values less than 1 speed up the MIDI, and values greater than 1 slow it down.
- * @return A vector of MIDI buffers. Each buffer contains MIDI events for a corresponding block of audio.
+ * @return A vector of event lists. Each list contains MIDI events for a corresponding block of audio.
  *         Timestamps are stored in samples
  *         If an error occurs during file reading or processing, an empty vector is returned.
  */
-std::vector<juce::MidiBuffer> readMIDIFile(const juce::File& midiFile, double sampleRate, int blockSize, int maxBlocks = -1, double speedShift = 1.0)
+std::vector<MidiEventList> readMIDIFile(const juce::File& midiFile, double sampleRate, int blockSize, int maxBlocks, double speedShift)
 {
+    MP_TRACE_SCOPE("readMIDIFile (blocks)");
     juce::MidiFile midiFileData;
-    juce::MidiBuffer loadedMidiBuffer;
 
     // Attempt to open the MIDI file for reading
     juce::FileInputStream fileInputStream(midiFile);
@@ -354,8 +392,8 @@ std::vector<juce::MidiBuffer> readMIDIFile(const juce::File& midiFile, double sa
                 numBlocks = std::min(numBlocks, maxBlocks);
             }
             
-            // Initialize a vector of MIDI buffers with the calculated number of blocks
-            std::vector<juce::MidiBuffer> midiBuffers(numBlocks); // Initialize vector
+            // Initialize a vector of event lists with the calculated number of blocks
+            std::vector<MidiEventList> midiBuffers(numBlocks); // Initialize vector
 
             // Process each track in the MIDI file
             for (int trackIndex = 0; trackIndex < midiFileData.getNumTracks(); ++trackIndex)
@@ -375,14 +413,12 @@ std::vector<juce::MidiBuffer> readMIDIFile(const juce::File& midiFile, double sa
                     if (blockIndex >= numBlocks)
                         break;
 
-                    // Create a buffer for this block if not created yet
-                    if (midiBuffers[blockIndex].isEmpty())
-                    {
-                        midiBuffers[blockIndex] = juce::MidiBuffer();
-                    }
+                    if (! MidiEvent::canRepresent(midiMessage))
+                        continue;
 
-                    // Add the MIDI message to the buffer for the corresponding block
-                    midiBuffers[blockIndex].addEvent(midiMessage, static_cast<int>(speedShift * timeStamp_sec * sampleRate) % blockSize); // timeStamp in samples
+                    // Add the MIDI message to the list for the corresponding block
+                    const int offset = static_cast<int>(speedShift * timeStamp_sec * sampleRate) % blockSize; // timeStamp in samples
+                    MidiEvents::insertSorted(midiBuffers[blockIndex], MidiEvent::fromMessage(midiMessage, offset, MidiEvent::score));
                 }
             }
 
@@ -404,21 +440,22 @@ std::vector<juce::MidiBuffer> readMIDIFile(const juce::File& midiFile, double sa
 }
 
 /**
- * @brief Reads a MIDI file and generates a MIDI message sequence with adjusted timestamps.
+ * @brief Reads a MIDI file and generates a time-ordered score index with adjusted timestamps.
  *
- * This function reads a MIDI file and creates a `juce::MidiMessageSequence` that contains all the
- * MIDI events from the file. The events' timestamps are adjusted according to the provided
- * sample rate and speed shift. The function handles errors gracefully, returning an empty
- * sequence and logging errors if they occur.
+ * This function reads a MIDI file and creates a flat `MidiEventList` that contains all the
+ * channel events from the file, merged across tracks. The events' timestamps are adjusted according
+ * to the provided sample rate and speed shift. The function handles errors gracefully, returning an empty
+ * list and logging errors if they occur.
  *
  * @param midiFile The MIDI file to read. This should be a valid JUCE `File` object representing the path to the MIDI file.
  * @param sampleRate The sample rate of the audio, used to convert event timestamps from seconds to samples.
  * @param speedShift A multiplier for the event timestamps. A value greater than 1.0 slows down the MIDI playback, while a value less than 1.0 speeds it up.
- * @return A `juce::MidiMessageSequence` containing all the MIDI events from the file with adjusted timestamps.
- *         If an error occurs during file reading or processing, an empty sequence is returned.
+ * @return A `MidiEventList` containing all the channel events from the file with timestamps in samples.
+ *         If an error occurs during file reading or processing, an empty list is returned.
  */
-juce::MidiMessageSequence readMIDIFile(const juce::File& midiFile, double sampleRate, double speedShift = 1)
+MidiEventList readMIDIFile(const juce::File& midiFile, double sampleRate, double speedShift)
 {
+    MP_TRACE_SCOPE("readMIDIFile");
     juce::MidiFile midiFileData; // Object to hold the MIDI file data
     juce::FileInputStream fileInputStream(midiFile); // Input stream to read the MIDI file
 
@@ -431,7 +468,7 @@ juce::MidiMessageSequence readMIDIFile(const juce::File& midiFile, double sample
             // Convert MIDI timestamps from ticks to seconds for easier handling
             midiFileData.convertTimestampTicksToSeconds();
             
-            juce::MidiMessageSequence loadedMidiSequence; // Object to store the loaded MIDI messages
+            MidiEventList loadedMidiSequence; // Object to store the loaded MIDI messages
 
             // Iterate through all tracks in the MIDI file
             for (int trackIndex = 0; trackIndex < midiFileData.getNumTracks(); ++trackIndex)
@@ -444,6 +481,9 @@ juce::MidiMessageSequence readMIDIFile(const juce::File& midiFile, double sample
                     // Get the MIDI message for the current event
                     const juce::MidiMessage& midiMessage = track.getEventPointer(eventIndex)->message;
                     
+                    if (! MidiEvent::canRepresent(midiMessage))
+                        continue;
+                    
                     // Get the timestamp of the event in seconds
                     double timeStamp_sec = midiMessage.getTimeStamp(); // seconds
                     
@@ -451,10 +491,13 @@ juce::MidiMessageSequence readMIDIFile(const juce::File& midiFile, double sample
                     int timeStamp_samples = static_cast<int>(timeStamp_sec * sampleRate);
                     
                     // Adjust the timestamp according to the speed shift and add the event to the sequence
-                    loadedMidiSequence.addEvent(midiMessage, speedShift*timeStamp_samples - timeStamp_sec);
+                    loadedMidiSequence.push_back(MidiEvent::fromMessage(midiMessage, static_cast<int>(speedShift*timeStamp_samples), MidiEvent::score));
                 }
             }
             
+            // Merge the tracks into a single time-ordered index (stable, like MidiMessageSequence::addEvent)
+            std::stable_sort(loadedMidiSequence.begin(), loadedMidiSequence.end(), MidiEvents::earlier);
+            
             // Return the loaded MIDI sequence
             return loadedMidiSequence;
         }
@@ -469,32 +512,45 @@ juce::MidiMessageSequence readMIDIFile(const juce::File& midiFile, double sample
     }
 
     // Return an empty sequence in case of an error
-    return juce::MidiMessageSequence();
+    return {};
+}
+
+/** Reads the score index and tempo map of `file` once, for processors to share; see PluginProcessor::setPreparedScore. */
+std::shared_ptr<const PreparedScore> PreparedScore::read(const juce::File& file, double sampleRate, double speedShift)
+{
+    MP_TRACE_SCOPE("PreparedScore::read");
+    auto score = std::make_shared<PreparedScore>();
+    score->file = file;
+    score->sampleRate = sampleRate;
+    score->speedShift = speedShift;
+    score->events = readMIDIFile(file, sampleRate, speedShift);
+    score->tempoMap = ScoreTempoMap::fromFile(file);
+    return score;
 }
 
 /**
- * @brief Generates a MIDI buffer from a given MIDI message sequence within a specified range of samples.
+ * @brief Fills an event list from the score index within a specified range of samples.
  *
- * This function creates a `juce::MidiBuffer` from the provided `juce::MidiMessageSequence`.
- * It adds MIDI messages to the buffer that occur within the current sample position up to the specified range.
+ * This function copies the events of the score index that occur within the current sample position
+ * up to the specified range into `midiBuffer`, which is cleared first and keeps its capacity.
  * If the timestamps of the MIDI messages are out of order, an error message is printed.
  *
- * @param midiMessageSequence The sequence of MIDI messages to convert to a buffer.
+ * @param scoreEvents The score index to read from.
  * @param sampleRate The sample rate of the audio, used to interpret the message timestamps.
  * @param readSamples The number of samples to read ahead from the current sample position.
- * @return A `juce::MidiBuffer` containing the MIDI messages within the specified sample range.
- *         The timestamps in the buffer are relative to the `currentPositionRecSamples`.
+ * @param midiBuffer Receives the events within the specified sample range.
+ *         The timestamps in the list are relative to the `currentPositionRecSamples`.
  */
-juce::MidiBuffer PluginProcessor::generateMidiBuffer(const juce::MidiMessageSequence& midiMessageSequence, double sampleRate, int readSamples)
+void PluginProcessor::generateMidiBuffer(const MidiEventList& scoreEvents, double sampleRate, int readSamples, MidiEventList& midiBuffer)
 {
-    juce::MidiBuffer midiBuffer; // Initialize an empty MIDI buffer
+    midiBuffer.clear();
 
     // Iterate over the MIDI events starting from the current position
-    for (int eventIndex = currentPositionRecMidi; eventIndex < midiMessageSequence.getNumEvents(); ++eventIndex)
+    for (size_t eventIndex = (size_t) currentPositionRecMidi; eventIndex < scoreEvents.size(); ++eventIndex)
     {
-        // Get the MIDI message and its timestamp in samples
-        const juce::MidiMessage& midiMessage = midiMessageSequence.getEventPointer(eventIndex)->message;
-        int timeStamp_samples = midiMessage.getTimeStamp(); // Assuming timestamp is in samples
+        // Get the MIDI event and its timestamp in samples
+        MidiEvent midiMessage = scoreEvents[eventIndex];
+        int timeStamp_samples = midiMessage.sampleTime;
 
         // Check for out-of-order timestamps
         if (timeStamp_samples < currentPositionRecSamples)
@@ -506,7 +562,8 @@ juce::MidiBuffer PluginProcessor::generateMidiBuffer(const juce::MidiMessageSequ
         if (timeStamp_samples < currentPositionRecSamples + readSamples)
         {
             // Add the MIDI message to the buffer with a relative timestamp
-            midiBuffer.addEvent(midiMessage, timeStamp_samples - currentPositionRecSamples);
+            midiMessage.sampleTime = timeStamp_samples - currentPositionRecSamples;
+            midiBuffer.push_back(midiMessage);
         }
         else
         {
@@ -514,9 +571,6 @@ juce::MidiBuffer PluginProcessor::generateMidiBuffer(const juce::MidiMessageSequ
             break;
         }
     }
-
-    // Return the populated MIDI buffer
-    return midiBuffer;
 }
 
 /**
@@ -537,57 +591,113 @@ void PluginProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
     }
 
     // For testing
-    double speedChange = 0.5;
+    double speedChange = testSpeedChange;
 
-    // Initialize live MIDI buffer if in live mode
+    // Initialize live MIDI sequence if in live mode; read by sample position, so blocks may vary in size
     if (MODE == 0) {
-        auto myMidiFile_live = juce::File::getSpecialLocation(juce::File::currentApplicationFile)
-            .getChildFile("Contents")
-            .getChildFile("Resources")
-            .getChildFile("ladispute_paused.mid");
+        auto myMidiFile_live = performanceFile != juce::File()
+            ? performanceFile
+            : juce::File::getSpecialLocation(juce::File::currentApplicationFile)
+                .getChildFile("Contents")
+                .getChildFile("Resources")
+                .getChildFile("ladispute_paused.mid");
         jassert(myMidiFile_live.existsAsFile());
-        liveMidi = readMIDIFile(myMidiFile_live, sampleRate, samplesPerBlock);
+        liveMidiSequence = readMIDIFile(myMidiFile_live, sampleRate);
+        if (generatePerformance) {
+            performanceGenerator.prepare(liveMidiSequence, sampleRate);
+            liveMidiSequence.clear();
+        }
         currentBufferIndexLive = 0;
     } else if (MODE == 1) {
         currentBufferIndexLive = -1;
     }
+    currentPositionLiveMidi = 0;
+    currentPositionLiveSamples = 0;
 
     // Read recorded MIDI file for practice performance
-    auto myMidiFile_rec = juce::File::getSpecialLocation(juce::File::currentApplicationFile)
+    auto myMidiFile_rec = scoreFile != juce::File()
+        ? scoreFile
+        : juce::File::getSpecialLocation(juce::File::currentApplicationFile)
             .getChildFile("Contents")
             .getChildFile("Resources")
             .getChildFile("ladispute_1.mid");
-    jassert(myMidiFile_rec.existsAsFile());
-    recordedMidiSequence = readMIDIFile(myMidiFile_rec, sampleRate, speedChange);
+    if (preparedScore != nullptr && preparedScore->sampleRate == sampleRate && preparedScore->speedShift == speedChange) {
+        myMidiFile_rec = preparedScore->file;
+        recordedMidiSequence = preparedScore->events;
+        scoreTempoMap = preparedScore->tempoMap;
+    } else {
+        jassert(myMidiFile_rec.existsAsFile());
+        recordedMidiSequence = readMIDIFile(myMidiFile_rec, sampleRate, speedChange);
+        scoreTempoMap = ScoreTempoMap::fromFile(myMidiFile_rec);
+    }
+    if (useFollowerPresets) {
+        const auto* preset = followerPresets.find(myMidiFile_rec);
+        followerSettings = preset != nullptr ? *preset : FollowerSettings();
+    }
+    scoreSpeedShift = speedChange;
+    hostLocked = false;
+    followerPaused = false;
     currentPositionRecMidi = 0;
     currentPositionRecSamples = 0;
     lagPositionPredSamples = 0;
 
     // Setting lag for predictions and processing outputs - for demonstrating predictions in time with live
-    lag = 20; // number of blocks
-    std::vector<juce::MidiBuffer> recordedMidi = readMIDIFile(myMidiFile_rec, sampleRate, samplesPerBlock, lag, speedChange);
+    lag = followerSettings.lagBlocks; // number of blocks
+    std::vector<MidiEventList> recordedMidi = MidiEvents::splitIntoBlocks(recordedMidiSequence, samplesPerBlock, lag);
+    prevPredictions.clear();
     for (int i = 0; i < lag; i++) {
         prevPredictions.push_back(recordedMidi[i]);
-        currentPositionRecMidi += recordedMidi[i].getNumEvents();
+        prevPredictions.back().reserve(MidiEvents::maxEventsPerBlock);
+        currentPositionRecMidi += (int) recordedMidi[i].size();
         currentPositionRecSamples += samplesPerBlock;
     }
     predictionBufferIndex = 0;
     predictionPlaybackIndex = 0;
 
+    // Reserve the per-block working lists once so processBlock never grows them
+    recordedBuffer.reserve(MidiEvents::maxEventsPerBlock);
+    liveBuffer.reserve(MidiEvents::maxEventsPerBlock);
+    midiPrediction.reserve(MidiEvents::maxEventsPerBlock);
+    hostEvents.reserve(MidiEvents::maxEventsPerBlock);
+
     // Prepare Synthesizer
+    synthAudioSource.setSpeculativeRender(speculativeRender ? lag : 0);
     synthAudioSource.prepareToPlay(samplesPerBlock, sampleRate);
+    governor.prepare(sampleRate);
+    deadlineMonitor.prepare(sampleRate);
+#if USE_PGM == 1
+    // The meter's signal has one sample per block
+    deadlineMeter->setupSource(DeadlineMonitor::numStages, sampleRate / samplesPerBlock, 500, 200);
+    deadlineLevels.setSize(DeadlineMonitor::numStages, 1);
+#endif
+    predictionTelemetry.prepare(sampleRate, followerSettings.matchWindowSeconds);
+#if USE_PGM == 1
+    predictionMeter->setupSource(3, sampleRate / samplesPerBlock, 500, 200);
+    predictionLevels.setSize(3, 1);
+#endif
+    for (int i = 0; i < lag; i++) {
+        synthAudioSource.prefetchPrediction(prevPredictions[i]);
+        // Seeded at unit tempo, one block apart, lag blocks behind the cursor
+        synthAudioSource.speculatePrediction(prevPredictions[i], { 1.0, i * samplesPerBlock, false },
+                                             router.getFilter(MidiRouter::prediction), samplesPerBlock);
+    }
+    umpInput.prepare(sampleRate);
+    if (publishTimeline && ! timelineWriter.isOpen())
+        timelineWriter.open();
 
     // Initialize parameters for PausePlay Predictions
-    timeBetween = 0.2 * sampleRate; // in samples
+    timeBetween = followerSettings.matchWindowSeconds * sampleRate; // in samples
     unmatchedNotes_pred.clear();
     unmatchedNotes_live.clear();
+    unmatchedNotes_pred.reserve(4 * MidiEvents::maxEventsPerBlock);
+    unmatchedNotes_live.reserve(4 * MidiEvents::maxEventsPerBlock);
 
     // Initialize parameters for Note Density Prediction
     noteDensity_pred = 1;
     num_notes_predicted = 0;
     num_notes_network = 0;
-    alpha = 0.99;
-    numBlocksForDensity = 10 * sampleRate / samplesPerBlock; // Convert seconds to blocks
+    alpha = (float) followerSettings.tempoSmoothing;
+    numBlocksForDensity = std::max(1, (int) (followerSettings.densityWindowSeconds * sampleRate / samplesPerBlock)); // Convert seconds to blocks
     prev50Pred = std::vector<int>(numBlocksForDensity);
     prev50Live = std::vector<int>(numBlocksForDensity);
     prev50PredIndex = 0;
@@ -595,7 +705,7 @@ void PluginProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 
     if (DEBUG_FLAG) {
         p50b(recordedMidi, "recordedMidiBuffers", 50);
-        p50b(liveMidi, "liveMidi", 50);
+        bufferVals(liveMidiSequence, "liveMidi");
         std::cout << std::endl;
     }
 
@@ -636,53 +746,6 @@ bool PluginProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 }
 #endif
 
-/**
- * @brief Combines MIDI events from buffer b into buffer a with an optional note offset.
- *
- * This function combines MIDI events from buffer b into buffer a. If a note offset is specified,
- * note on events in buffer b will be transposed by the specified offset before being added to buffer a.
- *
- * @param a The destination MIDI buffer where events will be added.
- * @param b The source MIDI buffer containing events to be combined.
- * @param numSamples The maximum number of samples to process from buffer b (-1 to process all).
- * @param noteOffset The offset to apply to note events from buffer b before adding them to buffer a.
- *                   If set to 0 (default), events are added without modification.
- */
-void PluginProcessor::combineEvents(juce::MidiBuffer& a, juce::MidiBuffer& b, int numSamples = -1, int noteOffset = 0)
-{
-    // If noteOffset is 0, simply add events from buffer b to buffer a without modification
-    if (noteOffset == 0) {
-        a.addEvents(b, 0, numSamples, 0);
-        return;
-    }
-    
-    // Iterate over each event in buffer b
-    for (const auto meta : b)
-    {
-        const juce::MidiMessage m = meta.getMessage();
-        
-        // Break loop if numSamples is specified and current event timestamp exceeds it
-        if (numSamples > 0 && m.getTimeStamp() > numSamples)
-            break;
-        
-        // Check if the message is a note on or note off event
-        if (m.isNoteOnOrOff())
-        {
-            const juce::uint8 vel = m.getVelocity();
-            // Create a new note on message with the note offset applied
-            juce::MidiMessage newMsg = juce::MidiMessage::noteOn(m.getChannel(), m.getNoteNumber() + noteOffset, vel);
-            
-            // Add the new message to buffer a with the original timestamp
-            a.addEvent(newMsg, m.getTimeStamp());
-        }
-        else
-        {
-            // For other types of MIDI events, simply add them to buffer a without modification
-            a.addEvent(m, m.getTimeStamp());
-        }
-    }
-}
-
 /**
  * @brief Searches for a MIDI note in the live buffer and returns a found flag.
  *
@@ -693,16 +756,19 @@ void PluginProcessor::combineEvents(juce::MidiBuffer& a, juce::MidiBuffer& b, in
  * @param m The MIDI message representing the note to search for.
  * @return True if the note is found in the live buffer, false otherwise.
  */
-bool PluginProcessor::searchLive(juce::MidiMessage m) {
+bool PluginProcessor::searchLive(const MidiEvent& m) {
     bool found = false; // Flag to indicate if the note is found
-    juce::MidiMessage mLive;
 
     // Iterate over the events in the live buffer
-    for (int i = 0; i < unmatchedNotes_live.getNumEvents(); i++) {
-        mLive = unmatchedNotes_live.getEventPointer(i)->message;
+    for (size_t i = 0; i < unmatchedNotes_live.size(); i++) {
+        const MidiEvent& mLive = unmatchedNotes_live[i];
+        
+        // Compare sub-sample onsets, so that precise live input (see UmpInput) is not quantized to the block
+        const double liveTime = mLive.getPreciseTime() - timeAdjLive;
+        const double predTime = m.getPreciseTime() - timeAdjPred;
         
         // Check if the live event timestamp is within the acceptable time range
-        if (mLive.getTimeStamp() - timeAdjLive < m.getTimeStamp() - timeBetween - timeAdjPred) { // TO DO: Also need to take into account how much live and prediction are out of sync by
+        if (liveTime < predTime - timeBetween) { // TO DO: Also need to take into account how much live and prediction are out of sync by
             // If the live event is too far ahead of the predicted event, stop searching
             
 //            unmatchedNotes_live.deleteEvent(i,0);
@@ -712,8 +778,12 @@ bool PluginProcessor::searchLive(juce::MidiMessage m) {
 //            break;
         }
 
+        // Under CPU pressure, only live notes close to the predicted onset are considered
+        if (matchBandSamples > 0 && liveTime < predTime - matchBandSamples)
+            continue;
+
         // Check if the live event timestamp is after the predicted event timestamp
-        if (mLive.getTimeStamp() - timeAdjLive > m.getTimeStamp() - timeAdjPred) {
+        if (liveTime > predTime) {
             // If the live event is beyond the predicted event, stop searching
             break;
         }
@@ -722,7 +792,7 @@ bool PluginProcessor::searchLive(juce::MidiMessage m) {
         if (mLive.getNoteNumber() == m.getNoteNumber()) {
             // If the note is found, delete the event from the live buffer and set found to true
             found = true;
-            unmatchedNotes_live.deleteEvent(i, 0);
+            unmatchedNotes_live.erase(unmatchedNotes_live.begin() + (std::ptrdiff_t) i);
             break;
         }
     }
@@ -738,12 +808,12 @@ bool PluginProcessor::searchLive(juce::MidiMessage m) {
  * the events in the live buffer (`liveBuffer`). It determines whether the processing
  * should be paused based on the availability and matching of MIDI events between the two buffers.
  *
- * @param predBuffer The MIDI buffer containing predicted MIDI events.
- * @param liveBuffer The MIDI buffer containing live MIDI events.
+ * @param predBuffer The event list containing predicted MIDI events.
+ * @param liveBuffer The event list containing live MIDI events.
  * @param blockSize The number of samples in every block.
  * @return True if the processing should be paused, false otherwise.
  */
-bool PluginProcessor::checkIfPause(juce::MidiBuffer& predBuffer, juce::MidiBuffer& liveBuffer, int blockSize)
+bool PluginProcessor::checkIfPause(const MidiEventList& predBuffer, const MidiEventList& liveBuffer, int blockSize)
 {
     // TO DO: Use timestamp difference between some section of music for more accurate
     // Assumptions: Live Buffer is at the same speed or slower than Prediction
@@ -758,20 +828,20 @@ bool PluginProcessor::checkIfPause(juce::MidiBuffer& predBuffer, juce::MidiBuffe
         std::cout << "timeAdjPred: " << timeAdjPred << std::endl;
     }
     
-    juce::MidiMessage m; // QUES: use by reference? juce::MidiMessage&
     bool pause = false;
     
     // to maintain order of notes
-    if (unmatchedNotes_live.getNumEvents() > 0)
+    if (unmatchedNotes_live.size() > 0)
         timeAdjLive += blockSize; // checkIfPause being called once every block
     else
         timeAdjLive = 0;
     // copying events from liveBuffer to unmatchedNotes_live
-    for (auto metaB : liveBuffer)
+    for (MidiEvent e : liveBuffer)
     {
-        if (metaB.getMessage().isNoteOnOrOff())
+        if (e.isNoteOnOrOff())
         {
-            unmatchedNotes_live.addEvent(metaB.getMessage(), timeAdjLive);
+            e.sampleTime += timeAdjLive;
+            MidiEvents::insertSorted(unmatchedNotes_live, e);
         }
     }
     
@@ -782,25 +852,28 @@ bool PluginProcessor::checkIfPause(juce::MidiBuffer& predBuffer, juce::MidiBuffe
         timeAdjPred = 0;
 
     // Loop through first unmatchedNotes_pred search in live events
-    while (unmatchedNotes_pred.getNumEvents() > 0)
+    size_t matchedPred = 0;
+    while (matchedPred < unmatchedNotes_pred.size())
     {
-        m = unmatchedNotes_pred.getEventPointer(0)->message;
+        const MidiEvent& m = unmatchedNotes_pred[matchedPred];
         if (!m.isNoteOnOrOff()) { // Not required?
-            unmatchedNotes_pred.deleteEvent(0,0);
+            ++matchedPred;
             continue;
         }
         pause = !searchLive(m);
         if (pause) // If note not found in buffer b, set pause flag
             break;
         else
-            unmatchedNotes_pred.deleteEvent(0,0);
+            ++matchedPred;
     }
+    // Drop everything matched above in one go rather than shifting the queue per note
+    unmatchedNotes_pred.erase(unmatchedNotes_pred.begin(), unmatchedNotes_pred.begin() + (std::ptrdiff_t) matchedPred);
+    
     // Then loop through prediction buffer and search for events in live events
-    for (const auto meta : predBuffer)
+    for (MidiEvent m : predBuffer)
     {
 //            if (DEBUG_FLAG && unmatchedNotes_live.getNumEvents() > 0)
 //                std::cout << "\nCatching up to live now...\n\n";
-        m = meta.getMessage();
         if (! m.isNoteOnOrOff())
             continue;
 
@@ -808,7 +881,8 @@ bool PluginProcessor::checkIfPause(juce::MidiBuffer& predBuffer, juce::MidiBuffe
             pause = !searchLive(m);
 
         if (pause) { // save notes to search later
-            unmatchedNotes_pred.addEvent(m, timeAdjPred);
+            m.sampleTime += timeAdjPred;
+            MidiEvents::insertSorted(unmatchedNotes_pred, m);
         }
     }
     
@@ -824,20 +898,22 @@ bool PluginProcessor::checkIfPause(juce::MidiBuffer& predBuffer, juce::MidiBuffe
  * This function calculates the note density using MIDI events from prediction buffer (`predBuffer`)
  * and live buffer (`liveBuffer`). It maintains a moving window of MIDI events to track changes in note density over time.
  *
- * @param predBuffer The MIDI buffer containing predicted MIDI events.
- * @param liveBuffer The MIDI buffer containing live MIDI events.
+ * @param predBuffer The event list containing predicted MIDI events.
+ * @param liveBuffer The event list containing live MIDI events.
  */
-void PluginProcessor::updateNoteDensity(juce::MidiBuffer& predBuffer, juce::MidiBuffer& liveBuffer) {
+void PluginProcessor::updateNoteDensity(const MidiEventList& predBuffer, const MidiEventList& liveBuffer) {
     // TO DO: Use timestamp difference of x notes rather than number of notes in a timeframe
     // TO DO: Implement some kind of exponential weight decay in timestamp differences? Take into account current async with live, its improvement/ depreciation wrt previous predictions and also the rate of change (improvement)
     // For example, if noteDensity_pred changes dramatically, need to somehow account for that so it doesn't keep oscillating but reaches steady state faster
     
     // use noteDensity in upto numBlocksForDensity buffers
-    num_notes_predicted += predBuffer.getNumEvents() - prev50Pred[prev50PredIndex];
-    num_notes_network += liveBuffer.getNumEvents() - prev50Live[prev50LiveIndex];
+    const int numPred = (int) predBuffer.size();
+    const int numLive = (int) liveBuffer.size();
+    num_notes_predicted += numPred - prev50Pred[prev50PredIndex];
+    num_notes_network += numLive - prev50Live[prev50LiveIndex];
     
-    prev50Pred[prev50PredIndex] = predBuffer.getNumEvents();
-    prev50Live[prev50LiveIndex] = liveBuffer.getNumEvents();
+    prev50Pred[prev50PredIndex] = numPred;
+    prev50Live[prev50LiveIndex] = numLive;
     prev50PredIndex = (prev50PredIndex + 1) % std::max<int>(numBlocksForDensity,1);
     prev50LiveIndex = (prev50LiveIndex + 1) % std::max<int>(numBlocksForDensity,1);
     
@@ -857,19 +933,36 @@ void PluginProcessor::updateNoteDensity(juce::MidiBuffer& predBuffer, juce::Midi
  * @param midiMessages The MIDI buffer containing live MIDI events.
  */
 void PluginProcessor::getBuffers(int blockSize, juce::MidiBuffer& midiMessages) {
-    recordedBuffer = generateMidiBuffer(recordedMidiSequence, getSampleRate(), ((int)noteDensity_pred+1)*blockSize); // read req blocks of rec data
-    if (MODE == 0)
-        liveBuffer = liveMidi[currentBufferIndexLive];
-    else if (MODE == 1)
-        liveBuffer = midiMessages;
+    MP_TRACE_SCOPE("getBuffers");
+    generateMidiBuffer(recordedMidiSequence, getSampleRate(), ((int)getPlaybackRatio()+1)*blockSize, recordedBuffer); // read req blocks of rec data
+    liveBuffer.clear();
+    if (MODE == 0) {
+        const auto end = currentPositionLiveSamples + blockSize;
+        if (generatePerformance) {
+            performanceGenerator.generate(end, liveBuffer);
+            for (auto& event : liveBuffer)
+                event.sampleTime -= currentPositionLiveSamples; // relative to this block
+        }
+        for (; currentPositionLiveMidi < (int) liveMidiSequence.size(); ++currentPositionLiveMidi) {
+            auto event = liveMidiSequence[(size_t) currentPositionLiveMidi];
+            if (event.sampleTime >= end)
+                break;
+            event.sampleTime -= currentPositionLiveSamples; // relative to this block
+            liveBuffer.push_back(event);
+        }
+        currentPositionLiveSamples = end;
+    } else if (MODE == 1) {
+        MidiEvents::appendFromBuffer(liveBuffer, midiMessages, MidiEvent::live); // host boundary
+        umpInput.popBlock(UmpInput::now(), blockSize, liveBuffer); // MIDI 2.0 input keeps its sub-sample onsets
+    }
 
     ++currentBufferIndexLive;
     
     if (DEBUG_FLAG) {
         p50b(prevPredictions, "prevpred", 20);
-        if (liveBuffer.getNumEvents() > 0)
+        if (liveBuffer.size() > 0)
             bufferVals(liveBuffer, "liveBuffer");
-        if (recordedBuffer.getNumEvents() > 0)
+        if (recordedBuffer.size() > 0)
             bufferVals(recordedBuffer, "recordedBuffer");
         std::cout << std::endl;
     }
@@ -896,6 +989,7 @@ void PluginProcessor::getBuffers(int blockSize, juce::MidiBuffer& midiMessages)
  * @return True if the processing should be paused, false otherwise.
  */
 bool PluginProcessor::setPredictionVariables(int predictionCase, int numSamples) {
+    MP_TRACE_SCOPE("setPredictionVariables");
 
     bool paused = false;
     
@@ -930,45 +1024,137 @@ bool PluginProcessor::setPredictionVariables(int predictionCase, int numSamples)
 }
 
 /**
- * @brief Generates MIDI prediction buffer based on the recorded buffer and current tempo.
+ * @brief Locks the score cursor to the host transport while the host is playing.
  *
- * This function generates a MIDI prediction buffer based on the recorded MIDI buffer and the current tempo.
- * It processes each MIDI event from the recorded buffer according to the current tempo and adds it to the prediction buffer.
- * If the processing is paused, an empty buffer is returned.
+ * The cursor is placed `lag` blocks ahead of the host position, measured in beats, and recomputed from the
+ * host's PPQ position every block so that it cannot drift. The tempo ratio follows the host tempo against the
+ * score's tempo map. When the transport starts or jumps, the score index is re-seeked and the matcher queues
+ * are cleared.
+ *
+ * @param numSamples The number of samples in every block.
+ * @return True if the follower is locked to the host for this block.
+ */
+bool PluginProcessor::lockToHost(int numSamples) {
+    auto* playHead = getPlayHead();
+    if (!syncToHost || playHead == nullptr || recordedMidiSequence.empty())
+        return false;
+    
+    auto position = playHead->getPosition();
+    if (!position.hasValue() || !position->getIsPlaying())
+        return false;
+    
+    auto ppq = position->getPpqPosition();
+    auto bpm = position->getBpm();
+    if (!ppq.hasValue() || !bpm.hasValue() || *bpm <= 0.0)
+        return false;
+    
+    hostBpm = *bpm;
+    const double outputSamplesPerBeat = 60.0 * sampleRate_ / hostBpm;
+    lookaheadBeats = lag * numSamples / outputSamplesPerBeat;
+    
+    // Where the prediction generated now will sound, in score beats and score samples
+    const double targetBeat = *ppq + lookaheadBeats - scoreOffsetBeats;
+    const int target = (int) (scoreSpeedShift * scoreTempoMap.beatsToSeconds(targetBeat) * sampleRate_);
+    
+    // Score samples per output sample
+    const double scoreSamplesPerBeat = scoreSpeedShift * sampleRate_ * 60.0 / scoreTempoMap.getBpmAtBeat(targetBeat);
+    hostTempoRatio = scoreSamplesPerBeat / outputSamplesPerBeat;
+    
+    if (!hostLocked || std::abs(target - currentPositionRecSamples) > numSamples * hostTempoRatio + 1) {
+        // Transport started or relocated: seek the score index to the new cursor
+        auto first = std::lower_bound(recordedMidiSequence.begin(), recordedMidiSequence.end(), target,
+                                      [](const MidiEvent& e, int t) { return e.sampleTime < t; });
+        currentPositionRecMidi = (int) (first - recordedMidiSequence.begin());
+        unmatchedNotes_pred.clear();
+        unmatchedNotes_live.clear();
+        if (DEBUG_FLAG) {
+            std::cout << "Locked to host at beat " << targetBeat << ", " << hostBpm << " BPM" << std::endl;
+        }
+    }
+    
+    currentPositionRecSamples = target;
+    return true;
+}
+
+double PluginProcessor::getScorePositionBeats() const {
+    if (sampleRate_ == 0.0)
+        return 0.0;
+    return scoreTempoMap.secondsToBeats(currentPositionRecSamples / (scoreSpeedShift * sampleRate_));
+}
+
+/**
+ * @brief Score samples played per output sample in this block.
+ *
+ * The host's tempo while locked to it, otherwise the predictor's own estimate, which keeps evolving only
+ * while the performer is followed so that it resumes from where it left off after unlocking.
+ */
+double PluginProcessor::getPlaybackRatio() const {
+    return hostLocked ? hostTempoRatio : noteDensity_pred;
+}
+
+double PluginProcessor::getFollowerTempoBpm() const {
+    if (hostLocked)
+        return hostBpm;
+    return scoreTempoMap.getBpmAtBeat(getScorePositionBeats()) * noteDensity_pred / scoreSpeedShift;
+}
+
+/**
+ * @brief Generates the MIDI prediction for this block based on the recorded buffer and current tempo.
+ *
+ * This function generates a MIDI prediction based on the recorded event list and the current tempo.
+ * It processes each MIDI event from the recorded buffer according to the current tempo and adds it to the prediction list.
+ * If the processing is paused, the prediction is left empty.
  *
  * @param numSamples The number of samples in every block.
  * @param paused Flag indicating if processing is paused.
- * @return The generated MIDI prediction buffer.
+ * @param midiPrediction Receives the generated prediction; cleared first, keeps its capacity.
  */
-juce::MidiBuffer PluginProcessor::generate_prediction(int numSamples, bool paused) {
+void PluginProcessor::generate_prediction(int numSamples, bool paused, MidiEventList& midiPrediction) {
+    MP_TRACE_SCOPE("generate_prediction");
     int time_samp;
-    juce::MidiMessage m;
-    juce::MidiBuffer midiPrediction {};
+    midiPrediction.clear();
     
     // Loop through recordedBuffer and add to prediction buffer according to conditions set above
     if (paused) {
-        return {};
+        return;
     }
-    for (const auto meta : recordedBuffer)
+    for (MidiEvent m : recordedBuffer)
     {
-        m = meta.getMessage();
-        midiKeyboardState.processNextMidiEvent(m); // Let PGM display current note
-        auto description = m.getDescription();
+        midiKeyboardState.processNextMidiEvent(m.toMessage()); // Let PGM display current note
         if (DEBUG_FLAG) {
-            std::cout << "Iterating rb2 --- MIDI EVENT:" << description << "\n";
+            std::cout << "Iterating rb2 --- MIDI EVENT:" << m.toMessage().getDescription() << "\n";
         }
         
         // process m according to new tempo
-        time_samp = m.getTimeStamp()/noteDensity_pred;
+        time_samp = m.sampleTime/getPlaybackRatio();
         
         // Add processed midi event to prediction buffer
-        midiPrediction.addEvent (m, time_samp);
+        m.sampleTime = time_samp;
+        m.source = MidiEvent::prediction;
+        MidiEvents::insertSorted(midiPrediction, m);
         currentPositionRecMidi += 1;
 
         if(time_samp >= numSamples)
             break;
     }
-    return midiPrediction;
+}
+
+/**
+ * @brief Stores a block's prediction in the lag timeline and moves the score cursor on.
+ *
+ * The prediction takes the slot of the one just played, which comes back in `midiPrediction` (swapping
+ * keeps every slot's capacity in circulation). While paused the score cursor stays where it is.
+ *
+ * @param midiPrediction This block's prediction; receives the slot it replaced.
+ * @param numSamples The number of samples in the block.
+ * @param paused Whether the follower paused in this block.
+ */
+void PluginProcessor::advancePrediction(MidiEventList& midiPrediction, int numSamples, bool paused) {
+    std::swap(prevPredictions[predictionBufferIndex], midiPrediction);
+    predictionBufferIndex = (predictionBufferIndex+1) % prevPredictions.size();
+    lagPositionPredSamples += numSamples;
+    if (!paused)
+        currentPositionRecSamples += numSamples*getPlaybackRatio();
 }
 
 /**
@@ -988,25 +1174,52 @@ void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::Midi
         return;
     }
     // Obsolete API (which still works): for (MidiBuffer::Iterator i (midiMessages); i.getNextEvent (m, time);)
+    MP_TRACE_THREAD("audio");
+    MP_TRACE_SCOPE("processBlock");
     
+    // Charge this block against its deadline, and degrade according to the blocks before it
+    const CpuGovernor::ScopedBlock governorTiming (governor, buffer.getNumSamples());
+    deadlineMonitor.beginBlock();
+    matchBandSamples = governor.isAtLeast(CpuGovernor::narrowMatching) ? timeBetween / 4 : 0;
+    synthAudioSource.setDegradation(governor.isAtLeast(CpuGovernor::fewerPartials),
+                                    governor.isAtLeast(CpuGovernor::cullVoices) ? culledPolyphony : 0);
+    
+#if USE_PGM == 1
+    // Under load the GUI gets no updates; the shared timeline is output and is always published
+    const bool fullTelemetry = ! governor.isAtLeast(CpuGovernor::skipTelemetry);
     // MAGIC GUI: send midi messages to the keyboard state and MidiLearn
     magicState.processMidiBuffer (midiMessages, buffer.getNumSamples(), true);
     // MAGIC GUI: send playhead information to the GUI
-    magicState.updatePlayheadInformation (getPlayHead());
+    if (fullTelemetry)
+        magicState.updatePlayheadInformation (getPlayHead());
+#endif
+    
+    // While the host is playing, follow its transport instead of the performer
+    hostLocked = lockToHost(buffer.getNumSamples());
     
     // Source 1 (history) recordedBuffer - 2 blocks (lag amount of time in the future of live)
     // Source 2 (rn from file) liveBuffer - 1 block
     getBuffers(buffer.getNumSamples(), midiMessages);
+    deadlineMonitor.mark(DeadlineMonitor::input);
     
-    int predictionCase = 3;
 //    int PLAYBACK = 1; // Playback midi file as is DONE
 //    int PAUSE = 2; // Playback midi file, and if delayed input, pause playback. Add a 1 block speedup when live is ahead
 //    int TEMPO_EXP = 3; // Implement tempo tracking: tempo_prac(n) = a*tempo_prac(n-1) + (1-a)*tempo_network(n-lag)
-    bool isPaused = setPredictionVariables(predictionCase, buffer.getNumSamples());
+    bool isPaused = hostLocked ? false : setPredictionVariables(predictionCase, buffer.getNumSamples());
+    followerPaused = isPaused;
+    // The prediction sounding in this block against what was played
+    predictionTelemetry.addBlock(prevPredictions[predictionBufferIndex], liveBuffer, isPaused, buffer.getNumSamples());
+    deadlineMonitor.mark(DeadlineMonitor::following);
+    const SpeculativeRenderer::Hypothesis hypothesis { getPlaybackRatio(), currentPositionRecSamples, isPaused };
     
     // Use recordedBuffer to generate midiPrediction for playback
     // Sets isPaused through return and noteDensity_pred internally
-    juce::MidiBuffer midiPrediction = generate_prediction(buffer.getNumSamples(), isPaused);
+    generate_prediction(buffer.getNumSamples(), isPaused, midiPrediction);
+    // It sounds lag blocks from now; start reading its samples
+    synthAudioSource.prefetchPrediction(midiPrediction);
+    deadlineMonitor.mark(DeadlineMonitor::prediction);
+    MP_TRACE_COUNTER("unmatched predicted notes", unmatchedNotes_pred.size());
+    MP_TRACE_COUNTER("unmatched live notes", unmatchedNotes_live.size());
     
     // Process midi events and buffer for synthesizer
     juce::AudioSourceChannelInfo bufferInfo;
@@ -1014,27 +1227,66 @@ void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::Midi
     bufferInfo.startSample = 0;
     bufferInfo.numSamples = buffer.getNumSamples();
     
-    // Combine prediction and live performance ofr playback (prevPredictions[predictionBufferIndex] and midiMessages)
-    juce::MidiBuffer midiCombined; // midi file + current keyboard // ideally use different voices for each playback
-    //    combineEvents(midiCombined, recordedBuffer, buffer.getNumSamples());
-    //    combineEvents(midiCombined, recordedBuffer2, buffer.getNumSamples());
-    combineEvents(midiCombined, prevPredictions[predictionBufferIndex], -1, 0); // Uses addEvents with MidiBuffer&
-    combineEvents(midiCombined, liveBuffer);
-    combineEvents(midiCombined, midiMessages);
+    // Route prediction and live performance for playback (prevPredictions[predictionBufferIndex] and midiMessages).
+    // In MODE 1 the host input already is the live stream, so it is only routed once.
+    hostEvents.clear();
+    if (MODE == 0)
+        MidiEvents::appendFromBuffer(hostEvents, midiMessages, MidiEvent::host); // host boundary
+    router.setSource(MidiRouter::prediction, prevPredictions[predictionBufferIndex]);
+    router.setSource(MidiRouter::live, liveBuffer);
+    router.setSource(MidiRouter::host, hostEvents);
     
-    // play prediction notes using synthesizer
-    synthAudioSource.getNextAudioBlock(bufferInfo, midiCombined);
-    // TO DO: Have dual channel synthesize (eg. 2 voices or left and right ear) to avoid note on annd offs getting mixed up
+    // play prediction and live notes on separate engines, pulling straight from the routes
+    synthAudioSource.setFollowerHypothesis(hypothesis);
+    deadlineMonitor.mark(DeadlineMonitor::merging);
+    {
+        MP_TRACE_SCOPE("synth render");
+        synthAudioSource.getNextAudioBlock(bufferInfo, router);
+    }
+    deadlineMonitor.mark(DeadlineMonitor::synthesis);
+    MP_TRACE_COUNTER("active voices", getSynth(SynthAudioSource::Engine::prediction).getNumActiveVoices()
+                                      + getSynth(SynthAudioSource::Engine::live).getNumActiveVoices());
 
     // For plugin to forward it (Midi Filter Plugin case)
-    midiMessages.swapWith (prevPredictions[predictionBufferIndex]); 
+    midiMessages.clear();
+    router.merge(MidiRouter::routeBit(MidiRouter::prediction)).addTo(midiMessages);
+    deadlineMonitor.mark(DeadlineMonitor::merging);
     
-    // Update prediction buffer vectorde
-    prevPredictions[predictionBufferIndex] = midiPrediction;
-    predictionBufferIndex = (predictionBufferIndex+1) % prevPredictions.size();
-    lagPositionPredSamples += buffer.getNumSamples();
-    if (!isPaused)
-        currentPositionRecSamples += buffer.getNumSamples()*noteDensity_pred;
+    synthAudioSource.speculatePrediction(midiPrediction, hypothesis,
+                                         router.getFilter(MidiRouter::prediction), buffer.getNumSamples());
+    advancePrediction(midiPrediction, buffer.getNumSamples(), isPaused);
+    deadlineMonitor.mark(DeadlineMonitor::prediction);
+    
+    // Publish the new prediction (it sounds once its slot comes round again) and the follower state
+    PredictionTimeline::FollowerState followerState {};
+    followerState.warpPositionSamples = currentPositionRecSamples;
+    followerState.tempoRatio = getPlaybackRatio();
+    followerState.tempoBpm = getFollowerTempoBpm();
+    followerState.sampleRate = sampleRate_;
+    followerState.paused = isPaused ? 1 : 0;
+    const auto& published = prevPredictions[(predictionBufferIndex + prevPredictions.size() - 1) % prevPredictions.size()];
+    timelineWriter.publish(published, lag * buffer.getNumSamples(), buffer.getNumSamples(), followerState);
+    deadlineMonitor.mark(DeadlineMonitor::merging);
+    
+    if (injectedLoad > 0.0)
+        governor.burn(buffer.getNumSamples(), injectedLoad);
+    deadlineMonitor.endBlock(buffer.getNumSamples());
+    MP_TRACE_COUNTER("governor level", (int) governor.getLevel());
+    
+#if USE_PGM == 1
+    // MAGIC GUI: the stage loads of this block, and the load history
+    if (fullTelemetry) {
+        for (int stage = 0; stage < DeadlineMonitor::numStages; ++stage)
+            deadlineLevels.setSample(stage, 0, (float) deadlineMonitor.getLastLoad(stage));
+        deadlineMeter->pushSamples(deadlineLevels);
+        deadlinePlot->update();
+        predictionLevels.setSample(0, 0, (float) predictionTelemetry.getHitRate());
+        predictionLevels.setSample(1, 0, (float) predictionTelemetry.getMissingRate());
+        predictionLevels.setSample(2, 0, (float) predictionTelemetry.getExtraRate());
+        predictionMeter->pushSamples(predictionLevels);
+        predictionPlot->update();
+    }
+#endif
 }
 
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -1050,7 +1302,7 @@ bool PluginProcessor::hasEditor() const
 
 juce::AudioProcessorEditor* PluginProcessor::createEditor()
 {
-  return new PluginEditor (*this);
+  return new juce::GenericAudioProcessorEditor (*this);
 }
 
 //==============================================================================
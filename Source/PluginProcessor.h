@@ -11,9 +11,44 @@
 #define JUCE_UNIT_TESTS (0)
 
 #include <JuceHeader.h>
+#include "MidiEvent.h"
+#include "MidiRouter.h"
+#include "UmpInput.h"
+#include "PredictionTimelineWriter.h"
+#include "ScoreTempoMap.h"
+#include "CpuGovernor.h"
+#include "DeadlineMonitor.h"
+#include "PredictionTelemetry.h"
+#include "TelemetryExporter.h"
+#include "PerformanceGenerator.h"
+#include "FollowerSettings.h"
 #include "SynthAudioSource.cpp"
 
+// Builds without Plugin GUI Magic (e.g. the offline renderer) define USE_PGM=0
+#ifndef USE_PGM
 #define USE_PGM (1)
+#endif
+
+#if USE_PGM == 1
+#include "DeadlinePlotSource.h"
+#include "PredictionErrorPlotSource.h"
+#endif
+
+/** Reads a MIDI file into blocks of block-relative events, or into one time-ordered list (see PluginProcessor.cpp). */
+std::vector<MidiEventList> readMIDIFile(const juce::File& midiFile, double sampleRate, int blockSize, int maxBlocks = -1, double speedShift = 1.0);
+MidiEventList readMIDIFile(const juce::File& midiFile, double sampleRate, double speedShift = 1);
+
+/** A score read once at one sample rate and speed shift, for any number of processors to share (see setPreparedScore). */
+struct PreparedScore
+{
+    juce::File file;
+    double sampleRate = 0.0;
+    double speedShift = 1.0;
+    MidiEventList events;  // absolute sample times, time-ordered
+    ScoreTempoMap tempoMap;
+
+    static std::shared_ptr<const PreparedScore> read(const juce::File& file, double sampleRate, double speedShift);
+};
 
 //==============================================================================
 /**
@@ -32,7 +67,7 @@ public:
 
   //==============================================================================
     void printClassState();
-  juce::MidiBuffer generateMidiBuffer(const juce::MidiMessageSequence& midiMessageSequence, double sampleRate, int readSamples);
+  void generateMidiBuffer(const MidiEventList& scoreEvents, double sampleRate, int readSamples, MidiEventList& midiBuffer);
   void prepareToPlay (double sampleRate, int samplesPerBlock) override;
   void releaseResources() override;
 
@@ -40,13 +75,15 @@ public:
   bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
 #endif
 
-  void combineEvents(juce::MidiBuffer& a, juce::MidiBuffer& b, int numSamples, int offset);
-  bool checkIfPause(juce::MidiBuffer& predBuffer, juce::MidiBuffer& liveBuffer, int blockSize);
-    bool searchLive(juce::MidiMessage m);
-    void updateNoteDensity(juce::MidiBuffer& predBuffer, juce::MidiBuffer& liveBuffer);
+  bool checkIfPause(const MidiEventList& predBuffer, const MidiEventList& liveBuffer, int blockSize);
+    bool searchLive(const MidiEvent& m);
+    void updateNoteDensity(const MidiEventList& predBuffer, const MidiEventList& liveBuffer);
     void getBuffers(int blockSize, juce::MidiBuffer& midiMessages);
     bool setPredictionVariables(int predictionCase, int numSamples);
-    juce::MidiBuffer generate_prediction(int numSamples, bool paused);
+    bool lockToHost(int numSamples);
+    double getPlaybackRatio() const;
+    void generate_prediction(int numSamples, bool paused, MidiEventList& midiPrediction);
+    void advancePrediction(MidiEventList& midiPrediction, int numSamples, bool paused);
   void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
 
   //==============================================================================
@@ -83,6 +120,178 @@ public:
     return midiKeyboardState;
   }
 
+  /** Follower tempo in beats per minute: the host's tempo while locked to it, otherwise the tracked performer tempo. */
+  double getFollowerTempoBpm() const;
+
+  /** Score position of the prediction cursor, in beats. */
+  double getScorePositionBeats() const;
+
+  /** When enabled and the host is playing, the score follows the host transport instead of the performer. */
+  void setSyncToHost(bool shouldSync) {
+    syncToHost = shouldSync;
+  }
+
+  /** Host beat that lines up with the first beat of the score. */
+  void setScoreOffsetBeats(double offset) {
+    scoreOffsetBeats = offset;
+  }
+
+  /**
+   * MIDI files read at the next prepareToPlay instead of the ones bundled in the app's Resources: the score
+   * the prediction is read from, and the performance played as the live input in MODE 0.
+   */
+  void setScoreFile(const juce::File& file) {
+    scoreFile = file;
+  }
+
+  void setPerformanceFile(const juce::File& file) {
+    performanceFile = file;
+  }
+
+  /** For testing: the speed prepareToPlay reads the score at, which a PreparedScore must be read at too. */
+  static constexpr double testSpeedChange = 0.5;
+
+  /**
+   * A score already read, used in place of the score file by every prepareToPlay at its sample rate and
+   * speed shift; other rates read the file again. Lets many processors share one parse.
+   */
+  void setPreparedScore(std::shared_ptr<const PreparedScore> score) {
+    preparedScore = std::move(score);
+  }
+
+  /**
+   * Follower settings for every score from the next prepareToPlay, in place of the score's preset.
+   * Without them, each prepareToPlay looks the score up in getFollowerPresets().
+   */
+  void setFollowerSettings(const FollowerSettings& settings) {
+    followerSettings = settings;
+    useFollowerPresets = false;
+  }
+
+  /** The settings the follower was last prepared with. */
+  const FollowerSettings& getFollowerSettings() const {
+    return followerSettings;
+  }
+
+  /** Per-piece follower settings, loaded from FollowerPresets::getDefaultFile() at construction. */
+  FollowerPresets& getFollowerPresets() {
+    return followerPresets;
+  }
+
+  /**
+   * In MODE 0, plays a performance generated from the performance file (see PerformanceGenerator) instead
+   * of the file itself, streamed block by block from the next prepareToPlay.
+   */
+  void setGeneratedPerformance(const PerformanceGenerator::Settings& settings) {
+    performanceGenerator.setSettings(settings);
+    generatePerformance = true;
+  }
+
+  /**
+   * How the prediction follows the performer: 1 plays the score as is, 2 pauses while predicted notes go
+   * unplayed, 3 also tracks the tempo from the note density.
+   */
+  void setPredictionCase(int newCase) {
+    predictionCase = newCase;
+  }
+
+  /** True if the follower held the prediction back in the last block. */
+  bool isFollowerPaused() const {
+    return followerPaused;
+  }
+
+  /**
+   * Whether prepareToPlay opens this instance's shared prediction timeline. Offline runs (e.g. an
+   * evaluation) turn it off, since nothing reads their timeline.
+   */
+  void setPublishTimeline(bool shouldPublish) {
+    publishTimeline = shouldPublish;
+  }
+
+  /** Name of this instance's shared prediction timeline, for PredictionTimeline::Reader::open. */
+  const juce::String& getTimelineName() const {
+    return timelineWriter.getName();
+  }
+
+  /**
+   * Whether the prediction and live engines render on two threads (the default) or both on the thread
+   * calling processBlock, e.g. for offline runs that already keep every core busy. Call before prepareToPlay.
+   */
+  void setParallelRender(bool shouldRenderInParallel) {
+    synthAudioSource.setParallelRender(shouldRenderInParallel);
+  }
+
+  /**
+   * Worker threads for FoleysSynth voices; 0 (the default) renders them on the audio thread. Opt in with
+   * the physical cores the audio thread and the prediction worker leave over. Call before prepareToPlay.
+   */
+  void setVoiceRenderThreads(int numThreads) {
+    synthAudioSource.setVoiceRenderThreads(numThreads);
+  }
+
+  /** Per-route transpose, channel remap and mute for the prediction, live and host streams. */
+  RouteFilter& getRouteFilter(MidiRouter::Route route) {
+    return router.getFilter(route);
+  }
+
+  /** Voice pool of the prediction or live engine: polyphony limit, steal policy, pan and steal statistics. */
+  SineBankSynth& getSynth(SynthAudioSource::Engine engine) {
+    return synthAudioSource.getSynth(engine);
+  }
+
+  /** Block cost against the real-time budget, the current degradation level and its counters. */
+  const CpuGovernor& getGovernor() const {
+    return governor;
+  }
+
+  CpuGovernor& getGovernor() {
+    return governor;
+  }
+
+  /** Time spent in each stage of processBlock against the block's budget: percentiles, maxima and overruns. */
+  const DeadlineMonitor& getDeadlineMonitor() const {
+    return deadlineMonitor;
+  }
+
+  DeadlineMonitor& getDeadlineMonitor() {
+    return deadlineMonitor;
+  }
+
+  /** How well the prediction anticipates the performer: timing errors, hit, missing and extra rates, pauses. */
+  const PredictionTelemetry& getPredictionTelemetry() const {
+    return predictionTelemetry;
+  }
+
+  /**
+   * Writes the prediction telemetry to `file` (CSV if it ends in .csv, binary otherwise) from a background
+   * thread until stopTelemetryExport(); see TelemetryExporter. Replaces any export already running.
+   */
+  bool startTelemetryExport(const juce::File& file);
+  void stopTelemetryExport();
+
+  /** Test harness: spins for this fraction of every block's budget, to put the governor under load. */
+  void setInjectedLoad(double fractionOfBudget) {
+    injectedLoad = fractionOfBudget;
+  }
+
+  /**
+   * Renders the sine bank's prediction ahead of time on a background thread, from the next prepareToPlay.
+   * Has no effect while another voice plays the prediction.
+   */
+  void setSpeculativeRender(bool shouldRenderAhead) {
+    speculativeRender = shouldRenderAhead;
+  }
+
+  /** Hits, misses, corrections and late blocks of the speculative prediction render. */
+  const SpeculativeRenderer& getSpeculativeRenderer() const {
+    return synthAudioSource.getSpeculativeRenderer();
+  }
+
+  /** MIDI 2.0 input for one endpoint: a MIDI 2.0 device callback pushes its packets here (used when MODE == 1). */
+  UmpInput& getUmpInput() {
+    return umpInput;
+  }
+
 private:
 
   bool DEBUG_FLAG = 0;
@@ -98,26 +307,71 @@ private:
     volatile float sampleRate_;
     int MODE = 0; // 0 -> Testing (Live from file), 1 -> Live from buffer
     
-    // For file reading and data storage
-  std::vector<juce::MidiBuffer> prevPredictions;
+    // For file reading and data storage (all timestamps in samples, see MidiEvent.h)
+  std::vector<MidiEventList> prevPredictions; // prediction timeline, one slot per block of lag
     int predictionBufferIndex;
     int predictionPlaybackIndex;
 //  std::vector<juce::MidiBuffer> prevRecordedBlocks;
 //    int prevRecordedBlocksIndex;
-  std::vector<juce::MidiBuffer> liveMidi;
+  MidiEventList liveMidiSequence;     // MODE 0: the performance, absolute sample times
     int currentBufferIndexLive;
-  juce::MidiMessageSequence recordedMidiSequence;
+    int currentPositionLiveMidi;
+    int currentPositionLiveSamples;
+  juce::File scoreFile, performanceFile; // empty for the bundled files
+  std::shared_ptr<const PreparedScore> preparedScore;
+  FollowerSettings followerSettings;     // alpha, timeBetween, lag and numBlocksForDensity come from here
+  FollowerPresets followerPresets;
+  bool useFollowerPresets = true;
+  PerformanceGenerator performanceGenerator; // MODE 0: plays the performance file as a score
+  bool generatePerformance = false;
+  MidiEventList recordedMidiSequence; // score index, absolute sample times
+  ScoreTempoMap scoreTempoMap;        // beat grid of the score, for beat-domain positions and tempo
+  double scoreSpeedShift;             // speedShift the score index was loaded with
     int currentPositionRecMidi;
     int currentPositionRecSamples;
     int lagPositionPredSamples;
-  juce::MidiBuffer recordedBuffer;
-  juce::MidiBuffer liveBuffer;
+  MidiEventList recordedBuffer;
+  MidiEventList liveBuffer;
+  MidiEventList midiPrediction;
+  MidiEventList hostEvents; // host MIDI input for this block, converted once at the boundary
+  MidiRouter router;        // merges prediction, live and host events into the synth and MIDI out
+  UmpInput umpInput;
+  PredictionTimelineWriter timelineWriter; // upcoming predictions for other local processes
+  CpuGovernor governor;                    // degrades gracefully when blocks near their deadline
+  DeadlineMonitor deadlineMonitor;         // where each block's time goes
+#if USE_PGM == 1
+  foleys::MagicLevelSource* deadlineMeter = nullptr; // load of each stage, one channel per stage
+  DeadlinePlotSource* deadlinePlot = nullptr;        // block loads against the budget
+  juce::AudioBuffer<float> deadlineLevels;           // one sample per stage, pushed to deadlineMeter
+#endif
+  PredictionTelemetry predictionTelemetry;           // pairs the sounding prediction with the live notes
+  std::unique_ptr<TelemetryExporter> telemetryExporter;
+#if USE_PGM == 1
+  foleys::MagicLevelSource* predictionMeter = nullptr; // hit, missing and extra rates
+  PredictionErrorPlotSource* predictionPlot = nullptr; // timing errors of the latest hits
+  juce::AudioBuffer<float> predictionLevels;           // one sample per rate, pushed to predictionMeter
+#endif
+  static constexpr int culledPolyphony = 16; // voices per engine at CpuGovernor::cullVoices
+  double injectedLoad = 0.0;
+  bool speculativeRender = false;          // pre-render the prediction lag blocks ahead (sine bank only)
+  bool publishTimeline = true;
+    int predictionCase = 3; // see setPredictionCase
+    bool followerPaused = false;
     int lag; // in number of blocks
     
+    // For host transport sync
+    bool syncToHost = true;
+    bool hostLocked = false;
+    double hostBpm = 0.0;
+    double hostTempoRatio = 1.0; // score samples per output sample while locked; noteDensity_pred is left alone
+    double scoreOffsetBeats = 0.0;
+    double lookaheadBeats = 0.0; // lag expressed in host beats while locked
+    
     // For PausePlay Prediction
-    juce::MidiMessageSequence unmatchedNotes_pred;
-    juce::MidiMessageSequence unmatchedNotes_live;
+    MidiEventList unmatchedNotes_pred;
+    MidiEventList unmatchedNotes_live;
     int timeBetween; //in samples
+    int matchBandSamples = 0; // > 0 while the governor narrows matching to this distance before the onset
     int timeAdjLive;
     int timeAdjPred;
     
@@ -132,7 +386,7 @@ private:
     int prev50PredIndex;
     int prev50LiveIndex;
     
-//    juce::AudioProcessorValueTreeState treeState;
+    juce::AudioProcessorValueTreeState treeState; // FoleysSynth parameters
 //    juce::Synthesiser      synthesiser;
     SynthAudioSource synthAudioSource;
 //    juce::ValueTree  presetNode;
@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    PredictionErrorPlotSource.h
+    Plots the timing errors of the latest predicted notes in the PGM editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PredictionTelemetry.h"
+
+/**
+ * @brief A Plot source for the editor: the timing error of the last PredictionTelemetry::errorWindow
+ * hits, oldest on the left, with early notes below the centre line and the match window at the edges.
+ *
+ * The audio thread calls update() after each block it wants drawn; the plot reads the telemetry's
+ * history when the editor repaints.
+ */
+class PredictionErrorPlotSource  : public foleys::MagicPlotSource
+{
+public:
+    explicit PredictionErrorPlotSource(const PredictionTelemetry& telemetryToPlot) : telemetry(telemetryToPlot) {}
+
+    void update() noexcept  { resetLastDataFlag(); }
+
+    void pushSamples(const juce::AudioBuffer<float>&) override  { update(); }
+
+    void createPlotPaths(juce::Path& path, juce::Path& filledPath, juce::Rectangle<float> bounds, foleys::MagicPlotComponent&) override
+    {
+        telemetry.getErrorHistory(errors);
+
+        const auto range = (float) juce::jmax(1.0, telemetry.getMatchWindowMs());
+        const auto y = [&bounds, range] (float errorMs)  { return bounds.getCentreY() - juce::jlimit(-1.0f, 1.0f, errorMs / range) * 0.5f * bounds.getHeight(); };
+        const auto step = bounds.getWidth() / (float) (PredictionTelemetry::errorWindow - 1);
+
+        path.clear();
+        path.startNewSubPath(bounds.getX(), y(errors[0]));
+        for (int i = 1; i < PredictionTelemetry::errorWindow; ++i)
+            path.lineTo(bounds.getX() + (float) i * step, y(errors[(size_t) i]));
+
+        filledPath = path;
+        filledPath.lineTo(bounds.getRight(), bounds.getCentreY());
+        filledPath.lineTo(bounds.getX(), bounds.getCentreY());
+        filledPath.closeSubPath();
+
+        path.startNewSubPath(bounds.getX(), bounds.getCentreY());
+        path.lineTo(bounds.getRight(), bounds.getCentreY());
+    }
+
+private:
+    const PredictionTelemetry& telemetry;
+    std::array<float, PredictionTelemetry::errorWindow> errors {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PredictionErrorPlotSource)
+};
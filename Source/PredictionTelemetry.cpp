@@ -0,0 +1,226 @@
+/*
+  ==============================================================================
+
+    PredictionTelemetry.cpp
+    Pairs the prediction with the live notes as they happen and keeps rolling accuracy statistics.
+
+  ==============================================================================
+*/
+
+#include "PredictionTelemetry.h"
+
+#include <algorithm>
+#include <cmath>
+
+void PredictionTelemetry::prepare(double newSampleRate, double matchWindowSeconds)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    windowSamples = (std::int64_t) (matchWindowSeconds * sampleRate);
+    position = 0;
+    wasPaused = false;
+    predictedNotes.size = liveNotes.size = 0;
+
+    for (auto& e : errors)
+        e.store(0.0f, std::memory_order_relaxed);
+    errorWrite.store(0, std::memory_order_relaxed);
+
+    outcomes.fill(0);
+    outcomeWrite = 0;
+    windowCounts.fill(0);
+    pauseWrite.store(0, std::memory_order_relaxed);
+    clock.store(0, std::memory_order_relaxed);
+
+    for (auto* counter : { &hits, &missingNotes, &extraNotes, &pauses })
+        counter->store(0, std::memory_order_relaxed);
+    for (auto* rate : { &hitRate, &missingRate, &extraRate })
+        rate->store(0.0, std::memory_order_relaxed);
+
+    // Records already queued stay for the consumer; the FIFO is only ever read by it
+}
+
+void PredictionTelemetry::addBlock(const MidiEventList& predicted, const MidiEventList& live, bool paused, int numSamples) noexcept
+{
+    for (const auto& e : predicted)
+        if (e.isNoteOn())
+            predictedNotes.add({ position + e.sampleTime, (std::uint8_t) e.getNoteNumber() });
+
+    for (const auto& e : live)
+        if (e.isNoteOn())
+            liveNotes.add({ position + e.sampleTime, (std::uint8_t) e.getNoteNumber() });
+
+    // Pair each live note, oldest first, with the nearest prediction of its pitch in the window
+    for (int l = 0; l < liveNotes.size;)
+    {
+        const auto& note = liveNotes.notes[(size_t) l];
+        int best = -1;
+        std::int64_t bestDistance = windowSamples + 1;
+
+        for (int p = 0; p < predictedNotes.size; ++p)
+        {
+            const auto& candidate = predictedNotes.notes[(size_t) p];
+            const auto distance = std::abs(note.time - candidate.time);
+
+            if (candidate.noteNumber == note.noteNumber && distance < bestDistance)
+            {
+                best = p;
+                bestDistance = distance;
+            }
+        }
+
+        if (best < 0)
+        {
+            ++l;
+            continue;
+        }
+
+        const auto errorMs = (float) (1000.0 * (double) (note.time - predictedNotes.notes[(size_t) best].time) / sampleRate);
+        addOutcome(hit, note.time, note.noteNumber, errorMs);
+        predictedNotes.remove(best);
+        liveNotes.remove(l);
+    }
+
+    // Whatever the window has passed by can no longer be paired
+    const auto expired = position + numSamples - windowSamples;
+
+    while (predictedNotes.size > 0 && predictedNotes.notes[0].time < expired)
+    {
+        addOutcome(missing, predictedNotes.notes[0].time, predictedNotes.notes[0].noteNumber);
+        predictedNotes.remove(0);
+    }
+
+    while (liveNotes.size > 0 && liveNotes.notes[0].time < expired)
+    {
+        addOutcome(extra, liveNotes.notes[0].time, liveNotes.notes[0].noteNumber);
+        liveNotes.remove(0);
+    }
+
+    if (paused && ! wasPaused)
+    {
+        pauses.store(pauses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        const auto write = pauseWrite.load(std::memory_order_relaxed);
+        pauseStarts[write % pauseStarts.size()].store(position, std::memory_order_relaxed);
+        pauseWrite.store(write + 1, std::memory_order_release);
+        pushRecord({ position, 0.0f, 0, pause });
+    }
+
+    wasPaused = paused;
+    position += numSamples;
+    clock.store(position, std::memory_order_relaxed);
+}
+
+void PredictionTelemetry::addOutcome(Outcome outcome, std::int64_t sample, std::uint8_t noteNumber, float errorMs) noexcept
+{
+    auto& total = outcome == hit ? hits : (outcome == missing ? missingNotes : extraNotes);
+    total.store(total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    if (outcome == hit)
+    {
+        const auto write = errorWrite.load(std::memory_order_relaxed);
+        errors[write % errorWindow].store(errorMs, std::memory_order_relaxed);
+        errorWrite.store(write + 1, std::memory_order_release);
+    }
+
+    // Slide the outcome window: the oldest outcome leaves the counts once the window is full
+    auto& slot = outcomes[outcomeWrite % outcomeWindow];
+    if (outcomeWrite >= (std::uint32_t) outcomeWindow)
+        --windowCounts[slot];
+    slot = outcome;
+    ++windowCounts[outcome];
+    ++outcomeWrite;
+
+    const auto h = (double) windowCounts[hit], m = (double) windowCounts[missing], x = (double) windowCounts[extra];
+    hitRate.store(h / (h + m + x), std::memory_order_relaxed);
+    missingRate.store(h + m > 0.0 ? m / (h + m) : 0.0, std::memory_order_relaxed);
+    extraRate.store(h + x > 0.0 ? x / (h + x) : 0.0, std::memory_order_relaxed);
+
+    pushRecord({ sample, errorMs, noteNumber, outcome });
+}
+
+void PredictionTelemetry::pushRecord(const Record& record) noexcept
+{
+    const auto scope = recordFifo.write(1);
+
+    if (scope.blockSize1 > 0)
+        records[(size_t) scope.startIndex1] = record;
+    else if (scope.blockSize2 > 0)
+        records[(size_t) scope.startIndex2] = record;
+    else
+        droppedRecords.fetch_add(1, std::memory_order_relaxed);
+}
+
+//==============================================================================
+PredictionTelemetry::Stats PredictionTelemetry::getStats() const noexcept
+{
+    Stats stats;
+    stats.hits = hits.load(std::memory_order_relaxed);
+    stats.missing = missingNotes.load(std::memory_order_relaxed);
+    stats.extra = extraNotes.load(std::memory_order_relaxed);
+    stats.pauses = pauses.load(std::memory_order_relaxed);
+    stats.hitRate = getHitRate();
+    stats.missingRate = getMissingRate();
+    stats.extraRate = getExtraRate();
+
+    // Error statistics from the hits in the window
+    const auto numErrors = (int) std::min<std::uint32_t>(errorWrite.load(std::memory_order_acquire), errorWindow);
+    std::array<float, errorWindow> absolute;
+    double sum = 0.0, absoluteSum = 0.0;
+
+    for (int i = 0; i < numErrors; ++i)
+    {
+        const auto error = errors[(size_t) i].load(std::memory_order_relaxed);
+        sum += error;
+        absoluteSum += (absolute[(size_t) i] = std::abs(error));
+    }
+
+    if (numErrors > 0)
+    {
+        const auto rank = absolute.begin() + (std::ptrdiff_t) (0.95 * (numErrors - 1));
+        std::nth_element(absolute.begin(), rank, absolute.begin() + numErrors);
+
+        stats.meanErrorMs = sum / numErrors;
+        stats.meanAbsErrorMs = absoluteSum / numErrors;
+        stats.p95AbsErrorMs = *rank;
+    }
+
+    // Pauses that started in the last recentSeconds
+    const auto since = clock.load(std::memory_order_relaxed) - (std::int64_t) (recentSeconds * sampleRate);
+    const auto numPauses = std::min<std::uint32_t>(pauseWrite.load(std::memory_order_acquire), (std::uint32_t) pauseStarts.size());
+
+    for (std::uint32_t i = 0; i < numPauses; ++i)
+        if (pauseStarts[i].load(std::memory_order_relaxed) >= since)
+            ++stats.recentPauses;
+
+    return stats;
+}
+
+void PredictionTelemetry::getErrorHistory(std::array<float, errorWindow>& errorsMs) const noexcept
+{
+    const auto write = errorWrite.load(std::memory_order_acquire);
+    for (std::uint32_t i = 0; i < (std::uint32_t) errorWindow; ++i)
+        errorsMs[i] = errors[(write + i) % errorWindow].load(std::memory_order_relaxed);
+}
+
+int PredictionTelemetry::readRecords(Record* dest, int maxRecords) noexcept
+{
+    const auto scope = recordFifo.read(juce::jmin(maxRecords, recordFifo.getNumReady()));
+
+    std::copy_n(records.begin() + scope.startIndex1, scope.blockSize1, dest);
+    std::copy_n(records.begin() + scope.startIndex2, scope.blockSize2, dest + scope.blockSize1);
+    return scope.blockSize1 + scope.blockSize2;
+}
+
+//==============================================================================
+void PredictionTelemetry::PendingList::add(const Pending& note) noexcept
+{
+    // Full: the oldest note gives way (it is nearly always long past pairing)
+    if (size == maxPending)
+        remove(0);
+
+    notes[(size_t) size++] = note;
+}
+
+void PredictionTelemetry::PendingList::remove(int index) noexcept
+{
+    std::copy(notes.begin() + index + 1, notes.begin() + size, notes.begin() + index);
+    --size;
+}
@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+
+    PredictionTelemetry.h
+    Pairs the prediction with the live notes as they happen and keeps rolling accuracy statistics.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MidiEvent.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Measures how well the prediction anticipates the performer, block by block.
+ *
+ * Each block, the note-ons of the prediction that sounds and of the live input are queued on one
+ * sample clock. A live note is paired with the queued predicted note of the same pitch nearest to it,
+ * within the follower's match window either way: that pair is a hit, with a timing error of live
+ * minus predicted onset. A predicted note nobody played within the window is missing; a live note
+ * that was never predicted is extra. Pauses are counted as the follower enters them.
+ *
+ * Rolling statistics cover the last `errorWindow` hits and the last `outcomeWindow` notes:
+ * - hit rate: hits over all outcomes;
+ * - missing rate: missing notes over predicted notes;
+ * - extra rate: extra notes over live notes;
+ * - mean signed and absolute error, and the absolute error's p95, in milliseconds.
+ *
+ * Everything lives in fixed-size arrays: addBlock() runs on the audio thread and never allocates.
+ * getStats() can be called from any thread. Every outcome is also queued as a Record on a lock-free
+ * FIFO for one consumer, such as TelemetryExporter; records that find it full are counted and dropped.
+ */
+class PredictionTelemetry
+{
+public:
+    enum Outcome : std::uint8_t
+    {
+        hit = 0,
+        missing,
+        extra,
+        pause
+    };
+
+    struct Record
+    {
+        std::int64_t sample = 0;  // onset (the live one for hits), samples since prepare()
+        float errorMs = 0.0f;     // hits only
+        std::uint8_t noteNumber = 0;
+        std::uint8_t outcome = hit;
+    };
+
+    struct Stats
+    {
+        std::uint64_t hits = 0, missing = 0, extra = 0, pauses = 0;  // since prepare()
+        double meanErrorMs = 0.0, meanAbsErrorMs = 0.0, p95AbsErrorMs = 0.0;
+        double hitRate = 0.0, missingRate = 0.0, extraRate = 0.0;
+        int recentPauses = 0;  // in the last recentSeconds
+    };
+
+    static constexpr int errorWindow = 256;
+    static constexpr int outcomeWindow = 512;
+    static constexpr int maxPending = 256;
+    static constexpr int recordFifoSize = 4096;
+    static constexpr double recentSeconds = 60.0;
+
+    /** Sets the clock and the pairing window, and clears everything. */
+    void prepare(double sampleRate, double matchWindowSeconds);
+
+    /** Pairs one block's prediction (as it sounds) and live input; times are block-relative. */
+    void addBlock(const MidiEventList& predicted, const MidiEventList& live, bool paused, int numSamples) noexcept;
+
+    Stats getStats() const noexcept;
+
+    /** Rolling rates without the error percentiles, cheap enough for the audio thread. */
+    double getHitRate() const noexcept      { return hitRate.load(std::memory_order_relaxed); }
+    double getMissingRate() const noexcept  { return missingRate.load(std::memory_order_relaxed); }
+    double getExtraRate() const noexcept    { return extraRate.load(std::memory_order_relaxed); }
+
+    /** Timing errors of the last errorWindow hits in milliseconds, oldest first (0 before there are any). */
+    void getErrorHistory(std::array<float, errorWindow>& errorsMs) const noexcept;
+
+    double getMatchWindowMs() const noexcept  { return 1000.0 * windowSamples / sampleRate; }
+    double getSampleRate() const noexcept     { return sampleRate; }
+
+    /** Time of the end of the last block, from prepare(). */
+    double getPositionSeconds() const noexcept  { return (double) clock.load(std::memory_order_relaxed) / sampleRate; }
+
+    /** Moves up to `maxRecords` queued records to `dest`; for a single consumer thread. */
+    int readRecords(Record* dest, int maxRecords) noexcept;
+    std::uint64_t getNumDroppedRecords() const noexcept  { return droppedRecords.load(std::memory_order_relaxed); }
+
+private:
+    struct Pending
+    {
+        std::int64_t time;
+        std::uint8_t noteNumber;
+    };
+
+    struct PendingList
+    {
+        std::array<Pending, maxPending> notes;
+        int size = 0;
+
+        void add(const Pending& note) noexcept;
+        void remove(int index) noexcept;
+    };
+
+    void addOutcome(Outcome outcome, std::int64_t sample, std::uint8_t noteNumber, float errorMs = 0.0f) noexcept;
+    void pushRecord(const Record& record) noexcept;
+
+    double sampleRate = 44100.0;
+    std::int64_t windowSamples = 0;
+    std::int64_t position = 0;
+    bool wasPaused = false;
+
+    PendingList predictedNotes, liveNotes;
+
+    // Rolling windows, with the audio thread's running counts of the outcomes in them
+    std::array<std::atomic<float>, errorWindow> errors {};
+    std::atomic<std::uint32_t> errorWrite { 0 };
+    std::array<std::uint8_t, outcomeWindow> outcomes {};
+    std::uint32_t outcomeWrite = 0;
+    std::array<int, 3> windowCounts {};
+    std::array<std::atomic<std::int64_t>, 64> pauseStarts {};
+    std::atomic<std::uint32_t> pauseWrite { 0 };
+    std::atomic<std::int64_t> clock { 0 };
+
+    std::atomic<std::uint64_t> hits { 0 }, missingNotes { 0 }, extraNotes { 0 }, pauses { 0 };
+    std::atomic<double> hitRate { 0.0 }, missingRate { 0.0 }, extraRate { 0.0 };
+
+    juce::AbstractFifo recordFifo { recordFifoSize };
+    std::array<Record, recordFifoSize> records;
+    std::atomic<std::uint64_t> droppedRecords { 0 };
+};
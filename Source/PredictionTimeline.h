@@ -0,0 +1,222 @@
+/*
+  ==============================================================================
+
+    PredictionTimeline.h
+    Shared-memory layout of the published prediction timeline, and the reader
+    used by other local processes (lighting, page turning, visualization).
+
+    This header deliberately has no JUCE dependency so that external tools can
+    include it on its own.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#if defined (__unix__) || defined (__APPLE__)
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <unistd.h>
+ #define MIDIPREDICT_HAS_POSIX_SHM 1
+#else
+ #define MIDIPREDICT_HAS_POSIX_SHM 0
+#endif
+
+namespace PredictionTimeline
+{
+    static constexpr const char*   namePrefix  = "/midipredict-timeline";
+    static constexpr std::uint32_t magic       = 0x4d50544c; // "MPTL"
+    static constexpr std::uint32_t version     = 1;
+    static constexpr std::uint32_t capacity    = 4096;       // events, power of two
+    static constexpr std::uint64_t mask        = capacity - 1;
+    static constexpr std::uint64_t inFlight    = capacity / 4; // most events the writer publishes at once
+
+    /** A predicted event, stamped with the engine output sample clock at which it will sound. */
+    struct Event
+    {
+        std::int64_t  sampleTime;
+        std::uint8_t  status;
+        std::uint8_t  data1;
+        std::uint8_t  data2;
+        std::uint8_t  source;
+        std::uint16_t velocity16;
+        std::uint16_t reserved;
+    };
+
+    /** Snapshot of the follower, written once per audio block. */
+    struct FollowerState
+    {
+        std::int64_t blockSampleTime;      // engine output clock at the start of the last block
+        double       warpPositionSamples;  // score position of the prediction cursor, in score samples
+        double       tempoRatio;           // performer tempo relative to the score (1 = as written)
+        double       tempoBpm;             // performer tempo in beats per minute, 0 when unknown
+        double       sampleRate;
+        std::int32_t lookaheadSamples;     // how far the published events run ahead of the output
+        std::uint32_t paused;
+    };
+
+    struct alignas (64) Header
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t capacity;
+        std::uint32_t eventSize;
+
+        alignas (64) std::atomic<std::uint64_t> writeCount;    // events ever written
+        alignas (64) std::atomic<std::uint64_t> stateSequence; // seqlock, odd while the state is written
+        FollowerState state;
+    };
+
+    struct Region
+    {
+        Header header;
+        Event  events[capacity];
+    };
+
+    /**
+     * The region published by one plugin instance: "/midipredict-timeline-<process id>-<instance>", with
+     * instances numbered from 0 in the order they were created within their process. The name of a
+     * running instance is shown by PluginProcessor::getTimelineName().
+     */
+    inline void makeName (char* dest, std::size_t size, long processId, unsigned int instance)
+    {
+        std::snprintf (dest, size, "%s-%ld-%u", namePrefix, processId, instance);
+    }
+
+    static_assert (sizeof (Event) == 16, "Event layout is shared with other processes");
+    static_assert (std::atomic<std::uint64_t>::is_always_lock_free, "shared-memory atomics must be lock-free");
+
+    //==============================================================================
+    /**
+     * @brief Maps the timeline published by a running MidiPredict instance, read-only.
+     *
+     * Reading never blocks or slows the writer: once mapped, `readState` and `consume` only touch shared
+     * memory, with no system calls. A reader that falls too far behind skips ahead and reports the
+     * events it missed.
+     */
+    class Reader
+    {
+    public:
+        Reader() = default;
+        ~Reader()                         { close(); }
+
+        Reader (const Reader&) = delete;
+        Reader& operator= (const Reader&) = delete;
+
+        /** Maps the named region (see makeName); returns false if no compatible writer has published it yet. */
+        bool open (const char* name)
+        {
+            close();
+           #if MIDIPREDICT_HAS_POSIX_SHM
+            const int fd = ::shm_open (name, O_RDONLY, 0);
+            if (fd < 0)
+                return false;
+
+            void* mapped = ::mmap (nullptr, sizeof (Region), PROT_READ, MAP_SHARED, fd, 0);
+            ::close (fd);
+
+            if (mapped == MAP_FAILED)
+                return false;
+
+            region = static_cast<const Region*> (mapped);
+            if (region->header.magic != magic || region->header.version != version
+                || region->header.capacity != capacity || region->header.eventSize != sizeof (Event))
+            {
+                close();
+                return false;
+            }
+
+            readCount = region->header.writeCount.load (std::memory_order_acquire);
+            return true;
+           #else
+            (void) name;
+            return false;
+           #endif
+        }
+
+        void close()
+        {
+           #if MIDIPREDICT_HAS_POSIX_SHM
+            if (region != nullptr)
+                ::munmap (const_cast<Region*> (region), sizeof (Region));
+           #endif
+            region = nullptr;
+        }
+
+        bool isOpen() const noexcept      { return region != nullptr; }
+
+        /** Copies a consistent snapshot of the follower state; returns false if none is available. */
+        bool readState (FollowerState& dest) const noexcept
+        {
+            if (region == nullptr)
+                return false;
+
+            for (int attempt = 0; attempt < 64; ++attempt)
+            {
+                const auto before = region->header.stateSequence.load (std::memory_order_acquire);
+                if ((before & 1) != 0)
+                    continue;
+
+                std::memcpy (&dest, &region->header.state, sizeof (FollowerState));
+                std::atomic_thread_fence (std::memory_order_acquire);
+
+                if (region->header.stateSequence.load (std::memory_order_relaxed) == before)
+                    return before != 0;
+            }
+
+            return false;
+        }
+
+        /**
+         * @brief Calls `fn (const Event&)` for every event published since the last call, in place.
+         *
+         * The events are read straight from the shared ring. If the writer lapped the reader while
+         * `fn` was running, the affected events may have been overwritten; they are counted in the
+         * return value so that the caller can discard what it derived from them.
+         *
+         * @return The number of events that were missed or may have been torn.
+         */
+        template <typename Fn>
+        std::uint64_t consume (Fn&& fn)
+        {
+            if (region == nullptr)
+                return 0;
+
+            // The writer may already be filling up to `inFlight` slots past the published count,
+            // so only the most recent (capacity - inFlight) events are safe to read
+            static constexpr auto readable = capacity - inFlight;
+
+            const auto written = region->header.writeCount.load (std::memory_order_acquire);
+            std::uint64_t lost = 0;
+
+            if (written - readCount > readable)
+            {
+                lost = written - readable - readCount;
+                readCount = written - readable;
+            }
+
+            const auto first = readCount;
+            for (; readCount < written; ++readCount)
+                fn (region->events[readCount & mask]);
+
+            // Slots below this index may have been overwritten while we were reading them
+            const auto after = region->header.writeCount.load (std::memory_order_acquire);
+            const auto unsafeBelow = after + inFlight > capacity ? after + inFlight - capacity : 0;
+            if (unsafeBelow > first)
+                lost += std::min (unsafeBelow, written) - first;
+
+            return lost;
+        }
+
+    private:
+        const Region* region = nullptr;
+        std::uint64_t readCount = 0;
+    };
+}
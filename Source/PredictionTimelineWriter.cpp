@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+    PredictionTimelineWriter.cpp
+    Publishes upcoming predictions and follower state into POSIX shared memory.
+
+  ==============================================================================
+*/
+
+#include "PredictionTimelineWriter.h"
+
+#include <atomic>
+#include <cerrno>
+#include <new>
+
+PredictionTimelineWriter::PredictionTimelineWriter()
+{
+    static std::atomic<unsigned int> numInstances { 0 };
+    char name[64];
+
+#if MIDIPREDICT_HAS_POSIX_SHM
+    PredictionTimeline::makeName(name, sizeof(name), (long) ::getpid(), numInstances++);
+#else
+    PredictionTimeline::makeName(name, sizeof(name), 0, numInstances++);
+#endif
+
+    regionName = name;
+}
+
+PredictionTimelineWriter::~PredictionTimelineWriter()
+{
+    close();
+}
+
+bool PredictionTimelineWriter::open()
+{
+    close();
+    blockSampleTime = 0;
+    writeCount = 0;
+
+#if MIDIPREDICT_HAS_POSIX_SHM
+    const auto* name = regionName.toRawUTF8();
+    int fd = ::shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+
+    // Only a crashed process with our process id can have left this name behind
+    if (fd < 0 && errno == EEXIST && ::shm_unlink(name) == 0)
+        fd = ::shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+
+    if (fd < 0)
+    {
+        juce::Logger::writeToLog("Could not create prediction timeline " + regionName);
+        return false;
+    }
+
+    void* mapped = MAP_FAILED;
+    if (::ftruncate(fd, (off_t) sizeof(PredictionTimeline::Region)) == 0)
+        mapped = ::mmap(nullptr, sizeof(PredictionTimeline::Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (mapped == MAP_FAILED)
+    {
+        juce::Logger::writeToLog("Could not map prediction timeline " + regionName);
+        ::shm_unlink(name);
+        return false;
+    }
+
+    // Readers check the magic number last, so fill in everything else first
+    region = static_cast<PredictionTimeline::Region*>(mapped);
+    auto& header = region->header;
+    header.magic = 0;
+    new (&header.writeCount) std::atomic<std::uint64_t>(0);
+    new (&header.stateSequence) std::atomic<std::uint64_t>(0);
+    header.version = PredictionTimeline::version;
+    header.capacity = PredictionTimeline::capacity;
+    header.eventSize = sizeof(PredictionTimeline::Event);
+    header.state = {};
+    std::atomic_thread_fence(std::memory_order_release);
+    header.magic = PredictionTimeline::magic;
+
+    juce::Logger::writeToLog("Publishing the prediction timeline as " + regionName);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void PredictionTimelineWriter::close()
+{
+#if MIDIPREDICT_HAS_POSIX_SHM
+    if (region != nullptr) // then open created the name exclusively, so it is ours to unlink
+    {
+        region->header.magic = 0;
+        ::munmap(region, sizeof(PredictionTimeline::Region));
+        ::shm_unlink(regionName.toRawUTF8());
+    }
+#endif
+    region = nullptr;
+}
+
+void PredictionTimelineWriter::publish(const MidiEventList& predictions, int lookaheadSamples, int numSamples, PredictionTimeline::FollowerState state) noexcept
+{
+    if (region == nullptr)
+        return;
+
+    auto& header = region->header;
+
+    // Events first, then make them visible by advancing the write count. Readers assume that no more
+    // than `inFlight` events are written at once.
+    const auto numEvents = std::min(predictions.size(), (size_t) PredictionTimeline::inFlight);
+    for (size_t i = 0; i < numEvents; ++i)
+    {
+        const auto& e = predictions[i];
+        auto& slot = region->events[writeCount & PredictionTimeline::mask];
+        slot.sampleTime = blockSampleTime + lookaheadSamples + e.sampleTime;
+        slot.status = e.status;
+        slot.data1 = e.data1;
+        slot.data2 = e.data2;
+        slot.source = e.source;
+        slot.velocity16 = e.velocity16;
+        slot.reserved = 0;
+        ++writeCount;
+    }
+    header.writeCount.store(writeCount, std::memory_order_release);
+
+    // Seqlock around the follower state
+    state.blockSampleTime = blockSampleTime;
+    state.lookaheadSamples = lookaheadSamples;
+
+    const auto sequence = header.stateSequence.load(std::memory_order_relaxed);
+    header.stateSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    header.state = state;
+    header.stateSequence.store(sequence + 2, std::memory_order_release);
+
+    blockSampleTime += numSamples;
+}
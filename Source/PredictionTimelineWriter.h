@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    PredictionTimelineWriter.h
+    Publishes upcoming predictions and follower state into POSIX shared memory.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MidiEvent.h"
+#include "PredictionTimeline.h"
+
+/**
+ * @brief Single writer of the shared prediction timeline (see PredictionTimeline.h for the layout and reader).
+ *
+ * Each writer publishes under its own name (see PredictionTimeline::makeName), so that instances in one
+ * host or in several processes never share a region. `open` creates and maps the region and must be
+ * called off the audio thread (prepareToPlay); `close` unlinks it again, and only ever a region this
+ * writer created.
+ * `publish` is wait-free and only writes to the mapping, so a slow or stalled reader can never block
+ * the audio thread; readers that fall behind simply lose the oldest events.
+ */
+class PredictionTimelineWriter
+{
+public:
+    PredictionTimelineWriter();
+    ~PredictionTimelineWriter();
+
+    /** Creates (or re-creates) this writer's shared region. Returns false where POSIX shared memory is unavailable. */
+    bool open();
+    void close();
+    bool isOpen() const noexcept       { return region != nullptr; }
+
+    /** The name readers open, unique to this writer. */
+    const juce::String& getName() const noexcept  { return regionName; }
+
+    /**
+     * @brief Publishes one block's predictions and the follower state. Audio thread.
+     *
+     * @param predictions This block's prediction, block-relative sample times.
+     * @param lookaheadSamples How far ahead of the output the predictions will sound.
+     * @param numSamples The block size, used to advance the engine output clock.
+     * @param state The follower state; `blockSampleTime` and `lookaheadSamples` are filled in here.
+     */
+    void publish(const MidiEventList& predictions, int lookaheadSamples, int numSamples, PredictionTimeline::FollowerState state) noexcept;
+
+private:
+    PredictionTimeline::Region* region = nullptr;
+    juce::String regionName;
+    std::int64_t blockSampleTime = 0;
+    std::uint64_t writeCount = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PredictionTimelineWriter)
+};
@@ -0,0 +1,205 @@
+/*
+  ==============================================================================
+
+    RenderPool.cpp
+    Work-stealing pool that spreads the tasks of one audio block over several threads.
+
+  ==============================================================================
+*/
+
+#include "RenderPool.h"
+#include "Trace.h"
+
+#include <thread>
+
+class RenderPool::Worker : private juce::Thread
+{
+public:
+    Worker(RenderPool& owner, int participantIndex)
+        : juce::Thread("MidiPredict render pool " + juce::String(participantIndex)),
+          pool(owner), participant(participantIndex)
+    {
+    }
+
+    ~Worker() override
+    {
+        stop();
+    }
+
+    void start()
+    {
+        if (! isThreadRunning())
+            startRealtimeThread(juce::Thread::RealtimeOptions{});
+    }
+
+    void stop()
+    {
+        signalThreadShouldExit();
+        wakeUp.signal();
+        stopThread(1000);
+    }
+
+    void wakeIfSleeping() noexcept
+    {
+        if (sleeping.load())
+            wakeUp.signal();
+    }
+
+private:
+    void run() override
+    {
+        auto seen = pool.generation.load();
+        auto lastWork = juce::Time::getMillisecondCounterHiRes();
+
+        while (! threadShouldExit())
+        {
+            const auto current = pool.generation.load(std::memory_order_acquire);
+
+            if (current != seen)
+            {
+                seen = current;
+                MP_TRACE_SCOPE("render pool work");
+                pool.work(participant);
+                lastWork = juce::Time::getMillisecondCounterHiRes();
+                continue;
+            }
+
+            if (juce::Time::getMillisecondCounterHiRes() - lastWork < idleTimeoutMs)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // Same handshake as RenderWorker: a block started after `sleeping` is raised is never missed
+            sleeping.store(true);
+            pool.numSleeping.fetch_add(1);
+            if (pool.generation.load() == seen)
+                wakeUp.wait(idleTimeoutMs * 10);
+            pool.numSleeping.fetch_sub(1);
+            sleeping.store(false);
+            lastWork = juce::Time::getMillisecondCounterHiRes();
+        }
+    }
+
+    RenderPool& pool;
+    const int participant;
+    std::atomic<bool> sleeping { false };
+    juce::WaitableEvent wakeUp;
+
+    JUCE_DECLARE_NON_COPYABLE(Worker)
+};
+
+//==============================================================================
+RenderPool::RenderPool(int numWorkers)
+    : numParticipants(juce::jmax(0, numWorkers) + 1)
+{
+    ranges.reset(new Range[(size_t) numParticipants]);
+
+    // Participant 0 is the caller of run()
+    for (int i = 1; i < numParticipants; ++i)
+        workers.push_back(std::make_unique<Worker>(*this, i));
+}
+
+RenderPool::~RenderPool()
+{
+    stop();
+}
+
+void RenderPool::start()
+{
+    for (auto& w : workers)
+        w->start();
+}
+
+void RenderPool::stop()
+{
+    for (auto& w : workers)
+        w->stop();
+}
+
+void RenderPool::run(Task task, void* context, int numTasks) noexcept
+{
+    if (numTasks <= 0)
+        return;
+
+    currentTask.store(task, std::memory_order_relaxed);
+    currentContext.store(context, std::memory_order_relaxed);
+    remaining.store(numTasks, std::memory_order_relaxed);
+
+    // Released with each range, so whoever takes a task from it also sees the task and context
+    for (int p = 0; p < numParticipants; ++p)
+    {
+        const auto begin = (std::uint32_t) (numTasks * p / numParticipants);
+        const auto end   = (std::uint32_t) (numTasks * (p + 1) / numParticipants);
+        ranges[(size_t) p].bounds.store(pack(begin, end), std::memory_order_release);
+    }
+
+    generation.fetch_add(1); // seq_cst, paired with the workers' `numSleeping` increment
+
+    if (numSleeping.load() > 0)
+        for (auto& w : workers)
+            w->wakeIfSleeping();
+
+    work(0);
+
+    while (remaining.load(std::memory_order_acquire) > 0)
+        std::this_thread::yield();
+}
+
+int RenderPool::takeOwn(int owner) noexcept
+{
+    auto& bounds = ranges[(size_t) owner].bounds;
+    auto current = bounds.load(std::memory_order_acquire);
+
+    for (;;)
+    {
+        const auto begin = (std::uint32_t) current;
+        const auto end = (std::uint32_t) (current >> 32);
+
+        if (begin >= end)
+            return -1;
+
+        if (bounds.compare_exchange_weak(current, pack(begin + 1, end), std::memory_order_acquire))
+            return (int) begin;
+    }
+}
+
+int RenderPool::steal(int thief) noexcept
+{
+    for (int i = 1; i < numParticipants; ++i)
+    {
+        auto& bounds = ranges[(size_t) ((thief + i) % numParticipants)].bounds;
+        auto current = bounds.load(std::memory_order_acquire);
+
+        for (;;)
+        {
+            const auto begin = (std::uint32_t) current;
+            const auto end = (std::uint32_t) (current >> 32);
+
+            if (begin >= end)
+                break;
+
+            if (bounds.compare_exchange_weak(current, pack(begin, end - 1), std::memory_order_acquire))
+                return (int) end - 1;
+        }
+    }
+
+    return -1;
+}
+
+void RenderPool::work(int participant) noexcept
+{
+    for (;;)
+    {
+        auto taskIndex = takeOwn(participant);
+
+        if (taskIndex < 0)
+            taskIndex = steal(participant);
+
+        if (taskIndex < 0)
+            return;
+
+        currentTask.load(std::memory_order_relaxed)(currentContext.load(std::memory_order_relaxed), taskIndex);
+        remaining.fetch_sub(1, std::memory_order_release);
+    }
+}
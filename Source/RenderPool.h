@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    RenderPool.h
+    Work-stealing pool that spreads the tasks of one audio block over several threads.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Runs the numbered tasks of one block on the calling thread and a fixed set of workers.
+ *
+ * `run` splits the task indices into one contiguous range per participant, the caller included. Each
+ * participant takes tasks from the front of its own range. Once that is empty, it steals from the back
+ * of the others. Every range is one atomic word, so taking a task is a single compare-and-swap. There
+ * are no locks, and nothing is allocated after construction.
+ *
+ * The caller works too, and it can steal any task a worker has not started. A worker that is late or
+ * descheduled therefore only delays the block by the task it is running. Like RenderWorker, the
+ * workers spin while blocks keep arriving and sleep on an event after `idleTimeoutMs` without work.
+ *
+ * Which thread runs a task is not fixed. Callers that need reproducible output give every task its
+ * own output and combine the outputs in task order afterwards.
+ */
+class RenderPool
+{
+public:
+    using Task = void (*)(void* context, int taskIndex);
+
+    /** `numWorkers` threads besides the caller; 0 runs everything on the caller. */
+    explicit RenderPool(int numWorkers);
+    ~RenderPool();
+
+    void start();
+    void stop();
+
+    int getNumWorkers() const noexcept  { return (int) workers.size(); }
+
+    /** Calls `task(context, i)` once for every i in [0, numTasks) and returns when all calls are done. */
+    void run(Task task, void* context, int numTasks) noexcept;
+
+private:
+    class Worker;
+
+    /** A range of task indices packed into one word: begin in the low half, end in the high half. */
+    struct alignas(64) Range
+    {
+        std::atomic<std::uint64_t> bounds { 0 };
+    };
+
+    static std::uint64_t pack(std::uint32_t begin, std::uint32_t end) noexcept  { return ((std::uint64_t) end << 32) | begin; }
+
+    /** Takes a task from the front of range `owner`, or -1 if it is empty. */
+    int takeOwn(int owner) noexcept;
+
+    /** Takes a task from the back of any range other than `thief`, or -1 if all are empty. */
+    int steal(int thief) noexcept;
+
+    /** Runs tasks until none are left to take. */
+    void work(int participant) noexcept;
+
+    static constexpr double idleTimeoutMs = 100.0;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::unique_ptr<Range[]> ranges;
+    int numParticipants = 1;
+
+    std::atomic<Task> currentTask { nullptr };
+    std::atomic<void*> currentContext { nullptr };
+    std::atomic<int> remaining { 0 };
+    std::atomic<std::uint32_t> generation { 0 };
+    std::atomic<int> numSleeping { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(RenderPool)
+};
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    RenderWorker.cpp
+    A second thread that takes one render job per block off the audio thread.
+
+  ==============================================================================
+*/
+
+#include "RenderWorker.h"
+#include "Trace.h"
+
+#include <thread>
+
+RenderWorker::RenderWorker() : juce::Thread("MidiPredict render worker")
+{
+}
+
+RenderWorker::~RenderWorker()
+{
+    stop();
+}
+
+void RenderWorker::start()
+{
+    if (! isThreadRunning())
+        startRealtimeThread(juce::Thread::RealtimeOptions{});
+}
+
+void RenderWorker::stop()
+{
+    signalThreadShouldExit();
+    wakeUp.signal();
+    stopThread(1000);
+    state.store(idle);
+}
+
+void RenderWorker::post(Job job, void* context) noexcept
+{
+    pendingJob = job;
+    pendingContext = context;
+    state.store(posted); // seq_cst, paired with the worker's store to `sleeping`
+
+    if (sleeping.load())
+        wakeUp.signal();
+}
+
+void RenderWorker::finish() noexcept
+{
+    int expected = posted;
+
+    if (state.compare_exchange_strong(expected, taken, std::memory_order_acquire))
+    {
+        // The worker has not started the job, so run it here rather than wait for it
+        pendingJob(pendingContext);
+    }
+    else
+    {
+        while (state.load(std::memory_order_acquire) != done)
+            std::this_thread::yield();
+    }
+
+    state.store(idle, std::memory_order_relaxed);
+}
+
+void RenderWorker::run()
+{
+    auto lastWork = juce::Time::getMillisecondCounterHiRes();
+
+    while (! threadShouldExit())
+    {
+        int expected = posted;
+
+        if (state.compare_exchange_strong(expected, taken, std::memory_order_acquire))
+        {
+            {
+                MP_TRACE_SCOPE("render job");
+                pendingJob(pendingContext);
+            }
+            state.store(done, std::memory_order_release);
+            lastWork = juce::Time::getMillisecondCounterHiRes();
+            continue;
+        }
+
+        if (juce::Time::getMillisecondCounterHiRes() - lastWork < idleTimeoutMs)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Nothing to do for a while: sleep until the next post. Checking the state after raising
+        // `sleeping` means a job posted in between is never missed.
+        sleeping.store(true);
+        if (state.load() != posted)
+            wakeUp.wait(idleTimeoutMs * 10);
+        sleeping.store(false);
+        lastWork = juce::Time::getMillisecondCounterHiRes();
+    }
+}
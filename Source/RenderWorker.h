@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    RenderWorker.h
+    A second thread that takes one render job per block off the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <atomic>
+
+/**
+ * @brief Runs one job per audio block on a worker thread while the audio thread does its own share.
+ *
+ * The audio thread posts a job and runs its local work. Afterwards it either waits for the worker to
+ * finish the job or, if the worker has not picked it up yet, takes the job back and runs it itself. A
+ * descheduled worker therefore never holds up the block, and nothing is locked or allocated.
+ *
+ * While blocks keep arriving the worker spins, yielding between checks. After `idleTimeoutMs` without
+ * work it sleeps on an event. Only the first block after such a pause pays for the wake-up.
+ */
+class RenderWorker : private juce::Thread
+{
+public:
+    using Job = void (*)(void* context);
+
+    RenderWorker();
+    ~RenderWorker() override;
+
+    void start();
+    void stop();
+    bool isRunning() const noexcept  { return isThreadRunning(); }
+
+    /** Runs `job` on the worker and `local` on the calling thread, and returns when both are done. */
+    template <typename Local>
+    void runInParallel(Job job, void* context, Local&& local)
+    {
+        post(job, context);
+        local();
+        finish();
+    }
+
+private:
+    enum State : int
+    {
+        idle = 0,
+        posted,
+        taken,
+        done
+    };
+
+    void post(Job job, void* context) noexcept;
+    void finish() noexcept;
+    void run() override;
+
+    static constexpr double idleTimeoutMs = 100.0;
+
+    Job pendingJob = nullptr;
+    void* pendingContext = nullptr;
+    std::atomic<int> state { idle };
+    std::atomic<bool> sleeping { false };
+    juce::WaitableEvent wakeUp;
+
+    JUCE_DECLARE_NON_COPYABLE(RenderWorker)
+};
@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    ScoreTempoMap.cpp
+    Beat grid and tempo changes of a score, kept from the MIDI file's ticks.
+
+  ==============================================================================
+*/
+
+#include "ScoreTempoMap.h"
+#include "Trace.h"
+
+#include <algorithm>
+
+ScoreTempoMap::ScoreTempoMap()
+    : segments { { 0.0, 0.0, 0.5 } } // MIDI default of 120 BPM
+{
+}
+
+void ScoreTempoMap::build(const juce::MidiFile& fileInTicks)
+{
+    segments = { { 0.0, 0.0, 0.5 } };
+
+    const int ticksPerQuarterNote = fileInTicks.getTimeFormat();
+    if (ticksPerQuarterNote <= 0)
+        return; // SMPTE timing, no beat grid
+
+    juce::MidiMessageSequence tempoEvents;
+    fileInTicks.findAllTempoEvents(tempoEvents);
+    tempoEvents.sort();
+
+    for (int i = 0; i < tempoEvents.getNumEvents(); ++i)
+    {
+        const auto& message = tempoEvents.getEventPointer(i)->message;
+        const double beat = message.getTimeStamp() / ticksPerQuarterNote;
+        const double secondsPerBeat = message.getTempoSecondsPerQuarterNote();
+
+        if (secondsPerBeat <= 0.0)
+            continue;
+
+        auto& last = segments.back();
+        if (beat <= last.beat)
+        {
+            last.secondsPerBeat = secondsPerBeat; // tempo change at the same position replaces the previous one
+            continue;
+        }
+
+        segments.push_back({ beat, last.seconds + (beat - last.beat) * last.secondsPerBeat, secondsPerBeat });
+    }
+}
+
+ScoreTempoMap ScoreTempoMap::fromFile(const juce::File& midiFile)
+{
+    MP_TRACE_SCOPE("ScoreTempoMap::fromFile");
+    ScoreTempoMap map;
+    juce::FileInputStream fileInputStream(midiFile);
+    juce::MidiFile midiFileData;
+
+    if (fileInputStream.openedOk() && midiFileData.readFrom(fileInputStream))
+        map.build(midiFileData);
+    else
+        juce::Logger::writeToLog("Error reading tempo map from MIDI file: " + midiFile.getFullPathName());
+
+    return map;
+}
+
+const ScoreTempoMap::Segment& ScoreTempoMap::segmentForBeat(double beats) const noexcept
+{
+    auto it = std::upper_bound(segments.begin(), segments.end(), beats,
+                               [](double b, const Segment& s) { return b < s.beat; });
+    return it == segments.begin() ? segments.front() : *(it - 1);
+}
+
+const ScoreTempoMap::Segment& ScoreTempoMap::segmentForSeconds(double seconds) const noexcept
+{
+    auto it = std::upper_bound(segments.begin(), segments.end(), seconds,
+                               [](double t, const Segment& s) { return t < s.seconds; });
+    return it == segments.begin() ? segments.front() : *(it - 1);
+}
+
+double ScoreTempoMap::beatsToSeconds(double beats) const noexcept
+{
+    const auto& s = segmentForBeat(beats);
+    return s.seconds + (beats - s.beat) * s.secondsPerBeat;
+}
+
+double ScoreTempoMap::secondsToBeats(double seconds) const noexcept
+{
+    const auto& s = segmentForSeconds(seconds);
+    return s.beat + (seconds - s.seconds) / s.secondsPerBeat;
+}
+
+double ScoreTempoMap::getBpmAtBeat(double beats) const noexcept
+{
+    return 60.0 / segmentForBeat(beats).secondsPerBeat;
+}
@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    ScoreTempoMap.h
+    Beat grid and tempo changes of a score, kept from the MIDI file's ticks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <vector>
+
+/**
+ * @brief Maps between score beats (quarter notes) and score seconds using the file's tempo events.
+ *
+ * `juce::MidiFile::convertTimestampTicksToSeconds` throws the beat grid away, so the tempo map is built
+ * from the tick timestamps before that conversion. Files with SMPTE time formats have no beat grid and
+ * are treated as 120 BPM throughout.
+ */
+class ScoreTempoMap
+{
+public:
+    ScoreTempoMap();
+
+    /** Builds the map from a file whose timestamps are still in ticks. */
+    void build(const juce::MidiFile& fileInTicks);
+
+    /** Reads `midiFile` and builds its tempo map; a default 120 BPM map is returned on error. */
+    static ScoreTempoMap fromFile(const juce::File& midiFile);
+
+    double beatsToSeconds(double beats) const noexcept;
+    double secondsToBeats(double seconds) const noexcept;
+    double getBpmAtBeat(double beats) const noexcept;
+
+private:
+    struct Segment
+    {
+        double beat;
+        double seconds;
+        double secondsPerBeat;
+    };
+
+    const Segment& segmentForBeat(double beats) const noexcept;
+    const Segment& segmentForSeconds(double seconds) const noexcept;
+
+    std::vector<Segment> segments; // never empty, sorted by beat
+};
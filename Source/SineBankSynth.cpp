@@ -0,0 +1,400 @@
+/*
+  ==============================================================================
+
+    SineBankSynth.cpp
+    Sine synth that renders all voices together from struct-of-arrays state.
+
+  ==============================================================================
+*/
+
+#include "SineBankSynth.h"
+#include "OscillatorMath.h"
+
+#include <algorithm>
+
+using OscillatorMath::sineOfPhase;
+using OscillatorMath::advancePhase;
+
+SineBankSynth::SineBankSynth()
+{
+    note.fill(-1);
+
+    for (int v = 0; v < maxVoices; ++v)
+        clearVoice(v);
+
+    setNumVoices(4);
+}
+
+void SineBankSynth::setNumVoices(int newNumVoices) noexcept
+{
+    newNumVoices = juce::jlimit(1, maxVoices, newNumVoices);
+
+    for (int v = newNumVoices; v < numVoices; ++v)
+        if (note[(size_t) v] >= 0)
+            clearVoice(v);
+
+    numVoices = newNumVoices;
+
+    for (int v = 0; v < maxVoices; ++v)
+        setFree(v, v < numVoices && note[(size_t) v] < 0);
+}
+
+void SineBankSynth::setPan(float newPan) noexcept
+{
+    pan = juce::jlimit(-1.0f, 1.0f, newPan);
+    channelGains = { getBalanceGain(pan, 0), getBalanceGain(pan, 1) };
+}
+
+int SineBankSynth::getNumActiveVoices() const noexcept
+{
+    int active = 0;
+    for (auto n : soundingInGroup)
+        active += n;
+    return active;
+}
+
+void SineBankSynth::cullQuietestVoices(int maxActiveVoices) noexcept
+{
+    for (int active = getNumActiveVoices(); active > juce::jmax(0, maxActiveVoices); --active)
+    {
+        int quietest = -1;
+        for (int v = 0; v < numVoices; ++v)
+        {
+            const auto i = (size_t) v;
+            if (note[i] >= 0 && (quietest < 0 || level[i] * tail[i] < level[(size_t) quietest] * tail[(size_t) quietest]))
+                quietest = v;
+        }
+
+        if (quietest < 0)
+            break;
+
+        clearVoice(quietest);
+    }
+}
+
+//==============================================================================
+void SineBankSynth::setFree(int v, bool isFree) noexcept
+{
+    const auto bit = 1u << (v & 31);
+    auto& word = freeVoices[(size_t) (v >> 5)];
+    word = isFree ? (word | bit) : (word & ~bit);
+}
+
+int SineBankSynth::findFreeVoice() const noexcept
+{
+    for (size_t w = 0; w < freeVoices.size(); ++w)
+    {
+        // Lowest set bit, so that sounding voices stay packed at the start of the bank
+        if (const auto word = freeVoices[w])
+            return (int) (w * 32) + juce::findHighestSetBit(word & (~word + 1));
+    }
+
+    return -1;
+}
+
+int SineBankSynth::allocateVoice(int midiChannel, int midiNoteNumber) noexcept
+{
+    ++notesStarted;
+
+    if (stealPolicy == StealPolicy::samePitch)
+    {
+        for (int v = 0; v < numVoices; ++v)
+            if (note[(size_t) v] == midiNoteNumber && channel[(size_t) v] == midiChannel)
+                return v;
+    }
+
+    const int free = findFreeVoice();
+    if (free >= 0)
+        return free;
+
+    ++voicesStolen;
+    return findVoiceToSteal();
+}
+
+int SineBankSynth::findVoiceToSteal() const noexcept
+{
+    if (stealPolicy == StealPolicy::quietest)
+    {
+        int quietest = 0;
+        for (int v = 1; v < numVoices; ++v)
+        {
+            const auto i = (size_t) v, q = (size_t) quietest;
+            const float amplitude = level[i] * tail[i], quietestAmplitude = level[q] * tail[q];
+            if (amplitude < quietestAmplitude || (amplitude == quietestAmplitude && noteOnTime[i] < noteOnTime[q]))
+                quietest = v;
+        }
+        return quietest;
+    }
+
+    int oldest = 0, oldestReleased = -1;
+
+    for (int v = 0; v < numVoices; ++v)
+    {
+        const auto i = (size_t) v;
+
+        if (noteOnTime[i] < noteOnTime[(size_t) oldest])
+            oldest = v;
+
+        if (! keyDown[i] && ! sustained[i] && (oldestReleased < 0 || noteOnTime[i] < noteOnTime[(size_t) oldestReleased]))
+            oldestReleased = v;
+    }
+
+    return oldestReleased >= 0 ? oldestReleased : oldest;
+}
+
+void SineBankSynth::startVoice(int v, int midiChannel, int midiNoteNumber, float velocity) noexcept
+{
+    const auto i = (size_t) v;
+
+    if (note[i] < 0)
+    {
+        ++soundingInGroup[i / lanes];
+        setFree(v, false);
+    }
+
+    note[i] = (std::int8_t) midiNoteNumber;
+    channel[i] = (std::int8_t) midiChannel;
+    keyDown[i] = true;
+    sustained[i] = false;
+    noteOnTime[i] = noteCounter++;
+
+    phase[i] = 0.0f;
+    increment[i] = (float) (juce::MidiMessage::getMidiNoteInHertz(midiNoteNumber) / sampleRate);
+    level[i] = velocity * 0.15f;
+    tail[i] = 1.0f;
+    tailMultiplier[i] = 1.0f;
+}
+
+void SineBankSynth::stopVoice(int v, bool allowTailOff) noexcept
+{
+    const auto i = (size_t) v;
+    keyDown[i] = false;
+    sustained[i] = false;
+
+    if (! allowTailOff)
+        clearVoice(v);
+    else if (tailMultiplier[i] == 1.0f)
+        tailMultiplier[i] = tailOffPerSample; // tail starts at 1, as in SineWaveVoice::stopNote
+}
+
+void SineBankSynth::clearVoice(int v) noexcept
+{
+    const auto i = (size_t) v;
+
+    if (note[i] >= 0)
+    {
+        --soundingInGroup[i / lanes];
+        setFree(v, v < numVoices);
+    }
+
+    note[i] = -1;
+    keyDown[i] = false;
+    sustained[i] = false;
+
+    // A free lane still runs through the kernel, it just contributes nothing
+    phase[i] = 0.0f;
+    increment[i] = 0.0f;
+    level[i] = 0.0f;
+    tail[i] = 1.0f;
+    tailMultiplier[i] = 1.0f;
+}
+
+//==============================================================================
+void SineBankSynth::noteOn(int midiChannel, int midiNoteNumber, float velocity) noexcept
+{
+    // must set the sample rate before using this!
+    jassert(sampleRate != 0);
+
+    if (stealPolicy != StealPolicy::samePitch)
+        for (int v = 0; v < numVoices; ++v)
+            if (note[(size_t) v] == midiNoteNumber && channel[(size_t) v] == midiChannel)
+                stopVoice(v, true);
+
+    startVoice(allocateVoice(midiChannel, midiNoteNumber), midiChannel, midiNoteNumber, velocity);
+}
+
+void SineBankSynth::noteOff(int midiChannel, int midiNoteNumber, bool allowTailOff) noexcept
+{
+    for (int v = 0; v < numVoices; ++v)
+    {
+        const auto i = (size_t) v;
+        if (note[i] != midiNoteNumber || channel[i] != midiChannel || ! keyDown[i])
+            continue;
+
+        if (sustainPedalDown[(size_t) midiChannel])
+        {
+            keyDown[i] = false;
+            sustained[i] = true;
+        }
+        else
+        {
+            stopVoice(v, allowTailOff);
+        }
+    }
+}
+
+void SineBankSynth::allNotesOff(int midiChannel, bool allowTailOff) noexcept
+{
+    for (int v = 0; v < numVoices; ++v)
+        if (note[(size_t) v] >= 0 && (midiChannel <= 0 || channel[(size_t) v] == midiChannel))
+            stopVoice(v, allowTailOff);
+
+    sustainPedalDown = {};
+}
+
+void SineBankSynth::handleSustainPedal(int midiChannel, bool isDown) noexcept
+{
+    sustainPedalDown[(size_t) midiChannel] = isDown;
+
+    if (isDown)
+        return;
+
+    for (int v = 0; v < numVoices; ++v)
+        if (sustained[(size_t) v] && channel[(size_t) v] == midiChannel)
+            stopVoice(v, true);
+}
+
+void SineBankSynth::handleMidiEvent(const MidiEvent& e) noexcept
+{
+    const int midiChannel = e.getChannel();
+
+    if (e.isNoteOn())
+    {
+        noteOn(midiChannel, e.getNoteNumber(), (float) e.getVelocity() / 127.0f);
+    }
+    else if (e.isNoteOff())
+    {
+        noteOff(midiChannel, e.getNoteNumber(), true);
+    }
+    else if ((e.status & 0xf0) == 0xb0)
+    {
+        if (e.data1 == 0x40)
+            handleSustainPedal(midiChannel, e.data2 >= 64);
+        else if (e.data1 == 120 || e.data1 == 123) // all sound off, all notes off
+            allNotesOff(midiChannel, true);
+    }
+}
+
+//==============================================================================
+void SineBankSynth::renderChunkToMono(int numSamples) noexcept
+{
+    std::fill(laneSums.begin(), laneSums.begin() + numSamples * lanes, 0.0f);
+
+    const int numGroups = (numVoices + lanes - 1) / lanes;
+
+    for (int g = 0; g < numGroups; ++g)
+    {
+        if (soundingInGroup[(size_t) g] == 0)
+            continue;
+
+        // Local copies, so the compiler can keep the lanes in registers
+        const auto first = (size_t) (g * lanes);
+        float ph[lanes], inc[lanes], lv[lanes], tl[lanes], mul[lanes];
+        std::copy_n(phase.data() + first, lanes, ph);
+        std::copy_n(increment.data() + first, lanes, inc);
+        std::copy_n(level.data() + first, lanes, lv);
+        std::copy_n(tail.data() + first, lanes, tl);
+        std::copy_n(tailMultiplier.data() + first, lanes, mul);
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            float* sums = laneSums.data() + n * lanes;
+
+            for (int l = 0; l < lanes; ++l)
+            {
+                sums[l] += sineOfPhase(ph[l]) * lv[l] * tl[l];
+                tl[l] *= mul[l];
+
+                ph[l] = advancePhase(ph[l], inc[l]);
+            }
+        }
+
+        std::copy_n(ph, lanes, phase.data() + first);
+        std::copy_n(tl, lanes, tail.data() + first);
+
+        // Free the voices whose tail-off passed the cutoff during this chunk
+        for (int l = 0; l < lanes; ++l)
+            if (note[first + (size_t) l] >= 0 && tl[l] <= tailOffCutoff)
+                clearVoice((int) first + l);
+    }
+
+    for (int n = 0; n < numSamples; ++n)
+    {
+        const float* sums = laneSums.data() + n * lanes;
+        float sum = 0.0f;
+        for (int l = 0; l < lanes; ++l)
+            sum += sums[l];
+        mono[(size_t) n] = sum;
+    }
+}
+
+void SineBankSynth::renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) noexcept
+{
+    if (getNumActiveVoices() == 0)
+        return;
+
+    while (numSamples > 0)
+    {
+        const int num = std::min(numSamples, renderChunk);
+        renderChunkToMono(num);
+
+        const int numChannels = outputAudio.getNumChannels();
+        for (int ch = 0; ch < numChannels; ++ch)
+            outputAudio.addFrom(ch, startSample, mono.data(), num, numChannels > 1 && ch < 2 ? channelGains[(size_t) ch] : 1.0f);
+
+        startSample += num;
+        numSamples -= num;
+    }
+}
+
+void SineBankSynth::renderNextBlock(juce::AudioBuffer<float>& outputAudio, MidiRouter::Merge events, int startSample, int numSamples) noexcept
+{
+    const int blockStart = startSample;
+    const int endSample = startSample + numSamples;
+    MidiEvent e;
+
+    while (events.next(e))
+    {
+        const int position = juce::jlimit(startSample, endSample, blockStart + e.sampleTime);
+
+        if (position > startSample)
+        {
+            renderVoices(outputAudio, startSample, position - startSample);
+            startSample = position;
+        }
+
+        handleMidiEvent(e);
+    }
+
+    if (startSample < endSample)
+        renderVoices(outputAudio, startSample, endSample - startSample);
+}
+
+void SineBankSynth::renderNextBlock(juce::AudioBuffer<float>& outputAudio, const juce::MidiBuffer& events, int startSample, int numSamples) noexcept
+{
+    const int blockStart = startSample;
+    const int endSample = startSample + numSamples;
+
+    for (const auto meta : events)
+    {
+        if (meta.numBytes > 3 || meta.numBytes < 1 || meta.data[0] < 0x80 || meta.data[0] >= 0xf0)
+            continue;
+
+        const int position = juce::jlimit(startSample, endSample, blockStart + meta.samplePosition);
+
+        if (position > startSample)
+        {
+            renderVoices(outputAudio, startSample, position - startSample);
+            startSample = position;
+        }
+
+        handleMidiEvent(MidiEvent::make(meta.samplePosition,
+                                        meta.data[0],
+                                        meta.numBytes > 1 ? meta.data[1] : std::uint8_t (0),
+                                        meta.numBytes > 2 ? meta.data[2] : std::uint8_t (0),
+                                        MidiEvent::host));
+    }
+
+    if (startSample < endSample)
+        renderVoices(outputAudio, startSample, endSample - startSample);
+}
@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+    SineBankSynth.h
+    Sine synth that renders all voices together from struct-of-arrays state.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MidiRouter.h"
+
+#include <array>
+#include <cstdint>
+
+/**
+ * @brief Polyphonic sine synth with the same sound as `SineWaveVoice`, rendered as one oscillator bank.
+ *
+ * Phase, increment, level and tail-off state of every voice live in contiguous arrays. Voices are
+ * processed in groups of `lanes` by a branch-free kernel that the compiler vectorises: the phase is
+ * wrapped to [0, 1), the sine is a polynomial, and the exponential tail-off is applied per lane as a
+ * multiplier (1 while the key is held). Voices are summed to mono once and then added to every
+ * output channel, with the pan applied to the first two. Groups without a sounding voice are skipped.
+ *
+ * Event handling follows `juce::Synthesiser`: a note that is already playing on the same channel is
+ * tailed off before it is retriggered and note-offs are held back while the sustain pedal is down.
+ *
+ * Voice storage is a fixed pool of maxVoices lanes inside the object, so nothing is allocated after
+ * construction. Free voices are tracked in a bitmap and allocated lowest-index first in constant time,
+ * which also keeps sounding voices packed into as few kernel groups as possible. The polyphony limit
+ * can be changed at any time without allocating. When every voice is busy, one is stolen according
+ * to the StealPolicy; every policy is deterministic, with ties going to the earliest note. Everything runs on the audio
+ * thread.
+ */
+class SineBankSynth
+{
+public:
+    static constexpr int lanes = 8;
+    static constexpr int maxVoices = 256;
+
+    /** Which voice to take over when a note starts and no voice is free. */
+    enum class StealPolicy
+    {
+        oldest,    // the earliest started voice, preferring voices whose key is already released
+        quietest,  // the voice with the lowest current amplitude
+        samePitch  // always restart a voice already playing this note on this channel in place; steal as oldest
+    };
+
+    SineBankSynth();
+
+    /** Number of voices that can sound at once, at most maxVoices. Sounding voices above the new limit are cut. */
+    void setNumVoices(int newNumVoices) noexcept;
+    int  getNumVoices() const noexcept          { return numVoices; }
+    int  getNumActiveVoices() const noexcept;
+
+    /** Cuts the quietest sounding voices until at most `maxActiveVoices` are left. */
+    void cullQuietestVoices(int maxActiveVoices) noexcept;
+
+    void        setStealPolicy(StealPolicy newPolicy) noexcept  { stealPolicy = newPolicy; }
+    StealPolicy getStealPolicy() const noexcept                  { return stealPolicy; }
+
+    /** Notes started and voices stolen since construction or the last resetStatistics(). */
+    std::uint64_t getNumNotesStarted() const noexcept  { return notesStarted; }
+    std::uint64_t getNumVoicesStolen() const noexcept  { return voicesStolen; }
+    void resetStatistics() noexcept                    { notesStarted = voicesStolen = 0; }
+
+    /** Stereo placement from -1 (left) to 1 (right), balance law: the centre leaves both channels at unity. */
+    void  setPan(float newPan) noexcept;
+    float getPan() const noexcept  { return pan; }
+
+    /** Gain of the left (0) or right (1) channel for a pan position, with the same law as setPan. */
+    static float getBalanceGain(float pan, int channel) noexcept
+    {
+        return juce::jmin(1.0f, channel == 0 ? 1.0f - pan : 1.0f + pan);
+    }
+
+    void   setCurrentPlaybackSampleRate(double newRate) noexcept  { sampleRate = newRate; }
+    double getSampleRate() const noexcept                         { return sampleRate; }
+
+    //==============================================================================
+    void noteOn(int midiChannel, int midiNoteNumber, float velocity) noexcept;
+    void noteOff(int midiChannel, int midiNoteNumber, bool allowTailOff) noexcept;
+    void allNotesOff(int midiChannel, bool allowTailOff) noexcept;
+    void handleSustainPedal(int midiChannel, bool isDown) noexcept;
+    void handleMidiEvent(const MidiEvent& e) noexcept;
+
+    //==============================================================================
+    /** Renders a block, handling events from the routing stage at their sample positions. */
+    void renderNextBlock(juce::AudioBuffer<float>& outputAudio, MidiRouter::Merge events, int startSample, int numSamples) noexcept;
+
+    /** Same as above for a host MidiBuffer. */
+    void renderNextBlock(juce::AudioBuffer<float>& outputAudio, const juce::MidiBuffer& events, int startSample, int numSamples) noexcept;
+
+    /** Renders the sounding voices without handling any events. */
+    void renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) noexcept;
+
+private:
+    static constexpr int renderChunk = 64;
+    static constexpr float tailOffPerSample = 0.99f;
+    static constexpr float tailOffCutoff = 0.005f;
+
+    int  findFreeVoice() const noexcept;
+    int  findVoiceToSteal() const noexcept;
+    int  allocateVoice(int midiChannel, int midiNoteNumber) noexcept;
+    void setFree(int v, bool isFree) noexcept;
+    void startVoice(int v, int midiChannel, int midiNoteNumber, float velocity) noexcept;
+    void stopVoice(int v, bool allowTailOff) noexcept;
+    void clearVoice(int v) noexcept;
+    void renderChunkToMono(int numSamples) noexcept;
+
+    // Oscillator state, one lane per voice
+    alignas(32) std::array<float, maxVoices> phase {};      // cycles, in [0, 1)
+    alignas(32) std::array<float, maxVoices> increment {};  // cycles per sample
+    alignas(32) std::array<float, maxVoices> level {};      // 0 for a free voice
+    alignas(32) std::array<float, maxVoices> tail {};       // 1 until the note is released
+    alignas(32) std::array<float, maxVoices> tailMultiplier {};
+
+    // Voice bookkeeping, only touched by events
+    std::array<std::int8_t, maxVoices>   note {};            // -1 when free
+    std::array<std::int8_t, maxVoices>   channel {};
+    std::array<bool, maxVoices>          keyDown {};
+    std::array<bool, maxVoices>          sustained {};
+    std::array<std::uint32_t, maxVoices> noteOnTime {};
+    std::array<int, maxVoices / lanes>   soundingInGroup {};
+    std::array<std::uint32_t, maxVoices / 32> freeVoices {}; // bit set for each free voice below numVoices
+
+    std::array<bool, 17> sustainPedalDown {};
+
+    alignas(32) std::array<float, renderChunk * lanes> laneSums {};
+    alignas(32) std::array<float, renderChunk> mono {};
+
+    double sampleRate = 0.0;
+    float pan = 0.0f;
+    std::array<float, 2> channelGains { 1.0f, 1.0f };
+    int numVoices = 0;
+    StealPolicy stealPolicy = StealPolicy::oldest;
+    std::uint32_t noteCounter = 0;
+    std::uint64_t notesStarted = 0, voicesStolen = 0;
+};
@@ -0,0 +1,276 @@
+/*
+  ==============================================================================
+
+    SpeculativeRenderer.cpp
+    Renders the prediction's audio ahead of time on a background thread.
+
+  ==============================================================================
+*/
+
+#include "SpeculativeRenderer.h"
+#include "Trace.h"
+
+#include <cmath>
+#include <thread>
+
+bool SpeculativeRenderer::Context::operator== (const Context& other) const noexcept
+{
+    return filter.transpose == other.filter.transpose
+        && filter.channel == other.filter.channel
+        && filter.mute == other.filter.mute
+        && pan == other.pan
+        && numVoices == other.numVoices
+        && stealPolicy == other.stealPolicy
+        && maxActiveVoices == other.maxActiveVoices
+        && numSamples == other.numSamples;
+}
+
+//==============================================================================
+SpeculativeRenderer::SpeculativeRenderer() : juce::Thread("MidiPredict speculative renderer")
+{
+}
+
+SpeculativeRenderer::~SpeculativeRenderer()
+{
+    release();
+}
+
+void SpeculativeRenderer::prepare(const SineBankSynth& engineToCopy, int numSlots, int numChannels, int maxBlockSize)
+{
+    release();
+
+    engine = engineToCopy;
+    correctionEngine = engineToCopy;
+    correction.setSize(numChannels, maxBlockSize);
+
+    for (int i = 0; i < juce::jmax(1, numSlots); ++i)
+    {
+        auto slot = std::make_unique<Slot>();
+        slot->events.reserve(MidiEvents::maxEventsPerBlock);
+        slot->audio.setSize(numChannels, maxBlockSize);
+        slots.push_back(std::move(slot));
+    }
+
+    engineOwner.store(nobody);
+    engineSequence.store(0);
+    pushSequence = popSequence = 0;
+    hits.store(0);
+    misses.store(0);
+    corrections.store(0);
+    lateBlocks.store(0);
+
+    startThread(juce::Thread::Priority::high);
+}
+
+void SpeculativeRenderer::release()
+{
+    stopThread(1000);
+    slots.clear();
+}
+
+//==============================================================================
+void SpeculativeRenderer::push(const MidiEventList& events, const Hypothesis& hypothesis, const Context& context) noexcept
+{
+    if (slots.empty())
+        return;
+
+    auto& slot = slotFor(pushSequence);
+    jassert(slot.state.load(std::memory_order_relaxed) == empty); // pop() the block due now first
+
+    slot.events = events; // within the reserved capacity
+    slot.hypothesis = hypothesis;
+    slot.context = context;
+    slot.sequence.store(pushSequence, std::memory_order_relaxed);
+    slot.state.store(queued, std::memory_order_release);
+    ++pushSequence;
+}
+
+void SpeculativeRenderer::pop(juce::AudioBuffer<float>& dest, const Hypothesis& current, const Context& context) noexcept
+{
+    const int numSamples = context.numSamples;
+    const int numChannels = juce::jmin(dest.getNumChannels(), correction.getNumChannels());
+
+    if (slots.empty() || popSequence == pushSequence)
+    {
+        dest.clear(0, numSamples);
+        return;
+    }
+
+    auto& slot = slotFor(popSequence);
+
+    if (numSamples > correction.getNumSamples())
+    {
+        // Larger than prepare() allowed for, so it cannot be played: drop it, but still consume it so that
+        // every later pop takes the block pushed for it. Unrendered, the engine skips its events.
+        lockEngine();
+        if (engineSequence.load(std::memory_order_relaxed) == popSequence)
+            engineSequence.store(popSequence + 1, std::memory_order_relaxed);
+        unlockEngine();
+
+        dest.clear(0, numSamples);
+        slot.state.store(empty, std::memory_order_relaxed);
+        ++popSequence;
+        return;
+    }
+
+    if (slot.state.load(std::memory_order_acquire) == queued)
+    {
+        // Not rendered yet, so the engine is still at the start of this block: render it here
+        lockEngine();
+
+        if (slot.state.load(std::memory_order_acquire) == queued)
+        {
+            renderSlot(engine, slot, context, dest);
+            engineSequence.store(popSequence + 1, std::memory_order_relaxed);
+
+            if (context != slot.context)
+                requeueAfter(popSequence, context);
+
+            lateBlocks.fetch_add(1, std::memory_order_relaxed);
+            unlockEngine();
+            slot.state.store(empty, std::memory_order_relaxed);
+            ++popSequence;
+            return;
+        }
+
+        // The background thread finished it while we waited
+        unlockEngine();
+    }
+
+    if (context == slot.context)
+    {
+        // The block's events are fixed, so a render now would be this one again, whatever the follower believes
+        for (int ch = 0; ch < numChannels; ++ch)
+            dest.copyFrom(ch, 0, slot.audio, ch, 0, numSamples);
+
+        if (holds(slot.hypothesis, current, numSamples))
+            hits.fetch_add(1, std::memory_order_relaxed);
+        else
+            misses.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        // Render the block again from where the engine stood before it, and fade over to that render
+        correctionEngine = slot.engineBefore;
+        renderSlot(correctionEngine, slot, context, correction);
+
+        // A block rendered for another block size has nothing to fade from
+        const bool fade = slot.context.numSamples == numSamples;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            if (fade)
+            {
+                dest.copyFrom(ch, 0, slot.audio, ch, 0, numSamples);
+                dest.applyGainRamp(ch, 0, numSamples, 1.0f, 0.0f);
+                dest.addFromWithRamp(ch, 0, correction.getReadPointer(ch), numSamples, 0.0f, 1.0f);
+            }
+            else
+            {
+                dest.copyFrom(ch, 0, correction, ch, 0, numSamples);
+            }
+        }
+
+        // The blocks rendered after this one used the old context; continue from the corrected state
+        lockEngine();
+        engine = correctionEngine;
+        engineSequence.store(popSequence + 1, std::memory_order_relaxed);
+        requeueAfter(popSequence, context);
+        unlockEngine();
+
+        corrections.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    slot.state.store(empty, std::memory_order_relaxed);
+    ++popSequence;
+}
+
+//==============================================================================
+void SpeculativeRenderer::run()
+{
+    while (! threadShouldExit())
+    {
+        if (! renderNext())
+            wait(1);
+    }
+}
+
+bool SpeculativeRenderer::renderNext()
+{
+    int expected = nobody;
+    if (! engineOwner.compare_exchange_strong(expected, backgroundThread, std::memory_order_acquire))
+        return false;
+
+    const auto sequence = engineSequence.load(std::memory_order_relaxed);
+    auto& slot = slotFor(sequence);
+    bool didRender = false;
+
+    if (slot.state.load(std::memory_order_acquire) == queued && slot.sequence.load(std::memory_order_relaxed) == sequence)
+    {
+        MP_TRACE_SCOPE("speculative render");
+        slot.engineBefore = engine;
+        renderSlot(engine, slot, slot.context, slot.audio);
+        engineSequence.store(sequence + 1, std::memory_order_relaxed);
+        slot.state.store(rendered, std::memory_order_release);
+        didRender = true;
+    }
+
+    engineOwner.store(nobody, std::memory_order_release);
+    return didRender;
+}
+
+void SpeculativeRenderer::lockEngine() noexcept
+{
+    // The background thread holds the engine for one block render at most
+    for (;;)
+    {
+        int expected = nobody;
+        if (engineOwner.compare_exchange_weak(expected, audioThread, std::memory_order_acquire))
+            return;
+
+        std::this_thread::yield();
+    }
+}
+
+void SpeculativeRenderer::requeueAfter(std::uint64_t sequence, const Context& context) noexcept
+{
+    for (auto s = sequence + 1; s < pushSequence; ++s)
+    {
+        auto& slot = slotFor(s);
+        slot.context = context;
+        slot.state.store(queued, std::memory_order_release);
+    }
+}
+
+void SpeculativeRenderer::renderSlot(SineBankSynth& synth, const Slot& slot, const Context& context,
+                                     juce::AudioBuffer<float>& dest) noexcept
+{
+    if (synth.getPan() != context.pan)
+        synth.setPan(context.pan);
+    if (synth.getNumVoices() != context.numVoices)
+        synth.setNumVoices(context.numVoices);
+    synth.setStealPolicy(context.stealPolicy);
+    if (context.maxActiveVoices > 0)
+        synth.cullQuietestVoices(context.maxActiveVoices);
+
+    MidiRouter feed;
+    feed.setSource(MidiRouter::prediction, slot.events);
+    feed.getFilter(MidiRouter::prediction) = context.filter;
+
+    dest.clear(0, context.numSamples);
+    synth.renderNextBlock(dest, feed.merge(MidiRouter::routeBit(MidiRouter::prediction)), 0, context.numSamples);
+}
+
+bool SpeculativeRenderer::holds(const Hypothesis& predicted, const Hypothesis& current, int numSamples) const noexcept
+{
+    if (predicted.paused != current.paused)
+        return false;
+
+    if (std::abs(current.tempoRatio - predicted.tempoRatio) > settings.tempoTolerance * predicted.tempoRatio)
+        return false;
+
+    // Where the cursor should be now if the follower kept the predicted tempo since the block was predicted
+    const double ahead = (double) slots.size() * numSamples;
+    const double expected = predicted.cursorSamples + (predicted.paused ? 0.0 : ahead * predicted.tempoRatio);
+    return std::abs(current.cursorSamples - expected) <= settings.tempoTolerance * ahead * predicted.tempoRatio + numSamples;
+}
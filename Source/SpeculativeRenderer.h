@@ -0,0 +1,176 @@
+/*
+  ==============================================================================
+
+    SpeculativeRenderer.h
+    Renders the prediction's audio ahead of time on a background thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MidiEvent.h"
+#include "MidiRouter.h"
+#include "SineBankSynth.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Renders each prediction block on a background thread as soon as it is predicted, so that the
+ * audio thread only copies it out when the block comes up `numSlots` blocks later.
+ *
+ * Each pushed block is tagged with the follower hypothesis it was predicted under (tempo ratio, score
+ * cursor, paused) and with the render context it will be rendered with (prediction route filter, pan,
+ * polyphony, steal policy, voice cull limit and block size). When the block is due, the audio thread
+ * checks both against the current state:
+ * - the render context holds: the pre-rendered audio is copied out, which is all the steady state costs.
+ *   The events of a pushed block never change, so rendering them again now would come out the same. If
+ *   the follower paused, resumed, jumped, or moved its tempo by more than `tempoTolerance` since the block
+ *   was predicted, the block only counts as a miss; the follower's revision shows in the blocks it
+ *   predicts from then on;
+ * - the render context changed: the engine is put back to the state it had before that block, the block
+ *   is rendered again just in time with the current context, and the output crossfades from the
+ *   pre-rendered audio to the fresh render over the block. Every later block is queued again to be
+ *   rendered with the new context;
+ * - the background thread has not got to the block yet: the audio thread renders it itself.
+ *
+ * The renderer owns its own SineBankSynth, copied from the engine it replaces at prepare(). The
+ * background thread and the audio thread never use it at the same time: whichever renders a block
+ * holds it for that block only. A correction renders on a second engine restored from the state saved
+ * with the block, and the background carries on from where that render left it. A block rendered on
+ * either thread comes out the same, sample for sample, as the just-in-time render would.
+ *
+ * Everything the audio thread touches is allocated in prepare().
+ */
+class SpeculativeRenderer : private juce::Thread
+{
+public:
+    /** What the follower believed when a block was predicted. */
+    struct Hypothesis
+    {
+        double tempoRatio = 1.0;  // score samples per output sample
+        int cursorSamples = 0;    // score position the block was read from
+        bool paused = false;
+    };
+
+    /** Everything besides the events that changes how a block sounds. */
+    struct Context
+    {
+        RouteFilter filter;
+        float pan = 0.0f;
+        int numVoices = 1;
+        SineBankSynth::StealPolicy stealPolicy = SineBankSynth::StealPolicy::oldest;
+        int maxActiveVoices = 0;  // voice cull limit, 0 for none
+        int numSamples = 0;
+
+        bool operator== (const Context& other) const noexcept;
+        bool operator!= (const Context& other) const noexcept  { return ! operator== (other); }
+    };
+
+    struct Settings
+    {
+        double tempoTolerance = 0.05;  // relative tempo change (and cursor drift) that still counts as the same hypothesis
+    };
+
+    SpeculativeRenderer();
+    ~SpeculativeRenderer() override;
+
+    void setSettings(const Settings& newSettings) noexcept  { settings = newSettings; }
+    const Settings& getSettings() const noexcept             { return settings; }
+
+    /**
+     * Allocates a ring of `numSlots` blocks, takes a copy of `engine` as the starting state and starts
+     * the background thread. Not real-time safe.
+     */
+    void prepare(const SineBankSynth& engine, int numSlots, int numChannels, int maxBlockSize);
+
+    /** Stops the background thread and drops every pending block. */
+    void release();
+
+    bool isPrepared() const noexcept  { return ! slots.empty(); }
+
+    /**
+     * Audio thread: queues a block that is due `numSlots` pops from now. Call pop() first in a block
+     * that does both, since the block being pushed reuses the slot being popped.
+     */
+    void push(const MidiEventList& events, const Hypothesis& hypothesis, const Context& context) noexcept;
+
+    /**
+     * Audio thread: writes the oldest pushed block to the start of `dest` (replacing its contents). A block
+     * larger than prepare()'s `maxBlockSize` comes out silent, and the pushed block is dropped.
+     */
+    void pop(juce::AudioBuffer<float>& dest, const Hypothesis& current, const Context& context) noexcept;
+
+    /**
+     * Blocks played from the background render under the hypothesis they were predicted with, played from it
+     * although the hypothesis no longer held, corrected just in time for a new context, and rendered late on
+     * the audio thread.
+     */
+    std::uint64_t getNumHits() const noexcept         { return hits.load(std::memory_order_relaxed); }
+    std::uint64_t getNumMisses() const noexcept       { return misses.load(std::memory_order_relaxed); }
+    std::uint64_t getNumCorrections() const noexcept  { return corrections.load(std::memory_order_relaxed); }
+    std::uint64_t getNumLateBlocks() const noexcept   { return lateBlocks.load(std::memory_order_relaxed); }
+
+private:
+    enum SlotState : int
+    {
+        empty = 0,
+        queued,
+        rendered
+    };
+
+    enum EngineOwner : int
+    {
+        nobody = 0,
+        backgroundThread,
+        audioThread
+    };
+
+    struct Slot
+    {
+        std::atomic<int> state { empty };
+        std::atomic<std::uint64_t> sequence { 0 };
+        MidiEventList events;
+        Hypothesis hypothesis;
+        Context context;
+        SineBankSynth engineBefore;  // engine state at the start of the block, for corrections
+        juce::AudioBuffer<float> audio;
+    };
+
+    void run() override;
+
+    /** Background thread: renders the next queued block if the engine is free. Returns true if it did. */
+    bool renderNext();
+
+    /** Acquires and releases the shared engine on the audio thread, waiting out a block the background is rendering. */
+    void lockEngine() noexcept;
+    void unlockEngine() noexcept  { engineOwner.store(nobody, std::memory_order_release); }
+
+    /** Marks every block pushed after `sequence` to be rendered again with `context`. Caller holds the engine. */
+    void requeueAfter(std::uint64_t sequence, const Context& context) noexcept;
+
+    /** Renders the events of `slot` with `context` from the current state of `synth` into `dest`, replacing it. */
+    static void renderSlot(SineBankSynth& synth, const Slot& slot, const Context& context, juce::AudioBuffer<float>& dest) noexcept;
+
+    bool holds(const Hypothesis& predicted, const Hypothesis& current, int numSamples) const noexcept;
+
+    Slot& slotFor(std::uint64_t sequence) noexcept  { return *slots[(size_t) (sequence % slots.size())]; }
+
+    Settings settings;
+    std::vector<std::unique_ptr<Slot>> slots;
+
+    SineBankSynth engine;                           // shared, see engineOwner
+    SineBankSynth correctionEngine;                 // audio thread only
+    juce::AudioBuffer<float> correction;            // just-in-time render, audio thread only
+
+    std::atomic<int> engineOwner { nobody };
+    std::atomic<std::uint64_t> engineSequence { 0 };  // the block the engine is positioned at the start of
+    std::uint64_t pushSequence = 0, popSequence = 0;  // audio thread only
+
+    std::atomic<std::uint64_t> hits { 0 }, misses { 0 }, corrections { 0 }, lateBlocks { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(SpeculativeRenderer)
+};
@@ -0,0 +1,543 @@
+/*
+  ==============================================================================
+
+    StreamingSampler.cpp
+    Sample-based piano voices that stream from disk, with prefetch driven by the prediction.
+
+  ==============================================================================
+*/
+
+#include "StreamingSampler.h"
+#include "Trace.h"
+
+class StreamingSampler::Sound : public juce::SynthesiserSound
+{
+public:
+    bool appliesToNote(int) override     { return true; }
+    bool appliesToChannel(int) override  { return true; }
+};
+
+//==============================================================================
+class StreamingSampler::Voice : public juce::SynthesiserVoice
+{
+public:
+    explicit Voice(StreamingSampler& samplerToUse) : sampler(samplerToUse)
+    {
+        envelopeParameters.attack = 0.002f;
+        envelopeParameters.decay = 0.0f;
+        envelopeParameters.sustain = 1.0f;
+        envelopeParameters.release = 0.25f;
+    }
+
+    bool canPlaySound(juce::SynthesiserSound* sound) override
+    {
+        return dynamic_cast<Sound*>(sound) != nullptr;
+    }
+
+    void startNote(int midiNoteNumber, float velocity, juce::SynthesiserSound*, int) override
+    {
+        releaseBuffers();
+
+        zoneIndex = sampler.findZone(midiNoteNumber, juce::jlimit(1, 127, juce::roundToInt(velocity * 127.0f)));
+        const auto& zone = *sampler.zones[(size_t) zoneIndex];
+
+        position = 0.0;
+        increment = std::pow(2.0, (midiNoteNumber - zone.rootNote) / 12.0) * zone.sourceRate / getSampleRate();
+
+        // Attack, then the cached body head if the prediction asked for it, then the stream
+        residentEnd = zone.attack.getNumSamples();
+        slot = sampler.pinPrefetchSlot(zoneIndex);
+        headEnd = residentEnd + (slot >= 0 ? sampler.prefetchSlots[(size_t) slot]->frames.getNumSamples() : 0);
+        stream = headEnd < zone.length ? sampler.claimStream(zoneIndex, headEnd) : nullptr;
+
+        adsr.setSampleRate(getSampleRate());
+        adsr.setParameters(envelopeParameters);
+        adsr.noteOn();
+
+        sampler.notesStarted.fetch_add(1, std::memory_order_relaxed);
+        if (slot >= 0)
+            sampler.prefetchHits.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void stopNote(float, bool allowTailOff) override
+    {
+        if (allowTailOff)
+            adsr.noteOff();
+        else
+            finish();
+    }
+
+    void pitchWheelMoved(int) override {}
+    void controllerMoved(int, int) override {}
+
+    void renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override
+    {
+        if (! isVoiceActive())
+            return;
+
+        const auto& zone = *sampler.zones[(size_t) zoneIndex];
+        const auto available = stream != nullptr ? stream->writeFrame.load(std::memory_order_acquire) : headEnd;
+
+        auto* left = outputBuffer.getWritePointer(0, startSample);
+        auto* right = outputBuffer.getNumChannels() > 1 ? outputBuffer.getWritePointer(1, startSample) : nullptr;
+        bool finished = false, starved = false;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto frame = (juce::int64) position;
+
+            if (frame + 1 >= zone.length)
+            {
+                finished = true;
+                break;
+            }
+
+            float l0, r0, l1, r1;
+            if (! readFrame(zone, frame, available, l0, r0) || ! readFrame(zone, frame + 1, available, l1, r1))
+            {
+                // Without a stream the note ends with its cached frames. Otherwise the reader is behind:
+                // hold the position and stay silent for the rest of the block.
+                finished = stream == nullptr;
+                starved = ! finished;
+                break;
+            }
+
+            const auto frac = (float) (position - (double) frame);
+            const auto gain = adsr.getNextSample() * outputGain;
+            const auto l = (l0 + frac * (l1 - l0)) * gain;
+            const auto r = (r0 + frac * (r1 - r0)) * gain;
+
+            if (right != nullptr)
+            {
+                left[i] += l;
+                right[i] += r;
+            }
+            else
+            {
+                left[i] += 0.5f * (l + r);
+            }
+
+            position += increment;
+        }
+
+        if (stream != nullptr)
+            stream->readFrame.store((juce::int64) position, std::memory_order_release);
+
+        if (starved)
+            sampler.underruns.fetch_add(1, std::memory_order_relaxed);
+
+        if (finished || ! adsr.isActive())
+            finish();
+    }
+
+private:
+    static constexpr float outputGain = 0.5f;
+
+    bool readFrame(const Zone& zone, juce::int64 frame, juce::int64 available, float& l, float& r) const noexcept
+    {
+        if (frame < residentEnd)
+        {
+            l = zone.attack.getSample(0, (int) frame);
+            r = zone.attack.getSample(1, (int) frame);
+            return true;
+        }
+
+        if (frame < headEnd)
+        {
+            const auto& head = sampler.prefetchSlots[(size_t) slot]->frames;
+            l = head.getSample(0, (int) (frame - residentEnd));
+            r = head.getSample(1, (int) (frame - residentEnd));
+            return true;
+        }
+
+        if (frame < available)
+        {
+            const auto index = (int) (frame & (juce::int64) (sampler.options.ringFrames - 1));
+            l = stream->ring.getSample(0, index);
+            r = stream->ring.getSample(1, index);
+            return true;
+        }
+
+        return false;
+    }
+
+    void finish()
+    {
+        adsr.reset();
+        releaseBuffers();
+        clearCurrentNote();
+    }
+
+    void releaseBuffers() noexcept
+    {
+        if (stream != nullptr)
+            stream->state.store(Stream::retiring, std::memory_order_release);
+        stream = nullptr;
+
+        if (slot >= 0)
+            sampler.unpinPrefetchSlot(slot);
+        slot = -1;
+    }
+
+    StreamingSampler& sampler;
+    juce::ADSR adsr;
+    juce::ADSR::Parameters envelopeParameters;
+
+    int zoneIndex = 0;
+    double position = 0.0, increment = 1.0;
+    juce::int64 residentEnd = 0, headEnd = 0;
+    int slot = -1;
+    Stream* stream = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE(Voice)
+};
+
+//==============================================================================
+class StreamingSampler::Reader : public juce::Thread
+{
+public:
+    explicit Reader(StreamingSampler& samplerToUse)
+        : juce::Thread("MidiPredict sample reader"), sampler(samplerToUse)
+    {
+    }
+
+    ~Reader() override
+    {
+        stopThread(1000);
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            const bool requestsServed = sampler.serviceRequests();
+            const bool streamsServed = sampler.serviceStreams();
+
+            if (! requestsServed && ! streamsServed)
+                wait(1);
+        }
+    }
+
+private:
+    StreamingSampler& sampler;
+};
+
+//==============================================================================
+StreamingSampler::StreamingSampler()
+{
+    formatManager.registerBasicFormats();
+}
+
+StreamingSampler::~StreamingSampler()
+{
+    stopStreaming();
+}
+
+int StreamingSampler::loadSampleSet(const juce::File& directory, const Options& newOptions)
+{
+    MP_TRACE_SCOPE("StreamingSampler::loadSampleSet");
+    stopStreaming();
+
+    const juce::ScopedLock sl(lock);
+
+    clearVoices();
+    clearSounds();
+    zones.clear();
+    prefetchSlots.clear();
+    streams.clear();
+
+    options = newOptions;
+    options.ringFrames = juce::nextPowerOfTwo(juce::jmax(4096, options.ringFrames));
+
+    for (const auto& file : directory.findChildFiles(juce::File::findFiles, false, "*.wav;*.aif;*.aiff"))
+    {
+        const auto tokens = juce::StringArray::fromTokens(file.getFileNameWithoutExtension(), "_", "");
+        if (tokens.size() != 2 || ! tokens[0].containsOnly("0123456789") || ! tokens[1].containsOnly("0123456789"))
+            continue;
+
+        auto zone = std::make_unique<Zone>();
+        zone->rootNote = juce::jlimit(0, 127, tokens[0].getIntValue());
+        zone->topVelocity = juce::jlimit(1, 127, tokens[1].getIntValue());
+
+        // Map the file if the format allows it, so the reader thread's reads are page faults, not syscalls
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped;
+        if (file.hasFileExtension("wav"))
+            mapped.reset(juce::WavAudioFormat().createMemoryMappedReader(file));
+        else
+            mapped.reset(juce::AiffAudioFormat().createMemoryMappedReader(file));
+
+        if (mapped != nullptr && mapped->mapEntireFile())
+            zone->reader = std::move(mapped);
+        else
+            zone->reader.reset(formatManager.createReaderFor(file));
+
+        if (zone->reader == nullptr || zone->reader->lengthInSamples < 2)
+            continue;
+
+        zone->sourceRate = zone->reader->sampleRate;
+        zone->length = zone->reader->lengthInSamples;
+
+        const auto attackFrames = (int) juce::jmin((juce::int64) options.residentFrames, zone->length);
+        zone->attack.setSize(2, attackFrames);
+        zone->reader->read(&zone->attack, 0, attackFrames, 0, true, true);
+
+        zones.push_back(std::move(zone));
+    }
+
+    if (zones.empty())
+        return 0;
+
+    std::sort(zones.begin(), zones.end(), [](const auto& a, const auto& b)
+    {
+        return a->rootNote != b->rootNote ? a->rootNote < b->rootNote : a->topVelocity < b->topVelocity;
+    });
+
+    // Nearest root for every note, then the softest layer of that root that reaches the velocity
+    zoneMap.assign(128 * 128, 0);
+    for (int note = 0; note < 128; ++note)
+    {
+        int bestRoot = zones.front()->rootNote;
+        for (const auto& zone : zones)
+            if (std::abs(zone->rootNote - note) < std::abs(bestRoot - note))
+                bestRoot = zone->rootNote;
+
+        for (int velocity = 0; velocity < 128; ++velocity)
+        {
+            int chosen = -1;
+            for (size_t z = 0; z < zones.size(); ++z)
+            {
+                if (zones[z]->rootNote != bestRoot)
+                    continue;
+
+                chosen = (int) z;
+                if (zones[z]->topVelocity >= velocity)
+                    break;
+            }
+
+            zoneMap[(size_t) (note * 128 + velocity)] = (short) chosen;
+        }
+    }
+
+    for (int i = 0; i < options.numPrefetchSlots; ++i)
+    {
+        prefetchSlots.push_back(std::make_unique<PrefetchSlot>());
+        prefetchSlots.back()->frames.setSize(2, options.prefetchFrames);
+    }
+
+    // Twice as many streams as voices: a retired stream stays out of use until the reader has let go of it
+    for (int i = 0; i < 2 * options.numVoices; ++i)
+    {
+        streams.push_back(std::make_unique<Stream>());
+        streams.back()->ring.setSize(2, options.ringFrames);
+    }
+
+    readChunk.setSize(2, 4096);
+    requestFifo.reset();
+
+    for (int i = 0; i < options.numVoices; ++i)
+        addVoice(new Voice(*this));
+    addSound(new Sound());
+
+    return (int) zones.size();
+}
+
+size_t StreamingSampler::getResidentBytes() const noexcept
+{
+    size_t frames = 0;
+
+    for (const auto& zone : zones)
+        frames += (size_t) zone->attack.getNumSamples();
+    for (const auto& slot : prefetchSlots)
+        frames += (size_t) slot->frames.getNumSamples();
+    for (const auto& stream : streams)
+        frames += (size_t) stream->ring.getNumSamples();
+
+    return frames * 2 * sizeof(float);
+}
+
+void StreamingSampler::startStreaming()
+{
+    if (reader == nullptr)
+        reader = std::make_unique<Reader>(*this);
+
+    if (isLoaded() && ! reader->isThreadRunning())
+        reader->startThread(juce::Thread::Priority::high);
+}
+
+void StreamingSampler::stopStreaming()
+{
+    if (reader != nullptr)
+        reader->stopThread(1000);
+}
+
+void StreamingSampler::prefetch(const MidiEventList& upcoming) noexcept
+{
+    if (! isLoaded())
+        return;
+
+    for (const auto& e : upcoming)
+    {
+        if (! e.isNoteOn())
+            continue;
+
+        if (requestFifo.getFreeSpace() == 0)
+            return;
+
+        const auto zone = findZone(e.data1, e.data2);
+        requestFifo.write(1).forEach([&](int index) { requestQueue[(size_t) index] = zone; });
+    }
+}
+
+int StreamingSampler::pinPrefetchSlot(int zone) noexcept
+{
+    const auto index = zones[(size_t) zone]->cachedSlot.load(std::memory_order_acquire);
+    if (index < 0)
+        return -1;
+
+    auto& slot = *prefetchSlots[(size_t) index];
+    auto pins = slot.pins.load(std::memory_order_relaxed);
+
+    do
+    {
+        if (pins < 0)
+            return -1; // being refilled for another zone
+    }
+    while (! slot.pins.compare_exchange_weak(pins, pins + 1, std::memory_order_acquire));
+
+    // The zone only changes while the slot is locked, so this cannot go stale after pinning
+    if (slot.zone.load(std::memory_order_relaxed) != zone)
+    {
+        unpinPrefetchSlot(index);
+        return -1;
+    }
+
+    return index;
+}
+
+void StreamingSampler::unpinPrefetchSlot(int slot) noexcept
+{
+    prefetchSlots[(size_t) slot]->pins.fetch_sub(1, std::memory_order_release);
+}
+
+StreamingSampler::Stream* StreamingSampler::claimStream(int zone, juce::int64 startFrame) noexcept
+{
+    // Note starts all come from event handling on one thread, so a plain check is enough here
+    for (auto& stream : streams)
+    {
+        if (stream->state.load(std::memory_order_acquire) != Stream::free)
+            continue;
+
+        stream->zone = zone;
+        stream->writeFrame.store(startFrame, std::memory_order_relaxed);
+        stream->readFrame.store(startFrame, std::memory_order_relaxed);
+        stream->state.store(Stream::streaming, std::memory_order_release);
+        return stream.get();
+    }
+
+    return nullptr;
+}
+
+bool StreamingSampler::serviceRequests()
+{
+    bool worked = false;
+
+    requestFifo.read(requestFifo.getNumReady()).forEach([&](int index)
+    {
+        const auto zoneIndex = requestQueue[(size_t) index];
+        auto& zone = *zones[(size_t) zoneIndex];
+        ++requestCounter;
+
+        const auto cached = zone.cachedSlot.load(std::memory_order_relaxed);
+        if (cached >= 0)
+        {
+            prefetchSlots[(size_t) cached]->lastRequested = requestCounter;
+            return;
+        }
+
+        if (zone.length <= zone.attack.getNumSamples())
+            return;
+
+        // Evict the unpinned slot that was requested longest ago
+        for (size_t attempt = 0; attempt < prefetchSlots.size(); ++attempt)
+        {
+            int victim = -1;
+            for (size_t s = 0; s < prefetchSlots.size(); ++s)
+                if (prefetchSlots[s]->pins.load(std::memory_order_relaxed) == 0
+                     && (victim < 0 || prefetchSlots[s]->lastRequested < prefetchSlots[(size_t) victim]->lastRequested))
+                    victim = (int) s;
+
+            if (victim < 0)
+                return; // every slot is playing
+
+            auto& slot = *prefetchSlots[(size_t) victim];
+            int unpinned = 0;
+            if (! slot.pins.compare_exchange_strong(unpinned, -1, std::memory_order_acquire))
+                continue;
+
+            const auto previous = slot.zone.load(std::memory_order_relaxed);
+            if (previous >= 0)
+                zones[(size_t) previous]->cachedSlot.store(-1, std::memory_order_relaxed);
+
+            const auto headFrames = (int) juce::jmin((juce::int64) options.prefetchFrames, zone.length - zone.attack.getNumSamples());
+            slot.frames.setSize(2, headFrames, false, false, true);
+            MP_TRACE_SCOPE("sample prefetch read");
+            zone.reader->read(&slot.frames, 0, headFrames, zone.attack.getNumSamples(), true, true);
+
+            slot.zone.store(zoneIndex, std::memory_order_relaxed);
+            slot.lastRequested = requestCounter;
+            slot.pins.store(0, std::memory_order_release);
+            zone.cachedSlot.store(victim, std::memory_order_release);
+            worked = true;
+            return;
+        }
+    });
+
+    return worked;
+}
+
+bool StreamingSampler::serviceStreams()
+{
+    bool worked = false;
+    const auto ringMask = (juce::int64) (options.ringFrames - 1);
+
+    // One chunk per stream per pass, so a long refill cannot starve the others
+    for (auto& stream : streams)
+    {
+        const auto state = stream->state.load(std::memory_order_acquire);
+
+        if (state == Stream::retiring)
+        {
+            stream->state.store(Stream::free, std::memory_order_release);
+            continue;
+        }
+
+        if (state != Stream::streaming)
+            continue;
+
+        auto& zone = *zones[(size_t) stream->zone];
+        const auto written = stream->writeFrame.load(std::memory_order_relaxed);
+        const auto limit = juce::jmin(stream->readFrame.load(std::memory_order_acquire) + options.ringFrames, zone.length);
+
+        if (written >= limit)
+            continue;
+
+        const auto numFrames = (int) juce::jmin(limit - written, (juce::int64) readChunk.getNumSamples());
+        MP_TRACE_SCOPE("sample stream read");
+        zone.reader->read(&readChunk, 0, numFrames, written, true, true);
+
+        const auto start = (int) (written & ringMask);
+        const auto firstPart = juce::jmin(numFrames, options.ringFrames - start);
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            stream->ring.copyFrom(ch, start, readChunk, ch, 0, firstPart);
+            if (firstPart < numFrames)
+                stream->ring.copyFrom(ch, 0, readChunk, ch, firstPart, numFrames - firstPart);
+        }
+
+        stream->writeFrame.store(written + numFrames, std::memory_order_release);
+        worked = true;
+    }
+
+    return worked;
+}
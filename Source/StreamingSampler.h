@@ -0,0 +1,155 @@
+/*
+  ==============================================================================
+
+    StreamingSampler.h
+    Sample-based piano voices that stream from disk, with prefetch driven by the prediction.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "EventSynthesiser.h"
+#include "MidiEvent.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief A sampler whose sample set lives on disk. Only bounded, preallocated parts of it are held in memory.
+ *
+ * A sample set is a directory of WAV or AIFF files named `<rootNote>_<topVelocity>`, for example
+ * `060_080.wav` for middle C up to velocity 80. Every note and velocity is mapped at load time to the
+ * nearest root and the softest layer that covers the velocity.
+ *
+ * Each zone is read from three places, in order:
+ * - the attack, the first `residentFrames` frames, which stays in memory for as long as the set is loaded;
+ * - the head of the body, up to `prefetchFrames` more frames, when a slot of the prefetch cache holds the zone;
+ * - the rest of the body, which a background reader streams from the memory-mapped file into the
+ *   voice's ring buffer.
+ *
+ * The prediction is known `lag` blocks before it sounds. prefetch() queues the zones of its notes, and the
+ * reader fills cache slots for them before they start. A predicted note then has attack plus head in
+ * memory, up to about a second, before it needs anything the reader streams after the note-on.
+ *
+ * Memory use is fixed at load time: one attack per zone, `numPrefetchSlots` heads and one ring per stream.
+ * The file data itself is only mapped, so the OS can page it out again.
+ */
+class StreamingSampler : public EventSynthesiser
+{
+public:
+    struct Options
+    {
+        int numVoices        = 32;
+        int residentFrames   = 16384;  // attack frames kept per zone
+        int prefetchFrames   = 32768;  // body frames per prefetch slot
+        int numPrefetchSlots = 64;
+        int ringFrames       = 32768;  // streamed frames buffered per voice; a power of two
+    };
+
+    StreamingSampler();
+    ~StreamingSampler() override;
+
+    /**
+     * Replaces the sample set with the one in `directory` and rebuilds voices and buffers. Stops the reader
+     * first, so call it off the audio thread while nothing is playing. Returns the number of zones found.
+     */
+    int loadSampleSet(const juce::File& directory, const Options& newOptions);
+    int loadSampleSet(const juce::File& directory)  { return loadSampleSet(directory, Options{}); }
+
+    bool isLoaded() const noexcept  { return ! zones.empty(); }
+
+    /** Memory held for samples: attacks, prefetch slots and stream rings. */
+    size_t getResidentBytes() const noexcept;
+
+    /** Starts and stops the background reader; call from prepareToPlay and releaseResources. */
+    void startStreaming();
+    void stopStreaming();
+
+    /**
+     * Queues the zones that the note-ons in `upcoming` will play, so the reader can cache them before
+     * they sound. Real-time safe. Requests are dropped if the queue is full.
+     */
+    void prefetch(const MidiEventList& upcoming) noexcept;
+
+    /** Blocks in which a voice needed frames that were not there yet, since load. */
+    std::uint64_t getNumUnderruns() const noexcept        { return underruns.load(std::memory_order_relaxed); }
+    /** Note starts that found their zone in the prefetch cache. */
+    std::uint64_t getNumPrefetchHits() const noexcept     { return prefetchHits.load(std::memory_order_relaxed); }
+    std::uint64_t getNumNotesStarted() const noexcept     { return notesStarted.load(std::memory_order_relaxed); }
+
+private:
+    class Sound;
+    class Voice;
+    class Reader;
+
+    struct Zone
+    {
+        int rootNote = 60;
+        int topVelocity = 127;
+        double sourceRate = 44100.0;
+        juce::int64 length = 0;
+        juce::AudioBuffer<float> attack;
+        std::unique_ptr<juce::AudioFormatReader> reader; // used by the reader thread only
+        std::atomic<int> cachedSlot { -1 };              // prefetch slot holding this zone's head, or -1
+    };
+
+    /** Body head of one zone. `pins` is -1 while the reader refills the slot, else the number of voices using it. */
+    struct PrefetchSlot
+    {
+        std::atomic<int> zone { -1 };
+        std::atomic<int> pins { 0 };
+        std::uint32_t lastRequested = 0; // reader thread only
+        juce::AudioBuffer<float> frames;
+    };
+
+    /**
+     * Ring buffer that the reader fills with one voice's body. A voice claims a free stream at note start
+     * and retires it at note end. Only the reader frees a retired stream, so a fill can never land in a
+     * stream that already belongs to the next note.
+     */
+    struct Stream
+    {
+        enum State : int { free = 0, streaming, retiring };
+
+        std::atomic<int> state { free };
+        int zone = -1;
+        std::atomic<juce::int64> writeFrame { 0 };  // frames before this are in the ring (reader releases)
+        std::atomic<juce::int64> readFrame { 0 };   // frames before this are no longer needed (voice releases)
+        juce::AudioBuffer<float> ring;
+    };
+
+    int findZone(int noteNumber, int velocity) const noexcept  { return zoneMap[(size_t) (noteNumber * 128 + velocity)]; }
+
+    /** Pins the cached head of `zone` for a starting voice; returns the slot or -1. */
+    int pinPrefetchSlot(int zone) noexcept;
+    void unpinPrefetchSlot(int slot) noexcept;
+
+    Stream* claimStream(int zone, juce::int64 startFrame) noexcept;
+
+    /** Reader thread: serves prefetch requests, then tops up the stream rings. Returns true if it did any work. */
+    bool serviceRequests();
+    bool serviceStreams();
+
+    Options options;
+    std::vector<std::unique_ptr<Zone>> zones;
+    std::vector<short> zoneMap;                      // note * 128 + velocity -> zone
+    std::vector<std::unique_ptr<PrefetchSlot>> prefetchSlots;
+    std::vector<std::unique_ptr<Stream>> streams;
+
+    // Single producer (audio thread), single consumer (reader)
+    static constexpr int requestQueueSize = 512;
+    juce::AbstractFifo requestFifo { requestQueueSize };
+    std::array<int, requestQueueSize> requestQueue {};
+    std::uint32_t requestCounter = 0;
+
+    juce::AudioFormatManager formatManager;
+    juce::AudioBuffer<float> readChunk;              // reader thread scratch
+    std::unique_ptr<Reader> reader;
+
+    std::atomic<std::uint64_t> underruns { 0 }, prefetchHits { 0 }, notesStarted { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(StreamingSampler)
+};
@@ -10,41 +10,200 @@
 
 #include <JuceHeader.h>
 //#include "SineWaveSound.cpp"
-#include "SineWaveVoice.cpp"
+#include "SineBankSynth.h"
+#include "FoleysSynth.h"
+#include "RenderPool.h"
+#include "RenderWorker.h"
+#include "SpeculativeRenderer.h"
+#include "StreamingSampler.h"
 
+/**
+ * Two independent engines: one plays the prediction, the other the live performance (and host input).
+ * Each keeps its own note state, so a predicted note-off cannot cut the live note of the same pitch,
+ * and each has its own stereo placement. The prediction can be played by a sine bank, by a
+ * FoleysSynth with additive partials or by a disk-streaming piano sampler. In parallel mode the prediction engine renders on a
+ * RenderWorker while the calling thread renders the live engine; the two are summed at the end.
+ * The FoleysSynth can additionally spread its voices over a RenderPool, and the sine bank can render
+ * the prediction ahead of time on a SpeculativeRenderer.
+ */
 class SynthAudioSource   : public juce::AudioSource
 {
 public:
+    enum class Engine
+    {
+        prediction,
+        live
+    };
+
     SynthAudioSource (juce::MidiKeyboardState& keyState)
         : keyboardState (keyState)
     {
-        for (auto i = 0; i < 4; ++i)                // [1]
-            synth.addVoice (new SineWaveVoice());
- 
-        synth.addSound (new SineWaveSound());       // [2]
+        initialiseEngines();                        // [1]
     }
     
     SynthAudioSource ()
         : keyboardState (initialMidiKeyboardState)
     {
-        for (auto i = 0; i < 4; ++i)                // [1]
-            synth.addVoice (new SineWaveVoice());
- 
-        synth.addSound (new SineWaveSound());       // [2]
+        initialiseEngines();                        // [1]
     }
- 
-    void setUsingSineWaveSound()
+
+    /** An engine's voice pool; polyphony, steal policy and pan can be changed from the audio thread at any time. */
+    SineBankSynth& getSynth (Engine engine)
+    {
+        return engine == Engine::prediction ? predictionSynth : liveSynth;
+    }
+
+    /**
+     * Plays the prediction on a FoleysSynth (additive partials with ADSR) instead of the sine bank.
+     * Call before prepareToPlay; `state` must hold the FoleysSynth parameters and outlive this object.
+     */
+    void setUsingFoleysSynthForPrediction (juce::AudioProcessorValueTreeState& state, int numVoices = defaultFoleysVoices)
+    {
+        // Voices hold no parameters or tables of their own, so a large pool is cheap to build
+        foleysSynth.clearVoices();
+        for (int i = 0; i < numVoices; ++i)
+            foleysSynth.addVoice (new FoleysSynth::FoleysVoice());
+
+        foleysSynth.clearSounds();
+        foleysSound = new FoleysSynth::FoleysSound (state);
+        foleysSynth.addSound (foleysSound);
+        predictionVoice = PredictionVoice::foleys;
+    }
+
+    /**
+     * Plays the prediction on a StreamingSampler loaded from `directory` (see StreamingSampler for the
+     * layout). Call before prepareToPlay. Returns false, and keeps the current voice, if no samples were found.
+     */
+    bool setUsingSamplerForPrediction (const juce::File& directory)
+    {
+        if (sampler.loadSampleSet (directory) == 0)
+            return false;
+
+        predictionVoice = PredictionVoice::sampler;
+        return true;
+    }
+
+    /** Lets the sampler start reading the notes of a new prediction block before it sounds; real-time safe. */
+    void prefetchPrediction (const MidiEventList& upcoming) noexcept
+    {
+        if (predictionVoice == PredictionVoice::sampler)
+            sampler.prefetch (upcoming);
+    }
+
+    /**
+     * Renders the FoleysSynth voices on `numWorkers` extra threads besides the one rendering the
+     * prediction; 0 (the default) renders them serially. Call before prepareToPlay.
+     */
+    void setVoiceRenderThreads (int numWorkers)
+    {
+        foleysSynth.setRenderPool (nullptr, 0, 0);
+        voicePool.reset (numWorkers > 0 ? new RenderPool (numWorkers) : nullptr);
+    }
+
+    /**
+     * Synthesis fallbacks under CPU pressure, applied from the audio thread before rendering: FoleysSynth
+     * voices render half their partials, and each engine keeps at most `maxActiveVoices` sounding (0 keeps
+     * them all).
+     */
+    void setDegradation (bool reducePartials, int maxActiveVoices)
+    {
+        if (foleysSound != nullptr)
+            foleysSound->setMaxPartials (reducePartials ? PartialBank::maxPartials / 2 : PartialBank::maxPartials);
+
+        cullLimit = maxActiveVoices;
+
+        if (maxActiveVoices > 0)
+        {
+            predictionSynth.cullQuietestVoices (maxActiveVoices);
+            liveSynth.cullQuietestVoices (maxActiveVoices);
+            if (predictionVoice == PredictionVoice::foleys)
+                foleysSynth.cullQuietestVoices (maxActiveVoices);
+        }
+    }
+
+    /**
+     * Renders the sine bank's prediction up to `aheadBlocks` blocks ahead on a background thread; the audio
+     * thread then copies each block out unless the follower or the render context moved since it was
+     * predicted (see SpeculativeRenderer). 0 (the default) renders just in time. Takes effect at the next
+     * prepareToPlay, and only while the sine bank plays the prediction; its note statistics then stay at zero.
+     */
+    void setSpeculativeRender (int aheadBlocks)
     {
-        synth.clearSounds();
+        speculationBlocks = juce::jmax (0, aheadBlocks);
+    }
+
+    bool isRenderingSpeculatively() const noexcept
+    {
+        return speculation.isPrepared();
+    }
+
+    /** Hits, misses, corrections and late blocks of the speculative prediction render. */
+    const SpeculativeRenderer& getSpeculativeRenderer() const noexcept
+    {
+        return speculation;
+    }
+
+    /** What the follower believes in the coming block; checked against the hypothesis each pre-rendered block was made under. */
+    void setFollowerHypothesis (const SpeculativeRenderer::Hypothesis& hypothesis) noexcept
+    {
+        followerHypothesis = hypothesis;
+    }
+
+    /**
+     * Hands a newly predicted block to the speculative renderer, call after the block that plays the
+     * slot it replaces has been rendered. Does nothing unless rendering speculatively. Real-time safe.
+     */
+    void speculatePrediction (const MidiEventList& predicted, const SpeculativeRenderer::Hypothesis& hypothesis,
+                              const RouteFilter& predictionFilter, int numSamples) noexcept
+    {
+        if (speculation.isPrepared())
+            speculation.push (predicted, hypothesis, getPredictionContext (predictionFilter, numSamples));
+    }
+
+    /**
+     * Renders the two engines on two threads (the default) or one after the other on the calling thread,
+     * without starting the worker. Call before prepareToPlay.
+     */
+    void setParallelRender (bool shouldRenderInParallel)
+    {
+        parallelRender = shouldRenderInParallel;
     }
  
-    void prepareToPlay (int /*samplesPerBlockExpected*/, double sampleRate) override
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override
     {
-        synth.setCurrentPlaybackSampleRate (sampleRate); // [3]
+        predictionSynth.setCurrentPlaybackSampleRate (sampleRate); // [3]
+        liveSynth.setCurrentPlaybackSampleRate (sampleRate);
+        foleysSynth.setCurrentPlaybackSampleRate (sampleRate);
+        sampler.setCurrentPlaybackSampleRate (sampleRate);
         midiCollector.reset (sampleRate); // [10]
+
+        predictionBuffer.setSize (2, samplesPerBlockExpected);
+        if (parallelRender)
+            worker.start();
+
+        foleysSynth.setRenderPool (voicePool.get(), 2, samplesPerBlockExpected);
+        if (voicePool != nullptr)
+            voicePool->start();
+
+        if (predictionVoice == PredictionVoice::sampler)
+            sampler.startStreaming();
+
+        if (speculationBlocks > 0 && predictionVoice == PredictionVoice::sineBank)
+            speculation.prepare (predictionSynth, speculationBlocks, 2, samplesPerBlockExpected);
+        else
+            speculation.release();
     }
  
-    void releaseResources() override {}
+    void releaseResources() override
+    {
+        worker.stop();
+
+        if (voicePool != nullptr)
+            voicePool->stop();
+
+        sampler.stopStreaming();
+        speculation.release();
+    }
  
     void getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill) override
     {
@@ -54,11 +213,11 @@ public:
         keyboardState.processNextMidiBuffer (incomingMidi, bufferToFill.startSample,
                                              bufferToFill.numSamples, true);       // [4]
  
-        synth.renderNextBlock (*bufferToFill.buffer, incomingMidi,
-                               bufferToFill.startSample, bufferToFill.numSamples); // [5]
+        liveSynth.renderNextBlock (*bufferToFill.buffer, incomingMidi,
+                                   bufferToFill.startSample, bufferToFill.numSamples); // [5]
     }
 
-    void getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill, juce::MidiBuffer incomingMidi)
+    void getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill, const juce::MidiBuffer& incomingMidi)
     {
         bufferToFill.clearActiveBufferRegion();
 
@@ -66,8 +225,46 @@ public:
 //        keyboardState.processNextMidiBuffer (incomingMidi, bufferToFill.startSample,
 //                                             bufferToFill.numSamples, true);       // [4]
 
-        synth.renderNextBlock (*bufferToFill.buffer, incomingMidi,
-                               bufferToFill.startSample, bufferToFill.numSamples); // [5]
+        liveSynth.renderNextBlock (*bufferToFill.buffer, incomingMidi,
+                                   bufferToFill.startSample, bufferToFill.numSamples); // [5]
+    }
+
+    /** Renders straight from the routing stage: the prediction route to one engine, live and host to the other. */
+    void getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill, const MidiRouter& router)
+    {
+        bufferToFill.clearActiveBufferRegion();
+
+        auto& output = *bufferToFill.buffer;
+        const auto liveEvents = router.merge (MidiRouter::routeBit (MidiRouter::live) | MidiRouter::routeBit (MidiRouter::host));
+        pendingPrediction = router.merge (MidiRouter::routeBit (MidiRouter::prediction));
+        pendingFilter = router.getFilter (MidiRouter::prediction);
+        pendingNumSamples = bufferToFill.numSamples;
+
+        // Only allocates if the host sends a larger block than announced in prepareToPlay
+        predictionBuffer.setSize (output.getNumChannels(), bufferToFill.numSamples, false, false, true);
+
+        if (parallelRender)
+        {
+            worker.runInParallel (renderPrediction, this, [&]
+            {
+                liveSynth.renderNextBlock (output, liveEvents, bufferToFill.startSample, bufferToFill.numSamples);
+            });
+        }
+        else
+        {
+            renderPrediction (this);
+            liveSynth.renderNextBlock (output, liveEvents, bufferToFill.startSample, bufferToFill.numSamples);
+        }
+
+        // Sum in a fixed order, so the result does not depend on which thread finished first.
+        // The sine bank pans itself; the other voices render centred and take the prediction pan here.
+        const int numChannels = output.getNumChannels();
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto gain = predictionVoice != PredictionVoice::sineBank && numChannels > 1 && ch < 2
+                                ? SineBankSynth::getBalanceGain (predictionSynth.getPan(), ch) : 1.0f;
+            output.addFrom (ch, bufferToFill.startSample, predictionBuffer, ch, 0, bufferToFill.numSamples, gain);
+        }
     }
     
     juce::MidiMessageCollector* getMidiCollector()
@@ -76,10 +273,84 @@ public:
     }
  
 private:
+    static constexpr int defaultPolyphony = 64;
+    static constexpr int defaultFoleysVoices = 32;
+
+    void initialiseEngines()
+    {
+        predictionSynth.setNumVoices (defaultPolyphony);
+        liveSynth.setNumVoices (defaultPolyphony);
+        predictionSynth.setPan (-0.5f);
+        liveSynth.setPan (0.5f);
+    }
+
+    /** The prediction engine's settings as the speculative renderer sees them; predictionSynth holds them while it does not render. */
+    SpeculativeRenderer::Context getPredictionContext (const RouteFilter& filter, int numSamples) const noexcept
+    {
+        SpeculativeRenderer::Context context;
+        context.filter = filter;
+        context.pan = predictionSynth.getPan();
+        context.numVoices = predictionSynth.getNumVoices();
+        context.stealPolicy = predictionSynth.getStealPolicy();
+        context.maxActiveVoices = cullLimit;
+        context.numSamples = numSamples;
+        return context;
+    }
+
+    static void renderPrediction (void* context)
+    {
+        auto& self = *static_cast<SynthAudioSource*> (context);
+        self.predictionBuffer.clear (0, self.pendingNumSamples);
+
+        switch (self.predictionVoice)
+        {
+            case PredictionVoice::foleys:
+                self.foleysSynth.renderNextBlock (self.predictionBuffer, self.pendingPrediction, 0, self.pendingNumSamples);
+                break;
+            case PredictionVoice::sampler:
+                self.sampler.renderNextBlock (self.predictionBuffer, self.pendingPrediction, 0, self.pendingNumSamples);
+                break;
+            case PredictionVoice::sineBank:
+                if (self.speculation.isPrepared())
+                {
+                    self.speculation.pop (self.predictionBuffer, self.followerHypothesis,
+                                          self.getPredictionContext (self.pendingFilter, self.pendingNumSamples));
+                    break;
+                }
+
+                self.predictionSynth.renderNextBlock (self.predictionBuffer, self.pendingPrediction, 0, self.pendingNumSamples);
+                break;
+        }
+    }
+
     juce::MidiKeyboardState initialMidiKeyboardState;
     juce::MidiKeyboardState& keyboardState;
-    juce::Synthesiser synth;
+    SineBankSynth predictionSynth, liveSynth;
+    FoleysSynth foleysSynth;
+    FoleysSynth::FoleysSound* foleysSound = nullptr; // owned by foleysSynth
+    StreamingSampler sampler;
+
+    enum class PredictionVoice
+    {
+        sineBank,
+        foleys,
+        sampler
+    };
+
+    PredictionVoice predictionVoice = PredictionVoice::sineBank;
     juce::MidiMessageCollector midiCollector;
+
+    RenderWorker worker;
+    std::unique_ptr<RenderPool> voicePool;
+    SpeculativeRenderer speculation;
+    SpeculativeRenderer::Hypothesis followerHypothesis;
+    int speculationBlocks = 0;
+    int cullLimit = 0;
+    bool parallelRender = true;
+    juce::AudioBuffer<float> predictionBuffer;
+    MidiRouter::Merge pendingPrediction;
+    RouteFilter pendingFilter;
+    int pendingNumSamples = 0;
 };
 
 
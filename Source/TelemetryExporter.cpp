@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    TelemetryExporter.cpp
+    Writes the prediction telemetry to a file from a background thread.
+
+  ==============================================================================
+*/
+
+#include "TelemetryExporter.h"
+
+namespace
+{
+    const char* getKindName(std::uint8_t outcome)
+    {
+        switch (outcome)
+        {
+            case PredictionTelemetry::hit:     return "hit";
+            case PredictionTelemetry::missing: return "missing";
+            case PredictionTelemetry::extra:   return "extra";
+            default:                           return "pause";
+        }
+    }
+}
+
+TelemetryExporter::TelemetryExporter(PredictionTelemetry& source, const juce::File& fileToWrite, int interval)
+    : juce::Thread("Telemetry exporter"),
+      telemetry(source),
+      file(fileToWrite),
+      intervalMs(juce::jmax(10, interval)),
+      binary(! fileToWrite.hasFileExtension("csv"))
+{
+}
+
+TelemetryExporter::~TelemetryExporter()
+{
+    stopThread(2000);
+}
+
+bool TelemetryExporter::start()
+{
+    if (stream != nullptr || ! file.getParentDirectory().createDirectory().wasOk())
+        return false;
+
+    stream = std::make_unique<juce::FileOutputStream>(file);
+    if (! stream->openedOk() || ! stream->setPosition(0) || stream->truncate().failed())
+    {
+        stream.reset();
+        return false;
+    }
+
+    if (binary)
+    {
+        stream->write("MPTL", 4);
+        stream->writeInt(1);
+        stream->writeDouble(telemetry.getSampleRate());
+    }
+    else
+    {
+        *stream << "kind,seconds,note,error_ms,mean_error_ms,mean_abs_error_ms,p95_abs_error_ms,hit_rate,missing_rate,extra_rate,pauses\n";
+    }
+
+    startThread();
+    return true;
+}
+
+void TelemetryExporter::run()
+{
+    while (! threadShouldExit())
+    {
+        wait(intervalMs);
+        drain();
+        if (! binary)
+            writeSummary();
+        stream->flush();
+    }
+
+    drain();
+    stream->flush();
+}
+
+void TelemetryExporter::drain()
+{
+    const auto sampleRate = telemetry.getSampleRate();
+
+    for (int n; (n = telemetry.readRecords(records.data(), (int) records.size())) > 0;)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            const auto& r = records[(size_t) i];
+
+            if (binary)
+            {
+                stream->writeInt64(r.sample);
+                stream->writeFloat(r.errorMs);
+                stream->writeByte((char) r.noteNumber);
+                stream->writeByte((char) r.outcome);
+            }
+            else
+            {
+                *stream << getKindName(r.outcome) << "," << juce::String((double) r.sample / sampleRate, 4) << ","
+                        << (r.outcome == PredictionTelemetry::pause ? juce::String() : juce::String(r.noteNumber)) << ","
+                        << (r.outcome == PredictionTelemetry::hit ? juce::String(r.errorMs, 2) : juce::String())
+                        << ",,,,,,,\n";
+            }
+        }
+    }
+}
+
+void TelemetryExporter::writeSummary()
+{
+    const auto stats = telemetry.getStats();
+
+    *stream << "summary," << juce::String(telemetry.getPositionSeconds(), 4) << ",,,"
+            << juce::String(stats.meanErrorMs, 2) << "," << juce::String(stats.meanAbsErrorMs, 2) << ","
+            << juce::String(stats.p95AbsErrorMs, 2) << "," << juce::String(stats.hitRate, 4) << ","
+            << juce::String(stats.missingRate, 4) << "," << juce::String(stats.extraRate, 4) << ","
+            << juce::String((juce::int64) stats.pauses) << "\n";
+}
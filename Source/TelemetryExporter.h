@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    TelemetryExporter.h
+    Writes the prediction telemetry to a file from a background thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PredictionTelemetry.h"
+
+/**
+ * @brief Drains a PredictionTelemetry's records to a file, and adds a summary of its rolling statistics
+ * every `intervalMs`, until it is destroyed.
+ *
+ * Files ending in .csv get one row per record:
+ *     kind,seconds,note,error_ms,mean_error_ms,mean_abs_error_ms,p95_abs_error_ms,hit_rate,missing_rate,extra_rate,pauses
+ * where kind is hit, missing, extra, pause or summary, and each row fills only the columns of its kind.
+ *
+ * Any other file gets the records in binary, little-endian: the magic "MPTL", a version (int32, 1) and
+ * the sample rate (double), then per record the sample (int64), the error in ms (float), the note and
+ * the kind (one byte each, kinds numbered as PredictionTelemetry::Outcome). Summaries are left out, as
+ * they follow from the records.
+ *
+ * The audio thread is never blocked: if the writer falls behind, the telemetry drops records and counts them.
+ */
+class TelemetryExporter  : private juce::Thread
+{
+public:
+    TelemetryExporter(PredictionTelemetry& telemetry, const juce::File& file, int intervalMs = 1000);
+    ~TelemetryExporter() override;
+
+    /** Opens the file, replacing it, and starts writing; false if it cannot be opened. */
+    bool start();
+
+    const juce::File& getFile() const noexcept  { return file; }
+
+private:
+    void run() override;
+    void drain();
+    void writeSummary();
+
+    PredictionTelemetry& telemetry;
+    const juce::File file;
+    const int intervalMs;
+    const bool binary;
+    std::unique_ptr<juce::FileOutputStream> stream;
+    std::array<PredictionTelemetry::Record, 512> records;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TelemetryExporter)
+};
@@ -0,0 +1,344 @@
+/*
+  ==============================================================================
+
+    Trace.cpp
+    Span and counter tracing into per-thread rings, written out as a Chrome/Perfetto JSON trace.
+
+  ==============================================================================
+*/
+
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if MIDIPREDICT_TRACING
+
+namespace Trace
+{
+    namespace
+    {
+        constexpr int maxThreads = 16;
+        constexpr int drainIntervalMs = 50;
+
+        std::atomic<int> numReady { 0 };
+        int getNumReady() noexcept  { return numReady.load(std::memory_order_acquire); }
+
+        /** Writes the rings out to the trace file until stopped. */
+        class Writer  : public juce::Thread
+        {
+        public:
+            Writer(std::unique_ptr<juce::FileOutputStream> output, ThreadBuffer* threadBuffers)
+                : juce::Thread("Trace writer"),
+                  stream(std::move(output)),
+                  buffers(threadBuffers),
+                  startTicks(juce::Time::getHighResolutionTicks()),
+                  microsecondsPerTick(1.0e6 / (double) juce::Time::getHighResolutionTicksPerSecond())
+            {
+                *stream << "{\"traceEvents\":[\n"
+                        << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"MidiPredict\"}}";
+            }
+
+            void run() override
+            {
+                while (! threadShouldExit())
+                {
+                    wait(drainIntervalMs);
+                    drain();
+                    stream->flush();
+                }
+            }
+
+            /** Called once the thread has stopped: writes the rest, closes open spans and the file. */
+            void finish()
+            {
+                drain();
+
+                const auto numBuffers = getNumReady();
+
+                const auto endTicks = juce::Time::getHighResolutionTicks();
+                std::uint64_t dropped = 0;
+
+                for (int i = 0; i < numBuffers; ++i)
+                {
+                    auto& buffer = buffers[i];
+
+                    closeOpenSpans(i, endTicks);
+
+                    *stream << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.id
+                            << ",\"args\":{\"name\":";
+                    writeString(buffer.getName());
+                    *stream << "}}";
+
+                    dropped += buffer.dropped.load(std::memory_order_relaxed);
+                }
+
+                *stream << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":\""
+                        << juce::String((juce::int64) dropped) << "\"}}\n";
+                stream->flush();
+            }
+
+        private:
+            void drain()
+            {
+                const auto n = getNumReady();
+
+                for (int i = 0; i < n; ++i)
+                {
+                    for (int count; (count = buffers[i].pop(events.data(), (int) events.size())) > 0;)
+                    {
+                        for (int j = 0; j < count; ++j)
+                            writeEvent(buffers[i], events[(size_t) j], &openSpans[(size_t) i]);
+
+                        lastTicks[(size_t) i] = events[(size_t) count - 1].ticks;
+                    }
+
+                    // Events were lost since the last drain, ends among them perhaps: no span open now can
+                    // be trusted to end, so close them all where the thread's record breaks off
+                    const auto dropped = buffers[i].dropped.load(std::memory_order_relaxed);
+                    if (dropped != seenDrops[(size_t) i])
+                    {
+                        seenDrops[(size_t) i] = dropped;
+                        closeOpenSpans(i, lastTicks[(size_t) i]);
+                    }
+                }
+            }
+
+            void closeOpenSpans(int thread, juce::int64 ticks)
+            {
+                for (auto& open = openSpans[(size_t) thread]; ! open.empty(); open.pop_back())
+                    writeEvent(buffers[thread], { open.back(), ticks, 0.0, Phase::end });
+            }
+
+            /**
+             * An end closes the innermost open span of its name, and any opened inside it whose ends were
+             * lost. An end with no such span (its begin was lost) is skipped, so it cannot close a parent.
+             */
+            void writeEvent(const ThreadBuffer& buffer, const Event& event, std::vector<const char*>* open = nullptr)
+            {
+                if (open != nullptr)
+                {
+                    if (event.phase == Phase::begin)
+                    {
+                        open->push_back(event.name);
+                    }
+                    else if (event.phase == Phase::end)
+                    {
+                        if (std::find(open->rbegin(), open->rend(), event.name) == open->rend())
+                            return;
+
+                        for (; open->back() != event.name; open->pop_back())
+                            writeEvent(buffer, { open->back(), event.ticks, 0.0, Phase::end });
+
+                        open->pop_back();
+                    }
+                }
+
+                static const char* const phases[] = { "B", "E", "C", "i" };
+
+                *stream << ",\n{\"name\":";
+                writeString(event.name);
+                *stream << ",\"ph\":\"" << phases[(int) event.phase] << "\",\"ts\":"
+                        << juce::String((double) (event.ticks - startTicks) * microsecondsPerTick, 3)
+                        << ",\"pid\":1,\"tid\":" << buffer.id;
+
+                if (event.phase == Phase::counter)
+                    *stream << ",\"args\":{\"value\":" << juce::String(event.value) << "}";
+                else if (event.phase == Phase::instant)
+                    *stream << ",\"s\":\"t\"";
+
+                *stream << "}";
+            }
+
+            void writeString(const char* text)
+            {
+                *stream << "\"";
+                for (auto* c = text; *c != 0; ++c)
+                {
+                    if (*c == '"' || *c == '\\')
+                        *stream << "\\";
+                    if ((unsigned char) *c >= 0x20)
+                        stream->writeByte(*c);
+                }
+                *stream << "\"";
+            }
+
+            std::unique_ptr<juce::FileOutputStream> stream;
+            ThreadBuffer* const buffers;
+            const juce::int64 startTicks;
+            const double microsecondsPerTick;
+            std::array<Event, 1024> events;
+            std::array<std::vector<const char*>, maxThreads> openSpans;
+            std::array<std::uint64_t, maxThreads> seenDrops {};
+            std::array<juce::int64, maxThreads> lastTicks {};  // of the last event drained per thread
+        };
+
+        std::atomic<bool> recording { false };
+
+        // Buffers are handed out once per thread and kept for the life of the process, so a thread's
+        // pointer to its own stays valid across traces
+        std::unique_ptr<ThreadBuffer[]> pool;
+        std::atomic<ThreadBuffer*> poolBuffers { nullptr };
+        std::atomic<int> nextBuffer { 0 };
+
+        std::unique_ptr<Writer> writer;
+        juce::CriticalSection controlLock;
+
+        ThreadBuffer* getThreadBuffer() noexcept
+        {
+            thread_local ThreadBuffer* buffer = nullptr;
+            thread_local bool claimed = false;
+
+            if (! claimed)
+            {
+                auto* buffers = poolBuffers.load(std::memory_order_acquire);
+                if (buffers == nullptr)
+                    return nullptr;
+
+                claimed = true;
+                const auto index = nextBuffer.load(std::memory_order_relaxed) < maxThreads
+                                       ? nextBuffer.fetch_add(1, std::memory_order_relaxed) : maxThreads;
+                if (index >= maxThreads)
+                    return nullptr;  // more threads than buffers: this one goes untraced
+
+                buffer = &buffers[index];
+                buffer->id = index + 1;
+
+                if (auto* thread = juce::Thread::getCurrentThread())
+                    buffer->setName(thread->getThreadName().toRawUTF8());
+                else
+                    buffer->setName("thread");
+
+                // The writer only drains buffers below numReady, once they are set up
+                auto n = numReady.load(std::memory_order_relaxed);
+                while (n <= index && ! numReady.compare_exchange_weak(n, index + 1, std::memory_order_release))
+                {
+                }
+            }
+
+            return buffer;
+        }
+    }
+
+    void ThreadBuffer::push(const Event& event) noexcept
+    {
+        const auto write = writeIndex.load(std::memory_order_relaxed);
+        if (write - readIndex.load(std::memory_order_acquire) >= (std::uint32_t) capacity)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        events[write % (std::uint32_t) capacity] = event;
+        writeIndex.store(write + 1, std::memory_order_release);
+    }
+
+    int ThreadBuffer::pop(Event* dest, int maxEvents) noexcept
+    {
+        const auto read = readIndex.load(std::memory_order_relaxed);
+        const auto available = (int) (writeIndex.load(std::memory_order_acquire) - read);
+        const auto n = juce::jmin(available, maxEvents);
+
+        for (int i = 0; i < n; ++i)
+            dest[i] = events[(read + (std::uint32_t) i) % (std::uint32_t) capacity];
+
+        readIndex.store(read + (std::uint32_t) n, std::memory_order_release);
+        return n;
+    }
+
+    void ThreadBuffer::setName(const char* newName) noexcept
+    {
+        if (std::strncmp(name.data(), newName, name.size() - 1) != 0)
+        {
+            std::strncpy(name.data(), newName, name.size() - 1);
+            name.back() = 0;
+        }
+    }
+
+    bool isRecording() noexcept
+    {
+        return recording.load(std::memory_order_acquire);
+    }
+
+    void record(Phase phase, const char* name, double value) noexcept
+    {
+        if (! isRecording())
+            return;
+
+        if (auto* buffer = getThreadBuffer())
+            buffer->push({ name, juce::Time::getHighResolutionTicks(), value, phase });
+    }
+
+    void setThreadName(const char* name) noexcept
+    {
+        if (! isRecording())
+            return;
+
+        if (auto* buffer = getThreadBuffer())
+            buffer->setName(name);
+    }
+
+    bool start(const juce::File& file)
+    {
+        const juce::ScopedLock sl(controlLock);
+
+        if (writer != nullptr || ! file.getParentDirectory().createDirectory().wasOk())
+            return false;
+
+        auto stream = std::make_unique<juce::FileOutputStream>(file);
+        if (! stream->openedOk() || ! stream->setPosition(0) || stream->truncate().failed())
+            return false;
+
+        if (pool == nullptr)
+        {
+            pool.reset(new ThreadBuffer[maxThreads]);
+            poolBuffers.store(pool.get(), std::memory_order_release);
+        }
+
+        // Whatever reached the rings after the last trace stopped is stale
+        std::array<Event, 256> discard;
+        for (int i = 0; i < getNumReady(); ++i)
+        {
+            while (pool[i].pop(discard.data(), (int) discard.size()) > 0)
+            {
+            }
+            pool[i].dropped.store(0, std::memory_order_relaxed);
+        }
+
+        writer = std::make_unique<Writer>(std::move(stream), pool.get());
+        writer->startThread();
+
+        recording.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void stop()
+    {
+        const juce::ScopedLock sl(controlLock);
+
+        if (writer == nullptr)
+            return;
+
+        recording.store(false, std::memory_order_release);
+        writer->stopThread(2000);
+        writer->finish();
+        writer.reset();
+    }
+}
+
+#else
+
+namespace Trace
+{
+    void ThreadBuffer::push(const Event&) noexcept                 {}
+    int ThreadBuffer::pop(Event*, int) noexcept                    { return 0; }
+    void ThreadBuffer::setName(const char*) noexcept               {}
+    bool isRecording() noexcept                                    { return false; }
+    void record(Phase, const char*, double) noexcept               {}
+    void setThreadName(const char*) noexcept                       {}
+    bool start(const juce::File&)                                  { return false; }
+    void stop()                                                    {}
+}
+
+#endif
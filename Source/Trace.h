@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+
+    Trace.h
+    Span and counter tracing into per-thread rings, written out as a Chrome/Perfetto JSON trace.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Builds with MIDIPREDICT_TRACING=1 record the MP_TRACE_ macros; otherwise they compile to nothing
+#ifndef MIDIPREDICT_TRACING
+#define MIDIPREDICT_TRACING (0)
+#endif
+
+/**
+ * @brief Where the time goes on the audio and worker threads, as a trace chrome://tracing and
+ * ui.perfetto.dev can open.
+ *
+ * Code is instrumented with the macros below. Each thread records into a ring of its own, claimed from
+ * a fixed pool the first time it records, so recording takes no lock and never allocates: a timestamp
+ * and a store. Between start() and stop(), a background thread drains the rings every 50 ms into the
+ * JSON file; outside them, the macros check one flag and return. Events that find their ring full are
+ * dropped and counted, and the spans of a thread that lost events are closed where its record breaks off.
+ *
+ * - MP_TRACE_SCOPE(name): a span from here to the end of the enclosing scope;
+ * - MP_TRACE_COUNTER(name, value): a counter track, e.g. a queue length or the active voices;
+ * - MP_TRACE_INSTANT(name): a point in time;
+ * - MP_TRACE_THREAD(name): names the calling thread's track (threads started as juce::Thread are
+ *   named after it already).
+ *
+ * Names must be string literals, or otherwise outlive the trace: only the pointer is recorded.
+ */
+namespace Trace
+{
+    enum class Phase : std::uint8_t
+    {
+        begin,
+        end,
+        counter,
+        instant
+    };
+
+    struct Event
+    {
+        const char* name;
+        juce::int64 ticks;  // juce::Time high-resolution ticks
+        double value;       // counters only
+        Phase phase;
+    };
+
+    /** A single-producer, single-consumer ring of one thread's events. */
+    class ThreadBuffer
+    {
+    public:
+        static constexpr int capacity = 8192;
+
+        void push(const Event& event) noexcept;
+        int pop(Event* dest, int maxEvents) noexcept;
+
+        void setName(const char* newName) noexcept;
+        const char* getName() const noexcept  { return name.data(); }
+
+        int id = 0;
+        std::atomic<std::uint64_t> dropped { 0 };
+
+    private:
+        std::array<Event, capacity> events;
+        std::atomic<std::uint32_t> writeIndex { 0 }, readIndex { 0 };
+        std::array<char, 48> name {};
+    };
+
+    /** True between start() and stop(). */
+    bool isRecording() noexcept;
+
+    /** Records one event on the calling thread, if a trace is running. */
+    void record(Phase phase, const char* name, double value = 0.0) noexcept;
+
+    void setThreadName(const char* name) noexcept;
+
+    /** Starts writing a trace to `file`, replacing it; false if it cannot be opened or a trace is running. */
+    bool start(const juce::File& file);
+
+    /** Writes what is left, closes the trace and waits for the writer to finish. */
+    void stop();
+
+    /** Records a span over its lifetime. */
+    class ScopedSpan
+    {
+    public:
+        explicit ScopedSpan(const char* spanName) noexcept : name(spanName)  { record(Phase::begin, name); }
+        ~ScopedSpan()                                                        { record(Phase::end, name); }
+
+    private:
+        const char* name;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedSpan)
+    };
+}
+
+#if MIDIPREDICT_TRACING
+ #define MP_TRACE_CONCAT_INNER(a, b) a##b
+ #define MP_TRACE_CONCAT(a, b) MP_TRACE_CONCAT_INNER(a, b)
+ #define MP_TRACE_SCOPE(name)          const Trace::ScopedSpan MP_TRACE_CONCAT(traceSpan_, __LINE__) (name)
+ #define MP_TRACE_COUNTER(name, value) Trace::record(Trace::Phase::counter, name, (double) (value))
+ #define MP_TRACE_INSTANT(name)        Trace::record(Trace::Phase::instant, name)
+ #define MP_TRACE_THREAD(name)         Trace::setThreadName(name)
+#else
+ #define MP_TRACE_SCOPE(name)
+ #define MP_TRACE_COUNTER(name, value) ((void) 0)
+ #define MP_TRACE_INSTANT(name)        ((void) 0)
+ #define MP_TRACE_THREAD(name)         ((void) 0)
+#endif
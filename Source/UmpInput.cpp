@@ -0,0 +1,194 @@
+/*
+  ==============================================================================
+
+    UmpInput.cpp
+    MIDI 2.0 Universal MIDI Packet input with jitter-reduced timestamps.
+
+  ==============================================================================
+*/
+
+#include "UmpInput.h"
+
+UmpInput::UmpInput()
+    : fifoData(fifoSize)
+{
+}
+
+void UmpInput::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    fifo.reset();
+    clock = {};
+    numDropped = 0;
+}
+
+int UmpInput::getNumWordsForMessageType(std::uint32_t firstWord) noexcept
+{
+    // Word count per message type (the top nibble), from the UMP specification
+    static constexpr int sizes[16] = { 1, 1, 1, 2, 2, 4, 1, 1, 2, 2, 2, 3, 3, 4, 4, 4 };
+    return sizes[firstWord >> 28];
+}
+
+void UmpInput::pushPackets(const std::uint32_t* words, int numWords, double arrivalSeconds)
+{
+    int index = 0;
+    while (index < numWords)
+    {
+        const auto* packet = words + index;
+        const int packetWords = getNumWordsForMessageType(packet[0]);
+        if (index + packetWords > numWords)
+            break;
+        index += packetWords;
+
+        const int messageType = (int) (packet[0] >> 28);
+
+        if (messageType == 0x0)
+        {
+            handleUtility(packet[0], arrivalSeconds);
+            continue;
+        }
+
+        MidiEvent event;
+        if (! decodeChannelVoice(packet, event))
+            continue;
+
+        // Place the event at its JR timestamp if we have one, otherwise at its arrival time
+        double seconds = arrivalSeconds;
+        if (clock.pendingStamp && clock.hasOffset)
+            seconds = juce::jmin(arrivalSeconds, clock.stampSeconds + clock.offset);
+        clock.pendingStamp = false;
+
+        push({ seconds, event });
+    }
+}
+
+void UmpInput::handleUtility(std::uint32_t word, double arrivalSeconds)
+{
+    const int status = (int) ((word >> 20) & 0x0f);
+    if (status != 0x1 && status != 0x2) // JR Clock, JR Timestamp
+        return;
+
+    // Unwrap the 16-bit sender time
+    const auto raw = (std::uint16_t) (word & 0xffff);
+    if (clock.hasSenderTime)
+        clock.senderTicks += (std::int16_t) (std::uint16_t) (raw - clock.lastRawTicks);
+    else
+        clock.senderTicks = raw;
+    clock.lastRawTicks = raw;
+    clock.hasSenderTime = true;
+
+    const double senderSeconds = clock.senderTicks / jrTicksPerSecond;
+
+    if (status == 0x1)
+    {
+        // Transport delay only adds to the observed offset, so keep its minimum. Let it rise slowly
+        // so that drift between the two clocks is still followed.
+        const double observed = arrivalSeconds - senderSeconds;
+        if (! clock.hasOffset)
+            clock.offset = observed;
+        else
+            clock.offset = juce::jmin(observed, clock.offset + maxClockDrift * (arrivalSeconds - clock.lastUpdate));
+        clock.hasOffset = true;
+        clock.lastUpdate = arrivalSeconds;
+    }
+    else
+    {
+        clock.pendingStamp = true;
+        clock.stampSeconds = senderSeconds;
+    }
+}
+
+bool UmpInput::decodeChannelVoice(const std::uint32_t* packet, MidiEvent& event) const
+{
+    const auto w0 = packet[0];
+    const int messageType = (int) (w0 >> 28);
+
+    if (messageType == 0x2) // MIDI 1.0 channel voice
+    {
+        const auto status = (std::uint8_t) ((w0 >> 16) & 0xff);
+        if (status < 0x80 || status >= 0xf0)
+            return false;
+
+        event = MidiEvent::make(0, status, (std::uint8_t) ((w0 >> 8) & 0x7f), (std::uint8_t) (w0 & 0x7f), MidiEvent::live);
+        return true;
+    }
+
+    if (messageType != 0x4) // MIDI 2.0 channel voice
+        return false;
+
+    const auto w1 = packet[1];
+    const int opcode  = (int) ((w0 >> 20) & 0x0f);
+    const int channel = (int) ((w0 >> 16) & 0x0f);
+    const auto index  = (std::uint8_t) ((w0 >> 8) & 0x7f);
+    const auto value7 = (std::uint8_t) (w1 >> 25);
+
+    switch (opcode)
+    {
+        case 0x8:
+        case 0x9:
+        {
+            const auto velocity16 = (std::uint16_t) (w1 >> 16);
+            auto velocity7 = (std::uint8_t) (velocity16 >> 9);
+            if (opcode == 0x9 && velocity7 == 0)
+                velocity7 = 1; // a MIDI 2.0 note-on is never a note-off
+
+            event = MidiEvent::make(0, (std::uint8_t) ((opcode << 4) | channel), index, velocity7, MidiEvent::live);
+            event.velocity16 = velocity16;
+            return true;
+        }
+        case 0xa: event = MidiEvent::make(0, (std::uint8_t) (0xa0 | channel), index, value7, MidiEvent::live); return true;
+        case 0xb: event = MidiEvent::make(0, (std::uint8_t) (0xb0 | channel), index, value7, MidiEvent::live); return true;
+        case 0xc: event = MidiEvent::make(0, (std::uint8_t) (0xc0 | channel), (std::uint8_t) ((w1 >> 24) & 0x7f), 0, MidiEvent::live); return true;
+        case 0xd: event = MidiEvent::make(0, (std::uint8_t) (0xd0 | channel), value7, 0, MidiEvent::live); return true;
+        case 0xe:
+        {
+            const auto bend14 = (int) (w1 >> 18);
+            event = MidiEvent::make(0, (std::uint8_t) (0xe0 | channel), (std::uint8_t) (bend14 & 0x7f), (std::uint8_t) (bend14 >> 7), MidiEvent::live);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+void UmpInput::push(const TimedEvent& e)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+    {
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    fifoData[(size_t) (size1 > 0 ? start1 : start2)] = e;
+    fifo.finishedWrite(1);
+}
+
+void UmpInput::popBlock(double blockEndSeconds, int numSamples, MidiEventList& dest)
+{
+    const double blockStartSeconds = blockEndSeconds - numSamples / sampleRate;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+    auto addRange = [&](int start, int size)
+    {
+        for (int i = start; i < start + size; ++i)
+        {
+            const auto& timed = fifoData[(size_t) i];
+            const double position = (timed.seconds - blockStartSeconds) * sampleRate;
+            const double whole = std::floor(position);
+
+            MidiEvent e = timed.event;
+            e.sampleTime = (std::int32_t) whole;
+            e.subSample = (std::uint16_t) juce::jlimit(0.0, 65535.0, (position - whole) * 65536.0);
+            MidiEvents::insertSorted(dest, e);
+        }
+    };
+
+    addRange(start1, size1);
+    addRange(start2, size2);
+    fifo.finishedRead(size1 + size2);
+}
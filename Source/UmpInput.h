@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    UmpInput.h
+    MIDI 2.0 Universal MIDI Packet input with jitter-reduced timestamps.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MidiEvent.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Receives Universal MIDI Packets from a MIDI input thread and hands them to the audio thread
+ *        as `MidiEvent`s with sub-sample onsets.
+ *
+ * Packets are decoded on the producer side, so the audio thread only copies fixed-size events out of a
+ * lock-free FIFO. MIDI 2.0 channel voice messages keep their 16-bit velocity, and MIDI 1.0 channel voice
+ * packets are accepted too.
+ *
+ * Jitter Reduction (JR) Clock and JR Timestamp utility messages are used to recover the sender's
+ * timing: the offset between the sender clock and our local clock is tracked as a slowly rising
+ * minimum, since transport delay only ever adds to it. A JR-stamped note is therefore placed at the
+ * time it was played rather than the time it happened to arrive. Without JR timestamps the arrival
+ * time is used. One UmpInput receives from one endpoint, so it keeps a single JR clock.
+ *
+ * Nothing in the plugin produces packets yet: hosts hand processBlock MIDI 1.0 bytes, and the JUCE
+ * version in use has no UMP device input. A MIDI 2.0 device callback is expected to push here through
+ * PluginProcessor::getUmpInput().
+ *
+ * Times handed to `pushPackets` and `popBlock` are in seconds on the `now()` clock.
+ */
+class UmpInput
+{
+public:
+    UmpInput();
+
+    /** Called from prepareToPlay; clears any pending events and the JR clock state. */
+    void prepare(double sampleRate);
+
+    /**
+     * @brief Decodes packets and queues the resulting events. Called from the MIDI input thread.
+     *
+     * @param words The packet stream, as 32-bit words in host byte order.
+     * @param numWords The number of words in `words`; a trailing partial packet is ignored.
+     * @param arrivalSeconds When the packets were received, on the `now()` clock.
+     */
+    void pushPackets(const std::uint32_t* words, int numWords, double arrivalSeconds);
+
+    /**
+     * @brief Moves every queued event into `dest` with a block-relative, sub-sample onset. Audio thread only.
+     *
+     * Events are mapped onto the block so that `blockEndSeconds` lines up with the end of the block,
+     * i.e. one block of fixed latency as with `juce::MidiMessageCollector`. Events older than the block
+     * get negative sample times so that the matcher still sees the true onset.
+     */
+    void popBlock(double blockEndSeconds, int numSamples, MidiEventList& dest);
+
+    /** Number of events dropped because the audio thread was not draining the FIFO. */
+    int getNumDropped() const noexcept     { return numDropped.load(std::memory_order_relaxed); }
+
+    static double now()                     { return juce::Time::getMillisecondCounterHiRes() * 0.001; }
+
+    /** Size in 32-bit words of the packet that starts with `firstWord`. */
+    static int getNumWordsForMessageType(std::uint32_t firstWord) noexcept;
+
+private:
+    struct TimedEvent
+    {
+        double seconds;
+        MidiEvent event;
+    };
+
+    /** JR state of the sending endpoint. JR Clock and JR Timestamp are utility messages, which carry no group. */
+    struct JrClock
+    {
+        bool          hasSenderTime = false;
+        std::uint16_t lastRawTicks  = 0;
+        std::int64_t  senderTicks   = 0;     // unwrapped, 1/31250 s
+        bool          hasOffset     = false;
+        double        offset        = 0.0;   // local seconds - sender seconds, tracked as a minimum
+        double        lastUpdate    = 0.0;
+        bool          pendingStamp  = false; // a JR Timestamp is waiting for its message
+        double        stampSeconds  = 0.0;
+    };
+
+    void handleUtility(std::uint32_t word, double arrivalSeconds);
+    bool decodeChannelVoice(const std::uint32_t* packet, MidiEvent& event) const;
+    void push(const TimedEvent& e);
+
+    static constexpr int    fifoSize          = 1024;
+    static constexpr double jrTicksPerSecond  = 31250.0;
+    static constexpr double maxClockDrift     = 1.0e-4; // how fast the offset may rise, in s per s
+
+    juce::AbstractFifo       fifo { fifoSize };
+    std::vector<TimedEvent>  fifoData;
+    JrClock                  clock;
+    std::atomic<int>         numDropped { 0 };
+    double                   sampleRate = 44100.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (UmpInput)
+};
@@ -0,0 +1,241 @@
+/*
+  ==============================================================================
+
+    AlignerTests.cpp
+    The linear-memory alignment must cost exactly what the full cost matrix does, and the note matching
+    must recover a performance's deviations from its score.
+
+  ==============================================================================
+*/
+
+#include "TestSupport.h"
+#include "ScoreAlignment.h"
+
+#include <catch2/catch_message.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    FeatureSequence makeRandomFeatures(juce::Random& random, int length)
+    {
+        std::vector<FeatureSequence::Vector> vectors((size_t) length);
+
+        for (auto& vector : vectors)
+        {
+            float squares = 0.0f;
+            for (auto& value : vector)
+            {
+                value = random.nextFloat();
+                squares += value * value;
+            }
+
+            for (auto& value : vector)
+                value /= std::sqrt(squares);
+        }
+
+        return FeatureSequence(vectors);
+    }
+
+    bool isWarpingPath(const std::vector<HirschbergDtw::Cell>& path, int numRows, int numCols)
+    {
+        if (path.empty() || path.front().row != 0 || path.front().col != 0
+            || path.back().row != numRows - 1 || path.back().col != numCols - 1)
+            return false;
+
+        for (size_t c = 1; c < path.size(); ++c)
+        {
+            const auto rowStep = path[c].row - path[c - 1].row;
+            const auto colStep = path[c].col - path[c - 1].col;
+
+            if (rowStep < 0 || rowStep > 1 || colStep < 0 || colStep > 1 || rowStep + colStep == 0)
+                return false;
+        }
+
+        return true;
+    }
+
+    // A melody note on every beat and a bass note on every fourth, at the 120 bpm of a file without tempo events
+    constexpr int numBeats = 32;
+
+    int melodyPitch(int beat)  { return 48 + (7 * beat) % 24; }
+    int bassPitch(int beat)    { return 36 + beat / 4; }
+
+    /** The performance slows from 120 to 90 bpm over the piece. */
+    double performedBpm(int beat)  { return 120.0 - 30.0 * beat / (numBeats - 1); }
+
+    double performedSeconds(int beat)
+    {
+        double seconds = 0.0;
+        for (int b = 0; b < beat; ++b)
+            seconds += 60.0 / performedBpm(b);
+        return seconds;
+    }
+
+    struct Onset
+    {
+        double seconds;
+        int pitch;
+    };
+
+    /** Writes the onsets, each held for 100 ms, with millisecond timestamps. */
+    bool writeNotes(const juce::File& file, const std::vector<Onset>& onsets)
+    {
+        juce::MidiMessageSequence track;
+
+        for (const auto& onset : onsets)
+        {
+            track.addEvent(juce::MidiMessage::noteOn(1, onset.pitch, (juce::uint8) 90), 1000.0 * onset.seconds);
+            track.addEvent(juce::MidiMessage::noteOff(1, onset.pitch), 1000.0 * onset.seconds + 100.0);
+        }
+
+        track.sort();
+        track.updateMatchedPairs();
+
+        juce::MidiFile midi;
+        midi.setSmpteTimeFormat(25, 40);
+        midi.addTrack(track);
+
+        file.deleteFile();
+        juce::FileOutputStream stream(file);
+        return stream.openedOk() && midi.writeTo(stream);
+    }
+}
+
+TEST_CASE("Hirschberg DTW matches the quadratic alignment's cost", "[aligner]")
+{
+    juce::Random random(2024);
+    HirschbergDtw::Settings settings;
+    settings.numThreads = 4;
+    settings.maxBaseCells = 64;  // to recurse deeply even on short sequences
+
+    for (int trial = 0; trial < 100; ++trial)
+    {
+        const auto numRows = 1 + random.nextInt(120);
+        const auto numCols = 1 + random.nextInt(120);
+        const auto rows = makeRandomFeatures(random, numRows);
+        const auto cols = makeRandomFeatures(random, numCols);
+
+        const auto path = HirschbergDtw(settings).align(rows, cols);
+        const auto expected = HirschbergDtw::getPathCost(rows, cols, HirschbergDtw::alignQuadratic(rows, cols));
+
+        INFO("trial " << trial << ": " << numRows << " x " << numCols);
+        REQUIRE(isWarpingPath(path, numRows, numCols));
+        REQUIRE(std::abs(HirschbergDtw::getPathCost(rows, cols, path) - expected) <= 1.0e-3 * (1.0 + expected));
+    }
+}
+
+TEST_CASE("A performance aligns to its own score note for note", "[aligner]")
+{
+    const auto score = TestSupport::getResources().getChildFile("ladispute_1.mid");
+    REQUIRE(score.existsAsFile());
+
+    ScoreAlignment alignment({});
+    REQUIRE(alignment.align(score, score));
+
+    const auto numNotes = (int) alignment.getScore().notes.size();
+    REQUIRE(alignment.getNumMatched() == numNotes);
+    REQUIRE((int) alignment.getMatches().size() == numNotes);
+
+    for (const auto& match : alignment.getMatches())
+        REQUIRE(match.scoreNote == match.performanceNote);
+}
+
+TEST_CASE("Wrong, missing and extra notes are told apart, and a tempo ramp is recovered", "[aligner]")
+{
+    constexpr int missingMelodyBeat = 6, missingBassBeat = 12, wrongNoteBeat = 20, extraNoteBeat = 25;
+    constexpr int extraChordPitch = 30, extraOnsetPitch = 90;
+
+    std::vector<Onset> scoreOnsets, performanceOnsets;
+
+    for (int beat = 0; beat < numBeats; ++beat)
+    {
+        const auto seconds = performedSeconds(beat);
+
+        scoreOnsets.push_back({ 0.5 * beat, melodyPitch(beat) });
+        if (beat != missingMelodyBeat)
+            performanceOnsets.push_back({ seconds, melodyPitch(beat) + (beat == wrongNoteBeat ? 1 : 0) });
+
+        if (beat % 4 == 0)
+        {
+            scoreOnsets.push_back({ 0.5 * beat, bassPitch(beat) });
+            if (beat != missingBassBeat)
+                performanceOnsets.push_back({ seconds, bassPitch(beat) });
+        }
+
+        if (beat == extraNoteBeat)
+            performanceOnsets.push_back({ seconds, extraChordPitch });
+    }
+
+    // A stray note on its own, between two beats
+    performanceOnsets.push_back({ 0.5 * (performedSeconds(9) + performedSeconds(10)), extraOnsetPitch });
+
+    const auto directory = TestSupport::getOutputDirectory().getChildFile("Aligner");
+    REQUIRE(directory.createDirectory().wasOk());
+    const auto scoreFile = directory.getChildFile("deviations-score.mid");
+    const auto performanceFile = directory.getChildFile("deviations-performance.mid");
+    REQUIRE(writeNotes(scoreFile, scoreOnsets));
+    REQUIRE(writeNotes(performanceFile, performanceOnsets));
+
+    ScoreAlignment alignment({});
+    REQUIRE(alignment.align(scoreFile, performanceFile));
+
+    const auto& score = alignment.getScore();
+    const auto& performance = alignment.getPerformance();
+    REQUIRE(score.notes.size() == scoreOnsets.size());
+    REQUIRE(performance.notes.size() == performanceOnsets.size());
+
+    // Missed score notes by beat and pitch, extra performance notes by pitch
+    std::set<std::pair<int, int>> missed;
+    std::set<int> extra;
+
+    for (const auto& match : alignment.getMatches())
+    {
+        if (match.scoreNote < 0)
+        {
+            extra.insert(performance.notes[(size_t) match.performanceNote].pitch);
+            continue;
+        }
+
+        const auto& note = score.notes[(size_t) match.scoreNote];
+        const auto beat = juce::roundToInt(2.0 * note.seconds);
+
+        if (match.performanceNote < 0)
+        {
+            missed.insert({ beat, note.pitch });
+            continue;
+        }
+
+        const auto& played = performance.notes[(size_t) match.performanceNote];
+        INFO("beat " << beat << ", pitch " << note.pitch << " played as " << played.pitch << " at " << played.seconds << " s");
+        CHECK(played.pitch == note.pitch);
+        CHECK(std::abs(played.seconds - performedSeconds(beat)) < 0.002);
+    }
+
+    const std::set<std::pair<int, int>> expectedMissed {
+        { missingMelodyBeat, melodyPitch(missingMelodyBeat) },
+        { missingBassBeat, bassPitch(missingBassBeat) },
+        { wrongNoteBeat, melodyPitch(wrongNoteBeat) }
+    };
+    const std::set<int> expectedExtra { melodyPitch(wrongNoteBeat) + 1, extraChordPitch, extraOnsetPitch };
+
+    CHECK(missed == expectedMissed);
+    CHECK(extra == expectedExtra);
+    CHECK(alignment.getNumMatched() == (int) scoreOnsets.size() - (int) expectedMissed.size());
+
+    // Every beat has a point but the one whose only note was missed; the window averages over a beat either side
+    const auto& tempoCurve = alignment.getTempoCurve();
+    CHECK((int) tempoCurve.size() == numBeats - 1);
+
+    for (const auto& point : tempoCurve)
+    {
+        const auto beat = juce::roundToInt(point.beat);
+        INFO("beat " << point.beat << ": " << point.bpm << " bpm");
+        CHECK(beat != missingMelodyBeat);
+        CHECK(std::abs(point.bpm - performedBpm(beat)) <= 2.0);
+    }
+}
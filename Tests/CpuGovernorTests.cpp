@@ -0,0 +1,163 @@
+/*
+  ==============================================================================
+
+    CpuGovernorTests.cpp
+    Drives a CpuGovernor with injected load: synthetic block costs for the level logic, real busy-waiting
+    for the timing path, and a processor burning most of its budget in every block.
+
+  ==============================================================================
+*/
+
+#include "TestSupport.h"
+
+#include <catch2/catch_message.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    constexpr double governorSampleRate = 48000.0;
+    constexpr int governorBlockSize = 64;
+
+    CpuGovernor::Settings getTestSettings()
+    {
+        CpuGovernor::Settings settings;
+        settings.holdBlocks = 4;
+        settings.recoverBlocks = 32;
+        return settings;
+    }
+
+    void prepareGovernor(CpuGovernor& governor)
+    {
+        governor.setSettings(getTestSettings());
+        governor.prepare(governorSampleRate);
+    }
+
+    /** Charges `numBlocks` blocks, each costing `load` times its budget. */
+    void run(CpuGovernor& governor, double load, int numBlocks)
+    {
+        for (int i = 0; i < numBlocks; ++i)
+            governor.addBlockCost(governorBlockSize, load * governorBlockSize / governorSampleRate);
+    }
+}
+
+TEST_CASE("Light load stays at the normal level", "[governor]")
+{
+    CpuGovernor governor;
+    prepareGovernor(governor);
+    run(governor, 0.3, 1000);
+
+    CHECK(governor.getLevel() == CpuGovernor::normal);
+    CHECK(governor.getNumEscalations() == 0u);
+    CHECK(governor.getNumBlocks() == 1000u);
+}
+
+TEST_CASE("Sustained pressure steps up one level per hold period", "[governor]")
+{
+    CpuGovernor governor;
+    prepareGovernor(governor);
+    const auto holdBlocks = getTestSettings().holdBlocks;
+
+    run(governor, 0.9, holdBlocks);
+    CHECK(governor.getLevel() == CpuGovernor::skipTelemetry);
+    run(governor, 0.9, holdBlocks);
+    CHECK(governor.getLevel() == CpuGovernor::narrowMatching);
+    run(governor, 0.9, 100);
+    CHECK(governor.getLevel() == CpuGovernor::cullVoices);
+    CHECK(governor.getNumEscalations() == (std::uint64_t) CpuGovernor::numLevels - 1);
+    CHECK(governor.getNumOverruns() == 0u);
+}
+
+TEST_CASE("An overrun steps up at once", "[governor]")
+{
+    CpuGovernor governor;
+    prepareGovernor(governor);
+    run(governor, 1.5, 2);
+
+    CHECK(governor.getLevel() == CpuGovernor::narrowMatching);
+    CHECK(governor.getNumOverruns() == 2u);
+}
+
+TEST_CASE("Recovery is hysteretic", "[governor]")
+{
+    CpuGovernor governor;
+    prepareGovernor(governor);
+    run(governor, 1.5, CpuGovernor::numLevels);
+    REQUIRE(governor.getLevel() == CpuGovernor::cullVoices);
+
+    // Between the thresholds the level holds
+    run(governor, 0.6, 1000);
+    CHECK(governor.getLevel() == CpuGovernor::cullVoices);
+
+    // Below them it steps down one level at a time, and not before recoverBlocks in a row
+    run(governor, 0.1, 200);  // lets the smoothed load fall below recoverLoad
+    CHECK(governor.getLevel() < CpuGovernor::cullVoices);
+    run(governor, 0.1, getTestSettings().recoverBlocks * CpuGovernor::numLevels);
+    CHECK(governor.getLevel() == CpuGovernor::normal);
+    CHECK(governor.getNumRecoveries() == (std::uint64_t) CpuGovernor::numLevels - 1);
+
+    // A spike steps up once; the slowly released load then holds the level instead of flapping
+    run(governor, 0.8, 1);
+    run(governor, 0.5, 10);
+    CHECK(governor.getLevel() == CpuGovernor::skipTelemetry);
+    CHECK(governor.getNumRecoveries() == (std::uint64_t) CpuGovernor::numLevels - 1);
+}
+
+TEST_CASE("Injected busy-wait load is measured", "[governor]")
+{
+    CpuGovernor governor;
+    prepareGovernor(governor);
+
+    for (int i = 0; i < 200; ++i)
+    {
+        const CpuGovernor::ScopedBlock block(governor, governorBlockSize);
+        governor.burn(governorBlockSize, 0.95);
+    }
+
+    CHECK(governor.getLoad() >= 0.95);
+    CHECK(governor.getLevel() == CpuGovernor::cullVoices);
+}
+
+TEST_CASE("A processor under injected load degrades and keeps publishing its timeline", "[governor]")
+{
+    constexpr int numBlocks = 300;
+
+    PluginProcessor processor;
+    TestSupport::prepare(processor, TestSupport::getPausedFixture(), governorSampleRate, governorBlockSize);
+
+    // prepare() holds the governor at normal and keeps the timeline private; this test wants both
+    auto settings = processor.getGovernor().getSettings();
+    settings.maxLevel = CpuGovernor::cullVoices;
+    processor.getGovernor().setSettings(settings);
+    processor.setPublishTimeline(true);
+    processor.releaseResources();
+    processor.prepareToPlay(governorSampleRate, governorBlockSize);
+    processor.setInjectedLoad(0.95);
+
+    juce::AudioBuffer<float> audio(processor.getTotalNumOutputChannels(), governorBlockSize);
+    juce::MidiBuffer midi;
+    midi.ensureSize(8 * MidiEvents::maxEventsPerBlock);
+
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        audio.clear();
+        midi.clear();
+        processor.processBlock(audio, midi);
+    }
+
+    const auto& governor = processor.getGovernor();
+    CHECK(governor.getNumBlocks() == (std::uint64_t) numBlocks);
+    CHECK(governor.getLevel() == CpuGovernor::cullVoices);
+    CHECK(governor.getNumBlocksAtLevel(CpuGovernor::normal) < (std::uint64_t) numBlocks / 10);
+
+   #if MIDIPREDICT_HAS_POSIX_SHM
+    // The timeline is output, not telemetry: its clock counts every block, whatever the level
+    PredictionTimeline::Reader reader;
+    REQUIRE(reader.open(processor.getTimelineName().toRawUTF8()));
+
+    PredictionTimeline::FollowerState state;
+    REQUIRE(reader.readState(state));
+    CHECK(state.blockSampleTime == (std::int64_t) (numBlocks - 1) * governorBlockSize);
+   #endif
+
+    processor.releaseResources();
+}
@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    DeadlineMonitorTests.cpp
+    Busy-waits through the stages of synthetic blocks and checks what the DeadlineMonitor makes of them.
+
+  ==============================================================================
+*/
+
+#include "TestSupport.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    constexpr double deadlineSampleRate = 48000.0;
+    constexpr int deadlineBlockSize = 480; // 10 ms budget
+
+    void spin(double seconds)
+    {
+        const auto until = juce::Time::getHighResolutionTicks() + juce::Time::secondsToHighResolutionTicks(seconds);
+        while (juce::Time::getHighResolutionTicks() < until) {}
+    }
+}
+
+TEST_CASE("Stage time is charged to the stage marked after it", "[deadline]")
+{
+    DeadlineMonitor monitor;
+    monitor.prepare(deadlineSampleRate);
+
+    for (int i = 0; i < 20; ++i)
+    {
+        monitor.beginBlock();
+        spin(0.001);
+        monitor.mark(DeadlineMonitor::following);
+        spin(0.004);
+        monitor.mark(DeadlineMonitor::synthesis);
+        monitor.endBlock(deadlineBlockSize);
+    }
+
+    CHECK(monitor.getNumBlocks() == 20u);
+    CHECK(monitor.getNumOverruns() == 0u);
+
+    const auto following = monitor.getStats(DeadlineMonitor::following);
+    const auto synthesis = monitor.getStats(DeadlineMonitor::synthesis);
+    const auto block = monitor.getStats();
+    CHECK((following.p50 > 0.08 && following.p50 < 0.2));
+    CHECK((synthesis.p50 > 0.35 && synthesis.p50 < 0.7));
+    CHECK(block.p50 >= synthesis.p50);
+    CHECK(block.max >= block.p99);
+    CHECK(monitor.getStats(DeadlineMonitor::input).max == 0.0);
+}
+
+TEST_CASE("Blocks over budget are counted, and reset clears everything at the next block", "[deadline]")
+{
+    DeadlineMonitor monitor;
+    monitor.prepare(deadlineSampleRate);
+
+    monitor.beginBlock();
+    spin(0.012);
+    monitor.mark(DeadlineMonitor::prediction);
+    monitor.endBlock(deadlineBlockSize);
+
+    CHECK(monitor.getNumOverruns() == 1u);
+    CHECK(monitor.getStats().max >= 1.0);
+
+    monitor.reset();
+    monitor.beginBlock();
+    monitor.endBlock(deadlineBlockSize);
+    CHECK(monitor.getNumBlocks() == 1u);
+    CHECK(monitor.getNumOverruns() == 0u);
+}
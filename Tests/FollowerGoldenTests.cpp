@@ -0,0 +1,166 @@
+/*
+  ==============================================================================
+
+    FollowerGoldenTests.cpp
+    The follower's decisions on every bundled performance, bit for bit against Golden/.
+
+  ==============================================================================
+*/
+
+#include "TestSupport.h"
+
+#include <catch2/catch_message.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+
+namespace
+{
+    constexpr double goldenSampleRate = 48000.0;
+    constexpr int goldenBlockSize = 512;
+    constexpr int stateInterval = 50;  // blocks between full state lines
+
+    juce::String toBits(double value)
+    {
+        juce::int64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return juce::String::toHexString(bits);
+    }
+
+    /** FNV-1a over every block's decisions, so that a change anywhere shows even between state lines. */
+    struct Hash
+    {
+        void add(const void* data, size_t size) noexcept
+        {
+            for (size_t i = 0; i < size; ++i)
+                value = (value ^ static_cast<const std::uint8_t*>(data)[i]) * 0x100000001b3ull;
+        }
+
+        std::uint64_t value = 0xcbf29ce484222325ull;
+    };
+
+    /**
+     * Plays the session and writes what the follower decided: a state line (paused, score position and
+     * tempo, the doubles as their bits) every stateInterval blocks and whenever the pause state changes,
+     * a line per note of the prediction it sent out, and a hash of every block's state at the end.
+     */
+    juce::String renderDecisions(const TestSupport::Fixture& fixture, int predictionCase)
+    {
+        PluginProcessor processor;
+        TestSupport::prepare(processor, fixture, goldenSampleRate, goldenBlockSize, predictionCase);
+
+        const auto sessionSamples = TestSupport::getSessionSamples(fixture, goldenSampleRate);
+        juce::AudioBuffer<float> audio(processor.getTotalNumOutputChannels(), goldenBlockSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize(8 * MidiEvents::maxEventsPerBlock);
+
+        juce::String decisions;
+        decisions << "# " << fixture.score.getFileName() << " followed through " << fixture.performance.getFileName()
+                  << ", case " << predictionCase << ", " << (int) goldenSampleRate << " Hz, blocks of " << goldenBlockSize << "\n";
+
+        Hash hash;
+        bool wasPaused = false;
+        int block = 0;
+
+        for (juce::int64 position = 0; position < sessionSamples; position += goldenBlockSize, ++block)
+        {
+            audio.clear();
+            midi.clear();
+            processor.processBlock(audio, midi);
+
+            const bool paused = processor.isFollowerPaused();
+            const auto beats = processor.getScorePositionBeats();
+            const auto bpm = processor.getFollowerTempoBpm();
+            hash.add(&paused, sizeof(paused));
+            hash.add(&beats, sizeof(beats));
+            hash.add(&bpm, sizeof(bpm));
+
+            if (block % stateInterval == 0 || paused != wasPaused)
+                decisions << "state " << block << " " << (paused ? "paused" : "playing") << " "
+                          << toBits(beats) << " " << toBits(bpm) << "\n";
+            wasPaused = paused;
+
+            for (const auto metadata : midi)
+            {
+                const auto message = metadata.getMessage();
+                if (message.isNoteOnOrOff())
+                    decisions << "note " << block << " " << metadata.samplePosition << " "
+                              << (message.isNoteOn() ? "on " : "off ") << message.getNoteNumber() << " "
+                              << (int) message.getVelocity() << "\n";
+            }
+        }
+
+        processor.releaseResources();
+
+        decisions << "blocks " << block << "\n"
+                  << "hash " << juce::String::toHexString((juce::int64) hash.value) << "\n";
+        return decisions;
+    }
+
+    /** The first line where `actual` departs from `expected`, with its number; empty if they match. */
+    juce::String firstDifference(const juce::String& expected, const juce::String& actual)
+    {
+        const auto expectedLines = juce::StringArray::fromLines(expected);
+        const auto actualLines = juce::StringArray::fromLines(actual);
+
+        for (int i = 0; i < juce::jmax(expectedLines.size(), actualLines.size()); ++i)
+            if (expectedLines[i] != actualLines[i])
+                return "line " + juce::String(i + 1) + ": expected \"" + expectedLines[i] + "\", got \"" + actualLines[i] + "\"";
+
+        return {};
+    }
+}
+
+TEST_CASE("Follower decisions match the golden outputs", "[golden]")
+{
+    const juce::File goldenDirectory(MIDIPREDICT_GOLDEN_DIR);
+    const bool update = TestSupport::isSet("MIDIPREDICT_UPDATE_GOLDEN");
+
+    // Until the goldens are recorded there is nothing to hold the decisions to; a missing one among them fails
+    const bool recorded = goldenDirectory.getNumberOfChildFiles(juce::File::findFiles, "*.txt") > 0;
+
+    for (const auto& fixture : TestSupport::getBundledFixtures())
+    {
+        REQUIRE(fixture.performance.existsAsFile());
+
+        for (int predictionCase : { 2, 3 })
+        {
+            const auto golden = goldenDirectory.getChildFile(fixture.name + "-case" + juce::String(predictionCase) + ".txt");
+            const auto decisions = renderDecisions(fixture, predictionCase);
+
+            // Repeatable within a run, or no golden output could hold
+            const auto rerun = firstDifference(decisions, renderDecisions(fixture, predictionCase));
+            INFO(fixture.name.toStdString() << " case " << predictionCase << " rerun, " << rerun.toStdString());
+            REQUIRE(rerun.isEmpty());
+
+            if (update)
+            {
+                REQUIRE(goldenDirectory.createDirectory().wasOk());
+                REQUIRE(golden.replaceWithText(decisions, false, false, "\n"));
+                WARN("Recorded " << golden.getFullPathName().toStdString());
+                continue;
+            }
+
+            const auto difference = golden.existsAsFile() ? firstDifference(golden.loadFileAsString(), decisions)
+                                                          : juce::String("no golden output");
+            if (difference.isEmpty())
+                continue;
+
+            // Keep this run's decisions next to the build for comparison; the golden output stays as it is
+            const auto actual = TestSupport::getOutputDirectory().getChildFile("Golden").getChildFile(golden.getFileName());
+            REQUIRE(actual.getParentDirectory().createDirectory().wasOk());
+            REQUIRE(actual.replaceWithText(decisions, false, false, "\n"));
+
+            if (! recorded)
+                continue;
+
+            FAIL_CHECK(golden.getFileName().toStdString() << ", " << difference.toStdString() << "; this run's output is "
+                       << actual.getFullPathName().toStdString() << ", set MIDIPREDICT_UPDATE_GOLDEN=1 to record it");
+        }
+    }
+
+    if (! update && ! recorded)
+        SKIP("No golden outputs in " << goldenDirectory.getFullPathName().toStdString() << "; this run's are in "
+             << TestSupport::getOutputDirectory().getChildFile("Golden").getFullPathName().toStdString()
+             << ", set MIDIPREDICT_UPDATE_GOLDEN=1 to record them");
+}
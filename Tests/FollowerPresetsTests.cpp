@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    FollowerPresetsTests.cpp
+    Writes follower presets to a temporary file and reads them back.
+
+  ==============================================================================
+*/
+
+#include "TestSupport.h"
+#include "FollowerSettings.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Presets survive a save and load, keyed by the score's file name", "[presets]")
+{
+    const juce::File score("/scores/ladispute_1.mid");
+
+    FollowerSettings tuned;
+    tuned.tempoSmoothing = 0.95;
+    tuned.matchWindowSeconds = 0.35;
+    tuned.lagBlocks = 12;
+    tuned.densityWindowSeconds = 4.0;
+
+    FollowerPresets presets;
+    presets.set(score, tuned);
+
+    juce::TemporaryFile file(".json");
+    REQUIRE(presets.save(file.getFile()));
+
+    FollowerPresets loaded;
+    REQUIRE(loaded.load(file.getFile()));
+    CHECK(loaded.size() == 1);
+    CHECK(loaded.find(juce::File("/elsewhere/ladispute_1.mid")) != nullptr);
+    REQUIRE(loaded.find(score) != nullptr);
+    CHECK(*loaded.find(score) == tuned);
+    CHECK(loaded.find(juce::File("/scores/ladispute_2.mid")) == nullptr);
+}
+
+TEST_CASE("Missing settings keep their defaults and the rest are clamped", "[presets]")
+{
+    const auto settings = FollowerSettings::fromVar(juce::JSON::parse("{ \"lagBlocks\": 0, \"tempoSmoothing\": 1.5 }"));
+
+    CHECK(settings.lagBlocks == 1);
+    CHECK(settings.tempoSmoothing == 1.0);
+    CHECK(settings.matchWindowSeconds == FollowerSettings().matchWindowSeconds);
+    CHECK(settings.densityWindowSeconds == FollowerSettings().densityWindowSeconds);
+}
@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Runs the Catch2 tests with JUCE initialised, counting allocations per thread.
+
+    Usage: MidiPredictTests [catch2 options] [test spec]
+
+  ==============================================================================
+*/
+
+#include "TestSupport.h"
+
+#include <catch2/catch_session.hpp>
+
+#include <cstdlib>
+#include <new>
+
+#if JUCE_WINDOWS
+ #include <malloc.h>
+#endif
+
+namespace
+{
+    // The counter of the calling thread's innermost AllocationScope, if any; other threads go uncounted
+    thread_local std::int64_t* threadAllocations = nullptr;
+}
+
+TestSupport::AllocationScope::AllocationScope() noexcept
+    : previous(threadAllocations)
+{
+    threadAllocations = &count;
+}
+
+TestSupport::AllocationScope::~AllocationScope()
+{
+    threadAllocations = previous;
+}
+
+void* operator new (std::size_t size)
+{
+    if (threadAllocations != nullptr)
+        ++*threadAllocations;
+
+    if (auto* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size)
+{
+    return operator new (size);
+}
+
+void* operator new (std::size_t size, std::align_val_t alignment)
+{
+    if (threadAllocations != nullptr)
+        ++*threadAllocations;
+
+    const auto align = juce::jmax((std::size_t) alignment, sizeof(void*));
+    const auto rounded = (juce::jmax(size, (std::size_t) 1) + align - 1) / align * align;
+
+   #if JUCE_WINDOWS
+    if (auto* p = _aligned_malloc(rounded, align))
+   #else
+    if (auto* p = std::aligned_alloc(align, rounded))
+   #endif
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size, std::align_val_t alignment)
+{
+    return operator new (size, alignment);
+}
+
+void operator delete (void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[] (void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete (void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[] (void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete (void* p, std::align_val_t) noexcept
+{
+   #if JUCE_WINDOWS
+    _aligned_free(p);
+   #else
+    std::free(p);
+   #endif
+}
+
+void operator delete[] (void* p, std::align_val_t alignment) noexcept
+{
+    operator delete (p, alignment);
+}
+
+void operator delete (void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete (p, alignment);
+}
+
+void operator delete[] (void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete (p, alignment);
+}
+
+int main(int argc, char* argv[])
+{
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    return Catch::Session().run(argc, argv);
+}
@@ -0,0 +1,277 @@
+/*
+  ==============================================================================
+
+    PerformanceGateTests.cpp
+    processBlock must not allocate, and the hot paths must not get slower than this machine's baseline.
+
+  ==============================================================================
+*/
+
+#include "TestSupport.h"
+
+#include <catch2/catch_message.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+    constexpr double gateSampleRate = 48000.0;
+    constexpr int gateBlockSize = 512;
+    constexpr int repetitions = 5;
+    constexpr double secondsPerRepetition = 0.3;
+
+    /** Blocks the session through processBlock on this thread, counting what it allocates. */
+    std::int64_t countProcessBlockAllocations(PluginProcessor& processor, juce::int64 sessionSamples, int blockSize)
+    {
+        juce::AudioBuffer<float> audio(processor.getTotalNumOutputChannels(), blockSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize(8 * MidiEvents::maxEventsPerBlock);  // as a host would, so that the output fits
+        std::int64_t allocations = 0;
+
+        for (juce::int64 position = 0; position < sessionSamples; position += blockSize)
+        {
+            audio.clear();
+            midi.clear();
+
+            const TestSupport::AllocationScope scope;
+            processor.processBlock(audio, midi);
+            allocations += scope.getCount();
+        }
+
+        return allocations;
+    }
+
+    /**
+     * Nanoseconds per unit of the fastest of a few timed runs; the fastest is the least disturbed by the
+     * machine. `untimed`, if any, runs before every call outside the timing, e.g. to start a session again.
+     */
+    double timeBest(double unitsPerCall, const std::function<void()>& call, const std::function<void()>& untimed = {})
+    {
+        const auto ticksPerSecond = (double) juce::Time::getHighResolutionTicksPerSecond();
+        double best = 0.0;
+
+        const auto run = [&]
+        {
+            if (untimed)
+                untimed();
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            call();
+            return juce::Time::getHighResolutionTicks() - start;
+        };
+
+        for (int i = 0; i < 3; ++i)
+            run();
+
+        for (int r = 0; r < repetitions; ++r)
+        {
+            juce::int64 ticks = 0, calls = 0;
+
+            while ((double) ticks < secondsPerRepetition * ticksPerSecond)
+            {
+                ticks += run();
+                ++calls;
+            }
+
+            const auto nsPerUnit = (double) ticks * 1.0e9 / (ticksPerSecond * (double) calls * unitsPerCall);
+            best = r == 0 ? nsPerUnit : juce::jmin(best, nsPerUnit);
+        }
+
+        return best;
+    }
+
+    /** Whole blocks, starting the session again (untimed) when the performance is over. */
+    double timeProcessBlock(const TestSupport::Fixture& fixture, double sampleRate, int blockSize)
+    {
+        PluginProcessor processor;
+        TestSupport::prepare(processor, fixture, sampleRate, blockSize, 3);
+
+        const auto sessionSamples = TestSupport::getSessionSamples(fixture, sampleRate);
+        juce::AudioBuffer<float> audio(processor.getTotalNumOutputChannels(), blockSize);
+        juce::MidiBuffer midi;
+        juce::int64 position = 0;
+
+        const auto nsPerBlock = timeBest(1.0, [&]
+        {
+            processor.processBlock(audio, midi);
+            position += blockSize;
+        },
+        [&]
+        {
+            if (position >= sessionSamples)
+            {
+                processor.releaseResources();
+                processor.prepareToPlay(sampleRate, blockSize);
+                position = 0;
+            }
+
+            audio.clear();
+            midi.clear();
+        });
+
+        processor.releaseResources();
+        return nsPerBlock;
+    }
+
+    /** The follower's stages without the synth, block by block, starting the session again (untimed) at its end. */
+    double timeFollower(const TestSupport::Fixture& fixture)
+    {
+        PluginProcessor processor;
+        TestSupport::prepare(processor, fixture, gateSampleRate, gateBlockSize, 3);
+
+        const auto numBlocks = (int) (TestSupport::getSessionSamples(fixture, gateSampleRate) / gateBlockSize);
+        MidiEventList prediction;
+        prediction.reserve(MidiEvents::maxEventsPerBlock);
+        juce::MidiBuffer noMidi;
+        int block = 0;
+
+        const auto nsPerBlock = timeBest(1.0, [&]
+        {
+            processor.getBuffers(gateBlockSize, noMidi);
+            const auto paused = processor.setPredictionVariables(3, gateBlockSize);
+            processor.generate_prediction(gateBlockSize, paused, prediction);
+            processor.advancePrediction(prediction, gateBlockSize, paused);
+            ++block;
+        },
+        [&]
+        {
+            if (block >= numBlocks)
+            {
+                processor.releaseResources();
+                processor.prepareToPlay(gateSampleRate, gateBlockSize);
+                block = 0;
+            }
+        });
+
+        processor.releaseResources();
+        return nsPerBlock;
+    }
+
+    /** Where this machine's baselines are kept: one file per computer and build type. */
+    juce::File getBaselineFile()
+    {
+       #if JUCE_DEBUG
+        const juce::String buildType("debug");
+       #else
+        const juce::String buildType("release");
+       #endif
+
+        return juce::File(MIDIPREDICT_BASELINES_DIR)
+            .getChildFile(juce::File::createLegalFileName(juce::SystemStats::getComputerName() + "-" + buildType) + ".json");
+    }
+
+    juce::String getCpuDescription()
+    {
+        return juce::SystemStats::getCpuModel() + ", " + juce::String(juce::SystemStats::getNumCpus()) + " cores";
+    }
+}
+
+TEST_CASE("processBlock does not allocate", "[allocations]")
+{
+    const auto fixtures = TestSupport::getBundledFixtures();
+
+    for (const auto& fixture : fixtures)
+    {
+        for (int predictionCase : { 1, 2, 3 })
+        {
+            for (int blockSize : { 64, 512 })
+            {
+                PluginProcessor processor;
+                TestSupport::prepare(processor, fixture, gateSampleRate, blockSize, predictionCase);
+
+                const auto allocations = countProcessBlockAllocations(processor, TestSupport::getSessionSamples(fixture, gateSampleRate), blockSize);
+                processor.releaseResources();
+
+                INFO(fixture.name.toStdString() << ", case " << predictionCase << ", blocks of " << blockSize);
+                CHECK(allocations == 0);
+            }
+        }
+    }
+}
+
+TEST_CASE("processBlock does not allocate following a generated performance", "[allocations]")
+{
+    PerformanceGenerator::Settings settings;
+    settings.seed = 2024;
+    settings.lengthSeconds = 120.0;
+    settings.jitterMs = 20.0;
+    settings.wrongNoteProbability = settings.extraNoteProbability = settings.missingNoteProbability = 0.03;
+    settings.skipProbability = settings.repeatProbability = settings.pauseProbability = 0.05;
+
+    PluginProcessor processor;
+    processor.setGeneratedPerformance(settings);
+    TestSupport::prepare(processor, TestSupport::getBundledFixtures().getFirst(), gateSampleRate, gateBlockSize, 3);
+
+    const auto allocations = countProcessBlockAllocations(processor, (juce::int64) (settings.lengthSeconds * gateSampleRate), gateBlockSize);
+    processor.releaseResources();
+
+    CHECK(allocations == 0);
+}
+
+TEST_CASE("Hot paths keep up with this machine's baseline", "[throughput]")
+{
+    const auto fixture = TestSupport::getPausedFixture();
+    REQUIRE(fixture.score.existsAsFile());
+    REQUIRE(fixture.performance.existsAsFile());
+
+    const auto numScoreEvents = (double) readMIDIFile(fixture.score, gateSampleRate).size();
+    REQUIRE(numScoreEvents > 0.0);
+
+    // Nanoseconds per unit: lower is better
+    const std::pair<juce::String, double> measured[] = {
+        { "processBlock, 48 kHz, 512 (ns/block)", timeProcessBlock(fixture, 48000.0, 512) },
+        { "processBlock, 44.1 kHz, 64 (ns/block)", timeProcessBlock(fixture, 44100.0, 64) },
+        { "follower stages, 48 kHz, 512 (ns/block)", timeFollower(fixture) },
+        { "readMIDIFile (ns/event)", timeBest(numScoreEvents, [&] { readMIDIFile(fixture.score, gateSampleRate, 0.5); }) }
+    };
+
+    const auto baselineFile = getBaselineFile();
+    const auto baseline = juce::JSON::parse(baselineFile);
+    const auto thresholdText = juce::SystemStats::getEnvironmentVariable("MIDIPREDICT_REGRESSION_THRESHOLD", "0.15");
+    const auto threshold = juce::jmax(0.0, thresholdText.getDoubleValue());
+
+    auto cases = std::make_unique<juce::DynamicObject>();
+    for (const auto& [name, nsPerUnit] : measured)
+        cases->setProperty(name, nsPerUnit);
+
+    auto recorded = std::make_unique<juce::DynamicObject>();
+    recorded->setProperty("cpu", getCpuDescription());
+    recorded->setProperty("cases", juce::var(cases.release()));
+    const auto recordedText = juce::JSON::toString(juce::var(recorded.release()));
+
+    if (TestSupport::isSet("MIDIPREDICT_UPDATE_BASELINES"))
+    {
+        REQUIRE(baselineFile.getParentDirectory().createDirectory().wasOk());
+        REQUIRE(baselineFile.replaceWithText(recordedText, false, false, "\n"));
+        WARN("Recorded the baseline " << baselineFile.getFullPathName().toStdString());
+        return;
+    }
+
+    // Every run leaves its measurements next to the build, to record from or compare with
+    const auto measuredFile = TestSupport::getOutputDirectory().getChildFile("Baselines").getChildFile(baselineFile.getFileName());
+    REQUIRE(measuredFile.getParentDirectory().createDirectory().wasOk());
+    REQUIRE(measuredFile.replaceWithText(recordedText, false, false, "\n"));
+
+    INFO("this run's measurements are in " << measuredFile.getFullPathName().toStdString()
+         << "; set MIDIPREDICT_UPDATE_BASELINES=1 to record them as the baseline");
+
+    // Timings only compare on the machine that recorded them; anywhere else there is nothing to gate against
+    if (! baselineFile.existsAsFile())
+        SKIP("No baseline for this machine and build type: " << baselineFile.getFullPathName().toStdString());
+
+    if (baseline["cpu"].toString() != getCpuDescription())
+        SKIP(baselineFile.getFileName().toStdString() << " was recorded on " << baseline["cpu"].toString().toStdString()
+             << ", not on this machine's " << getCpuDescription().toStdString());
+
+    for (const auto& [name, nsPerUnit] : measured)
+    {
+        const auto expected = (double) baseline["cases"][juce::Identifier(name)];
+        INFO(name.toStdString() << ": " << nsPerUnit << " ns against a baseline of " << expected
+             << " ns (" << baselineFile.getFileName().toStdString() << ", threshold " << threshold << ")");
+
+        CHECK(expected > 0.0);
+        CHECK(nsPerUnit <= expected * (1.0 + threshold));
+    }
+}
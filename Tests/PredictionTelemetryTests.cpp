@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    PredictionTelemetryTests.cpp
+    Feeds PredictionTelemetry hand-made predictions and live notes and checks how it pairs them.
+
+  ==============================================================================
+*/
+
+#include "TestSupport.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <initializer_list>
+#include <utility>
+
+namespace
+{
+    constexpr double telemetrySampleRate = 1000.0; // one sample per millisecond
+    constexpr int telemetryBlockSize = 10;
+
+    MidiEventList notes(std::initializer_list<std::pair<int, int>> onsets)
+    {
+        MidiEventList list;
+        for (const auto& [time, note] : onsets)
+            list.push_back(MidiEvent::make(time, 0x90, (std::uint8_t) note, 100, MidiEvent::score));
+        return list;
+    }
+
+    /** Two hits, a missing note and an extra one, and enough empty blocks after them for the window to pass. */
+    void playPairs(PredictionTelemetry& telemetry)
+    {
+        telemetry.addBlock(notes({ { 2, 60 }, { 5, 64 } }), notes({ { 7, 60 } }), false, telemetryBlockSize);
+        telemetry.addBlock({}, notes({ { 1, 67 } }), false, telemetryBlockSize);
+        telemetry.addBlock(notes({ { 8, 64 } }), notes({ { 0, 64 } }), false, telemetryBlockSize);
+
+        // The live 64 at 20 pairs with the prediction at 28, the nearer of the two
+        for (int i = 0; i < 10; ++i)
+            telemetry.addBlock({}, {}, false, telemetryBlockSize);
+    }
+}
+
+TEST_CASE("Notes within the window pair up; the rest are missing or extra once it has passed", "[telemetry]")
+{
+    PredictionTelemetry telemetry;
+    telemetry.prepare(telemetrySampleRate, 0.05);
+    playPairs(telemetry);
+
+    const auto stats = telemetry.getStats();
+    CHECK(stats.hits == 2u);
+    CHECK(stats.missing == 1u);
+    CHECK(stats.extra == 1u);
+    CHECK(stats.meanErrorMs == (5.0 - 8.0) / 2.0);
+    CHECK(stats.p95AbsErrorMs == 5.0);
+    CHECK(stats.hitRate == 0.5);
+    CHECK(stats.missingRate == 1.0 / 3.0);
+    CHECK(stats.extraRate == 1.0 / 3.0);
+}
+
+TEST_CASE("Pauses are counted as the follower enters them, and every outcome is queued", "[telemetry]")
+{
+    PredictionTelemetry telemetry;
+    telemetry.prepare(telemetrySampleRate, 0.05);
+    playPairs(telemetry);
+
+    telemetry.addBlock({}, {}, true, telemetryBlockSize);
+    telemetry.addBlock({}, {}, true, telemetryBlockSize);
+    telemetry.addBlock({}, {}, false, telemetryBlockSize);
+    telemetry.addBlock({}, {}, true, telemetryBlockSize);
+    CHECK(telemetry.getStats().pauses == 2u);
+    CHECK(telemetry.getStats().recentPauses == 2);
+
+    std::array<PredictionTelemetry::Record, 16> records;
+    REQUIRE(telemetry.readRecords(records.data(), (int) records.size()) == 6);
+    CHECK(records[0].outcome == PredictionTelemetry::hit);
+    CHECK(records[0].sample == 7);
+    CHECK(records[5].outcome == PredictionTelemetry::pause);
+    CHECK(telemetry.getNumDroppedRecords() == 0u);
+}
@@ -0,0 +1,158 @@
+/*
+  ==============================================================================
+
+    SpeculativeRendererTests.cpp
+    Plays a prediction through a SpeculativeRenderer and compares it with the same blocks rendered just in time.
+
+  ==============================================================================
+*/
+
+#include "TestSupport.h"
+#include "SpeculativeRenderer.h"
+
+#include <catch2/catch_message.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    constexpr int blockSize = 64;
+    constexpr int aheadBlocks = 8;
+    constexpr int numBlocks = 96;
+
+    /** A note starts in every even block and stops in the odd block after it. */
+    MidiEventList blockEvents(int block)
+    {
+        const auto noteNumber = (std::uint8_t) (60 + (block / 2) % 12);
+        const auto status = (std::uint8_t) (block % 2 == 0 ? 0x90 : 0x80);
+        return { MidiEvent::make(block % blockSize, status, noteNumber, 100, MidiEvent::prediction) };
+    }
+
+    void prepareSynth(SineBankSynth& synth)
+    {
+        synth.setCurrentPlaybackSampleRate(48000.0);
+        synth.setNumVoices(16);
+        synth.setPan(-0.5f);
+    }
+
+    SpeculativeRenderer::Context contextOf(const SineBankSynth& synth)
+    {
+        SpeculativeRenderer::Context context;
+        context.pan = synth.getPan();
+        context.numVoices = synth.getNumVoices();
+        context.stealPolicy = synth.getStealPolicy();
+        context.numSamples = blockSize;
+        return context;
+    }
+
+    float maxDifference(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+    {
+        float difference = 0.0f;
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < blockSize; ++i)
+                difference = juce::jmax(difference, std::abs(a.getSample(ch, i) - b.getSample(ch, i)));
+        return difference;
+    }
+
+    /**
+     * Pans the prediction at `panBlock` and pauses the follower from `pauseBlock` on (-1 for neither), and
+     * returns the largest difference from the just-in-time render in each block.
+     */
+    std::vector<float> play(SpeculativeRenderer& renderer, int panBlock, int pauseBlock)
+    {
+        SineBankSynth settings, reference;
+        prepareSynth(settings);
+        prepareSynth(reference);
+
+        // Seeded like the processor: unit tempo, one block apart, the cursor aheadBlocks past the first
+        renderer.prepare(settings, aheadBlocks, 2, blockSize);
+        for (int b = 0; b < aheadBlocks; ++b)
+            renderer.push(blockEvents(b), { 1.0, b * blockSize, false }, contextOf(settings));
+
+        int cursor = aheadBlocks * blockSize;
+
+        juce::AudioBuffer<float> speculative(2, blockSize), expected(2, blockSize);
+        std::vector<float> differences;
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            if (b == panBlock)
+                settings.setPan(0.5f);
+
+            // Gives the background thread time to get ahead
+            juce::Thread::sleep(1);
+
+            // The cursor stands still while the follower is paused
+            const SpeculativeRenderer::Hypothesis hypothesis { 1.0, cursor, pauseBlock >= 0 && b >= pauseBlock };
+            renderer.pop(speculative, hypothesis, contextOf(settings));
+            renderer.push(blockEvents(b + aheadBlocks), hypothesis, contextOf(settings));
+            if (! hypothesis.paused)
+                cursor += blockSize;
+
+            MidiRouter router;
+            const auto events = blockEvents(b);
+            router.setSource(MidiRouter::prediction, events);
+            reference.setPan(settings.getPan());
+            expected.clear();
+            reference.renderNextBlock(expected, router.merge(), 0, blockSize);
+
+            differences.push_back(maxDifference(speculative, expected));
+        }
+
+        renderer.release();
+        return differences;
+    }
+}
+
+TEST_CASE("Pre-rendered blocks match the just-in-time render", "[speculative]")
+{
+    SpeculativeRenderer renderer;
+    const auto differences = play(renderer, -1, -1);
+
+    for (size_t b = 0; b < differences.size(); ++b)
+    {
+        INFO("block " << b);
+        CHECK(differences[b] == 0.0f);
+    }
+
+    CHECK(renderer.getNumHits() + renderer.getNumLateBlocks() == (std::uint64_t) numBlocks);
+    CHECK(renderer.getNumHits() > 0u);
+    CHECK(renderer.getNumMisses() == 0u);
+    CHECK(renderer.getNumCorrections() == 0u);
+}
+
+TEST_CASE("A context change crossfades once and the blocks after it are rendered again", "[speculative]")
+{
+    SpeculativeRenderer renderer;
+    const int panBlock = 40;
+    const auto differences = play(renderer, panBlock, -1);
+
+    for (int b = 0; b < numBlocks; ++b)
+    {
+        INFO("block " << b);
+        if (b != panBlock)
+            CHECK(differences[(size_t) b] == 0.0f);
+    }
+
+    CHECK(renderer.getNumCorrections() <= 1u);
+    CHECK(renderer.getNumHits() + renderer.getNumLateBlocks() + renderer.getNumCorrections() == (std::uint64_t) numBlocks);
+}
+
+TEST_CASE("A pause misses the blocks predicted before it, which play as rendered", "[speculative]")
+{
+    SpeculativeRenderer renderer;
+    const int pauseBlock = 40;
+    const auto differences = play(renderer, -1, pauseBlock);
+
+    for (size_t b = 0; b < differences.size(); ++b)
+    {
+        INFO("block " << b);
+        CHECK(differences[b] == 0.0f);
+    }
+
+    // Every block predicted before the pause and played after it is a miss, but none is rendered again
+    CHECK(renderer.getNumMisses() + renderer.getNumLateBlocks() >= (std::uint64_t) aheadBlocks);
+    CHECK(renderer.getNumCorrections() == 0u);
+}
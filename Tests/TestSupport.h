@@ -0,0 +1,59 @@
+/*
+  ==============================================================================
+
+    TestSupport.h
+    The fixtures shared with the benchmarks (see ProcessorFixtures.h), where recorded outputs go, and a
+    per-thread allocation counter.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ProcessorFixtures.h"
+
+#include <cstdint>
+
+namespace TestSupport
+{
+    using ProcessorFixtures::Fixture;
+    using ProcessorFixtures::getResources;
+    using ProcessorFixtures::getPausedFixture;
+    using ProcessorFixtures::getBundledFixtures;
+    using ProcessorFixtures::prepare;
+    using ProcessorFixtures::getSessionSamples;
+    using ProcessorFixtures::ParameterHost;
+
+    /**
+     * Where a run leaves what it recorded (a golden output that does not match, a baseline it could not
+     * check against), under the build directory. Only update runs write into Golden/ and Baselines/.
+     */
+    inline juce::File getOutputDirectory()
+    {
+        return juce::File(MIDIPREDICT_TEST_OUTPUT_DIR);
+    }
+
+    /** Environment variable as a flag: set to anything but 0 or empty. */
+    inline bool isSet(const char* variable)
+    {
+        const auto value = juce::SystemStats::getEnvironmentVariable(variable, {});
+        return value.isNotEmpty() && value != "0";
+    }
+
+    /** Counts the heap allocations made on the constructing thread while it lives (see Main.cpp). */
+    class AllocationScope
+    {
+    public:
+        AllocationScope() noexcept;
+        ~AllocationScope();
+
+        std::int64_t getCount() const noexcept  { return count; }
+
+    private:
+        std::int64_t count = 0;
+        std::int64_t* previous = nullptr;
+
+        JUCE_DECLARE_NON_COPYABLE(AllocationScope)
+    };
+}
@@ -0,0 +1,109 @@
+/*
+  ==============================================================================
+
+    VoiceRenderTests.cpp
+    FoleysSynth voices rendered on a RenderPool must sum to exactly what serial rendering does.
+
+  ==============================================================================
+*/
+
+#include "TestSupport.h"
+#include "RenderPool.h"
+
+#include <catch2/catch_message.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <memory>
+
+namespace
+{
+    constexpr double voiceSampleRate = 48000.0;
+    constexpr int voiceBlockSize = 256;
+    constexpr int numVoices = 32;
+    constexpr int numBlocks = 200;
+
+    /**
+     * Plays chords that start, overlap and end inside blocks, so that voices run in every envelope stage
+     * and come and go between events, and returns the whole render. `numWorkers` < 0 renders serially.
+     */
+    juce::AudioBuffer<float> renderChords(TestSupport::ParameterHost& host, int numWorkers)
+    {
+        FoleysSynth synth;
+        for (int v = 0; v < numVoices; ++v)
+            synth.addVoice(new FoleysSynth::FoleysVoice());
+        synth.addSound(new FoleysSynth::FoleysSound(host.state));
+        synth.setCurrentPlaybackSampleRate(voiceSampleRate);
+
+        std::unique_ptr<RenderPool> pool;
+        if (numWorkers >= 0)
+        {
+            pool = std::make_unique<RenderPool>(numWorkers);
+            pool->start();
+            synth.setRenderPool(pool.get(), 2, voiceBlockSize);
+        }
+
+        juce::AudioBuffer<float> output(2, numBlocks * voiceBlockSize);
+        output.clear();
+        juce::AudioBuffer<float> block(2, voiceBlockSize);
+        juce::MidiBuffer midi;
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            midi.clear();
+
+            // A chord of 6 to 14 notes every 7 blocks, at a different offset each time, held for 12 blocks
+            if (b % 7 == 0)
+                for (int n = 0; n < 6 + (b / 7) % 9; ++n)
+                    midi.addEvent(juce::MidiMessage::noteOn(1, 36 + (b + 5 * n) % 60, (juce::uint8) (40 + 6 * n)), (37 * b) % voiceBlockSize);
+
+            if (b >= 12 && (b - 12) % 7 == 0)
+                for (int n = 0; n < 6 + ((b - 12) / 7) % 9; ++n)
+                    midi.addEvent(juce::MidiMessage::noteOff(1, 36 + (b - 12 + 5 * n) % 60), (53 * b) % voiceBlockSize);
+
+            block.clear();
+            synth.renderNextBlock(block, midi, 0, voiceBlockSize);
+
+            for (int ch = 0; ch < 2; ++ch)
+                output.copyFrom(ch, b * voiceBlockSize, block, ch, 0, voiceBlockSize);
+        }
+
+        if (pool != nullptr)
+            pool->stop();
+
+        return output;
+    }
+}
+
+TEST_CASE("Pooled voice rendering matches serial rendering sample for sample", "[voices]")
+{
+    TestSupport::ParameterHost host;
+    const auto serial = renderChords(host, -1);
+
+    // 0 workers renders the chunks on the calling thread only
+    for (int numWorkers : { 0, 1, 3 })
+    {
+        const auto pooled = renderChords(host, numWorkers);
+        int differences = 0;
+        float largest = 0.0f;
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            for (int i = 0; i < serial.getNumSamples(); ++i)
+            {
+                const auto expected = serial.getSample(ch, i);
+                const auto actual = pooled.getSample(ch, i);
+
+                if (actual != expected)
+                {
+                    ++differences;
+                    largest = juce::jmax(largest, std::abs(actual - expected));
+                }
+            }
+        }
+
+        INFO(numWorkers << " workers: " << differences << " samples differ, by up to " << largest);
+        CHECK(differences == 0);
+        CHECK(serial.getMagnitude(0, 0, serial.getNumSamples()) > 0.0f);
+    }
+}
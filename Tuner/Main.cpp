@@ -0,0 +1,258 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Tunes the follower for one piece: searches the settings that follow the given performances of its
+    score best, and saves them as the score's preset.
+
+    Usage: MidiPredictTuner --score <mid> --performance <mid> [--performance <mid> ...]
+                            [--generate <s> --seeds <n>[,<n>...] [--jitter <ms>] [--rubato <depth>]
+                             [--mistakes <p>] [--form <p>] [--pauses <p>]]
+                            [--tempo-smoothing <a>,...] [--match-window <s>,...] [--lag <blocks>,...]
+                            [--density-window <s>,...] [--eta <n>] [--min-seconds <s>]
+                            [--case <n>] [--block <n>] [--rate <hz>] [--threads <n>]
+                            [--missed-weight <ms>] [--pause-weight <ms>] [--presets <json>] [--dry-run 1]
+
+    The cost of a session is its mean absolute onset error in milliseconds, plus `--missed-weight` times
+    the fraction of performed notes never predicted, plus `--pause-weight` times the false, missed and
+    never re-locked pauses per performer pause. The generator options are those of MidiPredictEvaluation.
+
+    The best settings are merged into the presets file (by default FollowerPresets::getDefaultFile(),
+    which the plugin loads when it starts) under the score's file name.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "OfflineSession.h"
+#include "ParameterSearch.h"
+
+#include <iostream>
+
+namespace
+{
+    struct Options
+    {
+        juce::File score;
+        juce::Array<juce::File> performances;
+        PerformanceGenerator::Settings generator;
+        std::vector<int> seeds;  // empty: the performance files as they are
+
+        ParameterSearch::Grid grid;
+        ParameterSearch::Settings search;
+
+        int predictionCase = 3;
+        int blockSize = 512;
+        double sampleRate = 48000.0;
+        SessionMetrics::Settings metrics;
+        double missedWeightMs = 1000.0;
+        double pauseWeightMs = 500.0;
+
+        juce::File presets = FollowerPresets::getDefaultFile();
+        bool dryRun = false;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: MidiPredictTuner --score <mid> --performance <mid> [--performance <mid> ...]\n"
+                     "                        [--generate <s> --seeds <n>[,<n>...] [--jitter <ms>] [--rubato <depth>]\n"
+                     "                         [--mistakes <p>] [--form <p>] [--pauses <p>]]\n"
+                     "                        [--tempo-smoothing <a>,...] [--match-window <s>,...] [--lag <blocks>,...]\n"
+                     "                        [--density-window <s>,...] [--eta <n>] [--min-seconds <s>]\n"
+                     "                        [--case <n>] [--block <n>] [--rate <hz>] [--threads <n>]\n"
+                     "                        [--missed-weight <ms>] [--pause-weight <ms>] [--presets <json>] [--dry-run 1]\n";
+    }
+
+    std::vector<double> parseDoubles(const juce::String& value)
+    {
+        std::vector<double> list;
+        for (const auto& item : juce::StringArray::fromTokens(value, ",", {}))
+            if (item.getDoubleValue() > 0.0)
+                list.push_back(item.getDoubleValue());
+        return list;
+    }
+
+    std::vector<int> parseInts(const juce::String& value)
+    {
+        std::vector<int> list;
+        for (const auto& item : juce::StringArray::fromTokens(value, ",", {}))
+            if (item.getIntValue() > 0)
+                list.push_back(item.getIntValue());
+        return list;
+    }
+
+    bool parse(int argc, char* argv[], Options& options)
+    {
+        const auto cwd = juce::File::getCurrentWorkingDirectory();
+
+        for (int i = 1; i < argc; ++i)
+        {
+            const juce::String arg(argv[i]);
+
+            if (i + 1 >= argc)
+                return false;
+
+            const juce::String value(argv[++i]);
+
+            if (arg == "--score")                options.score = cwd.getChildFile(value);
+            else if (arg == "--performance")     options.performances.add(cwd.getChildFile(value));
+            else if (arg == "--generate")        options.generator.lengthSeconds = value.getDoubleValue();
+            else if (arg == "--seeds")           options.seeds = parseInts(value);
+            else if (arg == "--jitter")          options.generator.jitterMs = value.getDoubleValue();
+            else if (arg == "--rubato")          options.generator.rubatoDepth = value.getDoubleValue();
+            else if (arg == "--pauses")          options.generator.pauseProbability = value.getDoubleValue();
+            else if (arg == "--tempo-smoothing") options.grid.tempoSmoothing = parseDoubles(value);
+            else if (arg == "--match-window")    options.grid.matchWindowSeconds = parseDoubles(value);
+            else if (arg == "--lag")             options.grid.lagBlocks = parseInts(value);
+            else if (arg == "--density-window")  options.grid.densityWindowSeconds = parseDoubles(value);
+            else if (arg == "--eta")             options.search.eta = value.getIntValue();
+            else if (arg == "--min-seconds")     options.search.minSeconds = value.getDoubleValue();
+            else if (arg == "--case")            options.predictionCase = value.getIntValue();
+            else if (arg == "--block")           options.blockSize = value.getIntValue();
+            else if (arg == "--rate")            options.sampleRate = value.getDoubleValue();
+            else if (arg == "--threads")         options.search.numThreads = juce::jmax(1, value.getIntValue());
+            else if (arg == "--missed-weight")   options.missedWeightMs = value.getDoubleValue();
+            else if (arg == "--pause-weight")    options.pauseWeightMs = value.getDoubleValue();
+            else if (arg == "--presets")         options.presets = cwd.getChildFile(value);
+            else if (arg == "--dry-run")         options.dryRun = value.getIntValue() != 0;
+            else if (arg == "--mistakes")
+            {
+                options.generator.wrongNoteProbability = value.getDoubleValue();
+                options.generator.extraNoteProbability = value.getDoubleValue();
+                options.generator.missingNoteProbability = value.getDoubleValue();
+            }
+            else if (arg == "--form")
+            {
+                options.generator.skipProbability = value.getDoubleValue();
+                options.generator.repeatProbability = value.getDoubleValue();
+            }
+            else return false;
+        }
+
+        for (const auto& file : options.performances)
+            if (! file.existsAsFile())
+                return false;
+
+        if (options.generator.lengthSeconds > 0.0 && options.seeds.empty())
+            options.seeds.push_back(1);
+
+        return options.score.existsAsFile() && ! options.performances.isEmpty()
+            && options.blockSize > 0 && options.sampleRate > 0.0
+            && ! options.grid.tempoSmoothing.empty() && ! options.grid.matchWindowSeconds.empty()
+            && ! options.grid.lagBlocks.empty() && ! options.grid.densityWindowSeconds.empty();
+    }
+
+    double getCost(const SessionMetrics& metrics, const Options& options)
+    {
+        const auto performed = metrics.onsetErrorMs.count + metrics.missedOnsets;
+        const auto missed = performed > 0 ? (double) metrics.missedOnsets / (double) performed : 0.0;
+        const auto pauseErrors = metrics.falsePauses + metrics.missedPauses + metrics.neverRelocked;
+
+        return metrics.onsetErrorMs.mean
+             + options.missedWeightMs * missed
+             + options.pauseWeightMs * (double) pauseErrors / (double) juce::jmax(1, metrics.performerPauses);
+    }
+
+    juce::String describe(const ParameterSearch::Candidate& candidate)
+    {
+        const auto& s = candidate.settings;
+        return "tempoSmoothing " + juce::String(s.tempoSmoothing, 3)
+             + ", matchWindow " + juce::String(s.matchWindowSeconds, 3) + " s"
+             + ", lag " + juce::String(s.lagBlocks)
+             + ", densityWindow " + juce::String(s.densityWindowSeconds, 1) + " s"
+             + ": cost " + juce::String(candidate.cost, 2)
+             + (candidate.seconds > 0.0 ? " (first " + juce::String(candidate.seconds, 0) + " s)" : juce::String());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (! parse(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    // The score is read once, and each session's performed onsets found once, for every run
+    const auto preparedScore = PreparedScore::read(options.score, options.sampleRate, PluginProcessor::testSpeedChange);
+    const auto seeds = options.seeds.empty() ? std::vector<int> { 0 } : options.seeds;
+
+    std::vector<OfflineSession> sessions;
+    std::vector<std::vector<SessionRecord::Onset>> performed;
+    double fullSeconds = 0.0;
+
+    for (const auto& performance : options.performances)
+    {
+        for (auto seed : seeds)
+        {
+            OfflineSession session;
+            session.performance = performance;
+            session.score = options.score;
+            session.preparedScore = preparedScore;
+            session.predictionCase = options.predictionCase;
+            session.blockSize = options.blockSize;
+            session.sampleRate = options.sampleRate;
+
+            if (seed > 0)
+            {
+                session.generator = options.generator;
+                session.generator->seed = seed;
+            }
+
+            performed.push_back(session.getPerformedOnsets());
+            sessions.push_back(session);
+
+            const auto lastOnset = performed.back().empty() ? 0 : performed.back().back().sample;
+            fullSeconds = juce::jmax(fullSeconds, (double) lastOnset / options.sampleRate + OfflineSession::tailSeconds);
+        }
+    }
+
+    const auto evaluate = [&] (const FollowerSettings& settings, int index, double seconds)
+    {
+        auto session = sessions[(size_t) index];
+        session.follower = settings;
+        session.seconds = seconds;
+
+        double wallSeconds = 0.0;
+        const auto record = session.render(performed[(size_t) index], wallSeconds);
+        return getCost(SessionMetrics::measure(record, options.metrics), options);
+    };
+
+    const auto grid = options.grid.expand();
+    std::cout << grid.size() << " settings over " << sessions.size() << " sessions of up to "
+              << juce::String(fullSeconds, 1) << " s\n";
+
+    const auto start = juce::Time::getMillisecondCounterHiRes();
+    const ParameterSearch search(options.search);
+    const auto ranked = search.run(grid, (int) sessions.size(), fullSeconds, evaluate, [] (int rung, int numCandidates, double seconds)
+    {
+        std::cout << "rung " << rung << ": " << numCandidates << " settings on "
+                  << (seconds > 0.0 ? "the first " + juce::String(seconds, 0) + " s" : juce::String("whole sessions")) << "\n";
+    });
+
+    if (ranked.empty())
+        return 1;
+
+    std::cout << "done in " << juce::String(0.001 * (juce::Time::getMillisecondCounterHiRes() - start), 1) << " s\n";
+    for (size_t i = 0; i < juce::jmin((size_t) 5, ranked.size()); ++i)
+        std::cout << (i + 1) << ". " << describe(ranked[i]) << "\n";
+
+    if (options.dryRun)
+        return 0;
+
+    FollowerPresets presets;
+    presets.load(options.presets);
+    presets.set(options.score, ranked.front().settings);
+
+    if (! presets.save(options.presets))
+    {
+        std::cerr << "Cannot write " << options.presets.getFullPathName() << "\n";
+        return 1;
+    }
+
+    std::cout << "Preset for " << options.score.getFileName() << " saved in " << options.presets.getFullPathName() << "\n";
+    return 0;
+}
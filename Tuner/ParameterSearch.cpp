@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    ParameterSearch.cpp
+    Grid search over follower settings, pruned by successive halving.
+
+  ==============================================================================
+*/
+
+#include "ParameterSearch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+std::vector<FollowerSettings> ParameterSearch::Grid::expand() const
+{
+    std::vector<FollowerSettings> grid;
+    grid.reserve(tempoSmoothing.size() * matchWindowSeconds.size() * lagBlocks.size() * densityWindowSeconds.size());
+
+    for (auto smoothing : tempoSmoothing)
+        for (auto window : matchWindowSeconds)
+            for (auto lag : lagBlocks)
+                for (auto density : densityWindowSeconds)
+                    grid.push_back({ smoothing, window, lag, density });
+
+    return grid;
+}
+
+//==============================================================================
+std::vector<ParameterSearch::Candidate> ParameterSearch::run(const std::vector<FollowerSettings>& grid, int numSessions,
+                                                             double fullSeconds, const Evaluate& evaluate,
+                                                             const Progress& progress) const
+{
+    std::vector<Candidate> survivors, dropped;
+    for (const auto& point : grid)
+        survivors.push_back({ point, 0.0, 0.0 });
+
+    const auto eta = juce::jmax(2, settings.eta);
+    const auto byCost = [] (const Candidate& a, const Candidate& b) { return a.cost < b.cost; };
+
+    for (int rung = 0; ! survivors.empty(); ++rung)
+    {
+        // Prefixes grow by eta per rung; the last rung, or a single survivor, runs the whole sessions
+        const auto prefix = settings.minSeconds * std::pow((double) eta, (double) rung);
+        const bool whole = prefix >= fullSeconds || survivors.size() == 1;
+        const auto seconds = whole ? 0.0 : prefix;
+
+        if (progress)
+            progress(rung, (int) survivors.size(), seconds);
+
+        runRung(survivors, numSessions, seconds, evaluate);
+        std::stable_sort(survivors.begin(), survivors.end(), byCost);
+
+        if (whole)
+            break;
+
+        const auto keep = (size_t) std::ceil((double) survivors.size() / (double) eta);
+        dropped.insert(dropped.begin(), survivors.begin() + (std::ptrdiff_t) keep, survivors.end());
+        survivors.resize(keep);
+    }
+
+    survivors.insert(survivors.end(), dropped.begin(), dropped.end());
+    return survivors;
+}
+
+void ParameterSearch::runRung(std::vector<Candidate>& candidates, int numSessions, double seconds, const Evaluate& evaluate) const
+{
+    const auto numJobs = candidates.size() * (size_t) numSessions;
+    std::vector<double> costs(numJobs, 0.0);
+    std::atomic<size_t> finished { 0 };
+
+    {
+        juce::ThreadPool pool(juce::jmax(1, settings.numThreads));
+
+        // Each job writes only its own cost
+        for (size_t job = 0; job < numJobs; ++job)
+        {
+            pool.addJob([&, job]
+            {
+                const auto& candidate = candidates[job / (size_t) numSessions];
+                costs[job] = evaluate(candidate.settings, (int) (job % (size_t) numSessions), seconds);
+                ++finished;
+            });
+        }
+
+        while (finished.load() < numJobs)
+            juce::Thread::sleep(10);
+    }
+
+    for (size_t c = 0; c < candidates.size(); ++c)
+    {
+        candidates[c].cost = 0.0;
+        candidates[c].seconds = seconds;
+
+        for (int session = 0; session < numSessions; ++session)
+            candidates[c].cost += costs[c * (size_t) numSessions + (size_t) session];
+    }
+}
@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    ParameterSearch.h
+    Grid search over follower settings, pruned by successive halving.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FollowerSettings.h"
+
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Finds the follower settings with the lowest cost over a set of sessions.
+ *
+ * Every point of the grid is first run on a short prefix of each session, `minSeconds` long. The best
+ * 1/`eta` of them go on to prefixes `eta` times longer, and so on until the survivors are run on the
+ * whole sessions, so most of the time goes to the settings that look best. Runs of one rung are spread
+ * over a thread pool, one job per setting and session.
+ */
+class ParameterSearch
+{
+public:
+    /** The values to try for each setting; the grid is every combination of them. */
+    struct Grid
+    {
+        std::vector<double> tempoSmoothing { 0.95, 0.97, 0.98, 0.99, 0.995 };
+        std::vector<double> matchWindowSeconds { 0.1, 0.15, 0.2, 0.3, 0.4 };
+        std::vector<int> lagBlocks { 10, 20, 30 };
+        std::vector<double> densityWindowSeconds { 5.0, 10.0, 20.0 };
+
+        std::vector<FollowerSettings> expand() const;
+    };
+
+    struct Settings
+    {
+        int eta = 3;
+        double minSeconds = 20.0;
+        int numThreads = juce::SystemStats::getNumCpus();
+    };
+
+    struct Candidate
+    {
+        FollowerSettings settings;
+        double cost = 0.0;     // summed over the sessions at the last rung it ran in
+        double seconds = 0.0;  // length of that rung's prefix, 0 for whole sessions
+    };
+
+    /** Cost of one setting on one session, run for `seconds` (0: all of it); called from the pool's threads. */
+    using Evaluate = std::function<double(const FollowerSettings& settings, int session, double seconds)>;
+
+    /** Called on the calling thread as each rung starts. */
+    using Progress = std::function<void(int rung, int numCandidates, double seconds)>;
+
+    explicit ParameterSearch(const Settings& settings) : settings(settings) {}
+
+    /**
+     * Runs the search over `numSessions` sessions, the longest of which is `fullSeconds` long, and returns
+     * every candidate, best first: the ones that reached the whole sessions, then the rest by the rung
+     * they were dropped at.
+     */
+    std::vector<Candidate> run(const std::vector<FollowerSettings>& grid, int numSessions, double fullSeconds,
+                               const Evaluate& evaluate, const Progress& progress = {}) const;
+
+private:
+    void runRung(std::vector<Candidate>& candidates, int numSessions, double seconds, const Evaluate& evaluate) const;
+
+    Settings settings;
+};